@@ -0,0 +1,92 @@
+/* Compares lower_bound, upper_bound and equal_range of rbtree with those of
+ * std::set.
+ *
+ * Usage: bounds [size] [queries]
+ *
+ * Defaults to 2^22 keys and 2^22 queries. The keys are the even numbers in
+ * [0, 2 * size), inserted in random order, so that half of the queries are
+ * unsuccessful */
+
+#include "trbt.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+    template <typename Search>
+    void run(std::string const& name, std::vector<std::int64_t> const& queries, Search search) {
+        using clock = std::chrono::steady_clock;
+        std::int64_t checksum = 0;
+
+        /* Warm up, the first pass over the tree is dominated by page faults */
+        for(auto q : queries)
+            checksum += search(q);
+        checksum = 0;
+
+        auto const start = clock::now();
+        for(auto q : queries)
+            checksum += search(q);
+        auto const ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+
+        std::cout << std::left << std::setw(24) << name
+                  << std::right << std::setw(10) << std::fixed << std::setprecision(2)
+                  << ns / queries.size() << " ns/query"
+                  << "  (checksum " << checksum << ")\n";
+    }
+
+    /* Value at it, or -1 past the end */
+    template <typename Container, typename It>
+    std::int64_t value_at(Container const& c, It it) {
+        return it == std::end(c) ? -1 : *it;
+    }
+}
+
+int main(int argc, char** argv) {
+    std::size_t const size = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1u << 22;
+    std::size_t const nqueries = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1u << 22;
+
+    std::mt19937_64 mt{42};
+    std::vector<std::int64_t> keys(size);
+    for(std::size_t i = 0u; i < size; i++)
+        keys[i] = static_cast<std::int64_t>(2u * i);
+    std::shuffle(std::begin(keys), std::end(keys), mt);
+
+    std::uniform_int_distribution<std::int64_t> dis(0, 2 * static_cast<std::int64_t>(size));
+    std::vector<std::int64_t> queries(nqueries);
+    std::generate(std::begin(queries), std::end(queries), [&]() { return dis(mt); });
+
+    trbt::rbtree<std::int64_t> const tree(std::begin(keys), std::end(keys));
+    std::set<std::int64_t> const set(std::begin(keys), std::end(keys));
+
+    std::cout << size << " keys, " << nqueries << " queries, height " << tree.stats().height << "\n";
+    run("rbtree lower_bound", queries, [&tree](std::int64_t q) {
+        return value_at(tree, tree.lower_bound(q));
+    });
+    run("std::set lower_bound", queries, [&set](std::int64_t q) {
+        return value_at(set, set.lower_bound(q));
+    });
+    run("rbtree upper_bound", queries, [&tree](std::int64_t q) {
+        return value_at(tree, tree.upper_bound(q));
+    });
+    run("std::set upper_bound", queries, [&set](std::int64_t q) {
+        return value_at(set, set.upper_bound(q));
+    });
+    run("rbtree equal_range", queries, [&tree](std::int64_t q) {
+        auto [first, last] = tree.equal_range(q);
+        return value_at(tree, first) + value_at(tree, last);
+    });
+    run("std::set equal_range", queries, [&set](std::int64_t q) {
+        auto [first, last] = set.equal_range(q);
+        return value_at(set, first) + value_at(set, last);
+    });
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+/* Compares full and range scans of rbtree through iterators and through
+ * for_each, with std::set as reference.
+ *
+ * Usage: for_each [size] [repetitions]
+ *
+ * Defaults to 2^22 values and 8 repetitions. Values are inserted in random
+ * order, so that nodes adjacent in order are scattered in memory */
+
+#include "trbt.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+    template <typename Scan>
+    void run(std::string const& name, std::size_t values, unsigned reps, Scan scan) {
+        using clock = std::chrono::steady_clock;
+        std::int64_t checksum = 0;
+
+        /* Warm up */
+        scan();
+
+        auto const start = clock::now();
+        for(unsigned i = 0u; i < reps; i++)
+            checksum += scan();
+        auto const ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+
+        std::cout << std::left << std::setw(28) << name
+                  << std::right << std::setw(10) << std::fixed << std::setprecision(2)
+                  << ns / (static_cast<double>(values) * reps) << " ns/value"
+                  << "  (checksum " << checksum << ")\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    std::size_t const size = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : (1u << 22u);
+    unsigned const reps = argc > 2 ? static_cast<unsigned>(std::strtoul(argv[2], nullptr, 10)) : 8u;
+
+    std::vector<std::int64_t> keys(size);
+    std::iota(std::begin(keys), std::end(keys), 0);
+    std::shuffle(std::begin(keys), std::end(keys), std::mt19937_64{42});
+
+    trbt::rbtree<std::int64_t> tree(std::begin(keys), std::end(keys));
+    std::set<std::int64_t> set(std::begin(keys), std::end(keys));
+    auto const lo = static_cast<std::int64_t>(size / 4u), hi = static_cast<std::int64_t>(3u * size / 4u);
+
+    std::cout << size << " values, " << reps << " repetitions\n";
+    run("rbtree range-for", size, reps, [&tree]() {
+        std::int64_t sum = 0;
+        for(auto v : tree)
+            sum += v;
+        return sum;
+    });
+    run("rbtree for_each", size, reps, [&tree]() {
+        std::int64_t sum = 0;
+        tree.for_each([&sum](std::int64_t v) { sum += v; });
+        return sum;
+    });
+    run("rbtree for_each_reverse", size, reps, [&tree]() {
+        std::int64_t sum = 0;
+        tree.for_each_reverse([&sum](std::int64_t v) { sum += v; });
+        return sum;
+    });
+    run("std::set range-for", size, reps, [&set]() {
+        std::int64_t sum = 0;
+        for(auto v : set)
+            sum += v;
+        return sum;
+    });
+    run("rbtree iterator range", size / 2u, reps, [&tree, lo, hi]() {
+        std::int64_t sum = 0;
+        for(auto it = tree.lower_bound(lo), last = tree.upper_bound(hi); it != last; ++it)
+            sum += *it;
+        return sum;
+    });
+    run("rbtree for_each_in_range", size / 2u, reps, [&tree, lo, hi]() {
+        std::int64_t sum = 0;
+        tree.for_each_in_range(lo, hi, [&sum](std::int64_t v) { sum += v; });
+        return sum;
+    });
+}
@@ -0,0 +1,75 @@
+/* Compares lower_bound throughput of rbtree, frozen_rbtree and frozen_btree.
+ *
+ * Usage: frozen_search [size] [queries]
+ *
+ * Defaults to 2^22 keys and 2^22 queries. The keys are the even numbers in
+ * [0, 2 * size) so that half of the queries are unsuccessful */
+
+#include "trbt.h"
+#include "trbt_btree.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+    template <typename Tree, typename Key>
+    void run(std::string const& name, Tree const& tree, std::vector<Key> const& queries) {
+        using clock = std::chrono::steady_clock;
+        Key checksum{};
+
+        auto const start = clock::now();
+        for(auto q : queries) {
+            auto it = tree.lower_bound(q);
+            if(it != std::end(tree))
+                checksum += *it;
+        }
+        auto const ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+
+        std::cout << std::left << std::setw(16) << name
+                  << std::right << std::setw(10) << std::fixed << std::setprecision(2)
+                  << ns / queries.size() << " ns/query"
+                  << std::setw(12) << queries.size() * 1e3 / ns << " Mq/s"
+                  << "  (checksum " << checksum << ")\n";
+    }
+
+    template <typename Key>
+    void bench(std::string const& type, std::size_t size, std::size_t nqueries) {
+        std::mt19937_64 mt{42};
+        std::vector<Key> keys(size);
+        for(std::size_t i = 0u; i < size; i++)
+            keys[i] = static_cast<Key>(2 * i);
+        std::shuffle(std::begin(keys), std::end(keys), mt);
+
+        std::uniform_int_distribution<std::int64_t> dis(0, 2 * static_cast<std::int64_t>(size));
+        std::vector<Key> queries(nqueries);
+        std::generate(std::begin(queries), std::end(queries), [&]() {
+            return static_cast<Key>(dis(mt));
+        });
+
+        std::cout << type << ", " << size << " keys, " << nqueries << " queries\n";
+
+        trbt::rbtree<Key> tree(std::begin(keys), std::end(keys));
+        run("rbtree", tree, queries);
+        run("frozen_rbtree", tree.freeze(), queries);
+        run("frozen_btree", trbt::freeze_btree(tree), queries);
+        std::cout << '\n';
+    }
+}
+
+int main(int argc, char** argv) {
+    std::size_t size = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1u << 22;
+    std::size_t queries = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1u << 22;
+
+    bench<std::int32_t>("int32_t", size, queries);
+    bench<std::int64_t>("int64_t", size, queries);
+    bench<double>("double", size, queries);
+
+    return 0;
+}
@@ -0,0 +1,250 @@
+/* Replays a workload log recorded through trbt::recording_type against
+ * several containers and reports throughput and per-operation latency.
+ *
+ * Usage: replay [log]
+ *
+ * Without a log, a synthetic workload of random int64_t operations is
+ * recorded and replayed. Further containers can be compared by adding an
+ * engine adapter below and listing it in replay() */
+
+#include "trbt.h"
+#include "trbt_record.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+    using clock_type = std::chrono::steady_clock;
+
+    /* Adapter for containers with a std::set like interface */
+    template <typename Set>
+    struct set_engine {
+        using value_type = typename Set::value_type;
+
+        Set set{};
+
+        void insert(value_type const& value) {
+            set.insert(value);
+        }
+
+        void erase(value_type const& value) {
+            set.erase(value);
+        }
+
+        bool find(value_type const& value) const {
+            return set.find(value) != std::end(set);
+        }
+
+        std::size_t iterate(value_type const& value, std::uint64_t count) const {
+            std::size_t steps = 0u;
+            for(auto it = set.lower_bound(value); steps < count && it != std::end(set); ++it)
+                ++steps;
+            return steps;
+        }
+    };
+
+    template <typename Key>
+    struct map_engine {
+        std::map<Key, Key> map{};
+
+        void insert(Key const& key) {
+            map.emplace(key, key);
+        }
+
+        void erase(Key const& key) {
+            map.erase(key);
+        }
+
+        bool find(Key const& key) const {
+            return map.find(key) != std::end(map);
+        }
+
+        std::size_t iterate(Key const& key, std::uint64_t count) const {
+            std::size_t steps = 0u;
+            for(auto it = map.lower_bound(key); steps < count && it != std::end(map); ++it)
+                ++steps;
+            return steps;
+        }
+    };
+
+    template <typename Engine, typename Value>
+    std::size_t apply(Engine& engine, trbt::record<Value> const& rec) {
+        switch(rec.op) {
+            case trbt::operation::Insert:
+                engine.insert(rec.value);
+                return 0u;
+            case trbt::operation::Erase:
+                engine.erase(rec.value);
+                return 0u;
+            case trbt::operation::Find:
+                return engine.find(rec.value);
+            case trbt::operation::LowerBound:
+                return engine.iterate(rec.value, 1u);
+            default:
+                return engine.iterate(rec.value, rec.count);
+        }
+    }
+
+    template <typename Engine, typename Value>
+    void run(std::string const& name, std::vector<trbt::record<Value>> const& log) {
+        std::size_t checksum = 0u;
+
+        /* Throughput, without timing individual operations */
+        {
+            Engine engine;
+            auto const start = clock_type::now();
+            for(auto const& rec : log)
+                checksum += apply(engine, rec);
+            auto const ns = std::chrono::duration<double, std::nano>(clock_type::now() - start).count();
+
+            std::cout << name << ": " << std::fixed << std::setprecision(2) 
+                      << log.size() * 1e3 / ns << " Mops/s, " 
+                      << ns / log.size() << " ns/op\n";
+        }
+
+        /* Latency, in a second run on a fresh container */
+        std::vector<std::uint64_t> latencies(log.size());
+        {
+            Engine engine;
+            for(std::size_t i = 0u; i < log.size(); i++) {
+                auto const start = clock_type::now();
+                checksum += apply(engine, log[i]);
+                latencies[i] = static_cast<std::uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - start).count());
+            }
+        }
+
+        /* Histogram with power of two buckets */
+        std::vector<std::size_t> buckets(65u);
+        for(auto ns : latencies) {
+            std::size_t bucket = 0u;
+            while(bucket < 64u && (std::uint64_t{1} << bucket) <= ns)
+                ++bucket;
+            ++buckets[bucket];
+        }
+
+        std::sort(std::begin(latencies), std::end(latencies));
+        auto percentile = [&latencies](double p) {
+            return latencies[static_cast<std::size_t>(p * (latencies.size() - 1u))];
+        };
+
+        std::cout << "  latency ns: p50 " << percentile(0.5) << ", p90 " << percentile(0.9) 
+                  << ", p99 " << percentile(0.99) << ", p99.9 " << percentile(0.999) 
+                  << ", max " << latencies.back() << "\n";
+        for(std::size_t b = 0u; b < buckets.size(); b++) {
+            if(!buckets[b])
+                continue;
+            std::cout << "  < " << std::setw(10) << (std::uint64_t{1} << b) << " ns " 
+                      << std::setw(10) << buckets[b] << " "
+                      << std::string(static_cast<std::size_t>(60.0 * buckets[b] / latencies.size()), '#') << "\n";
+        }
+        std::cout << "  (checksum " << checksum << ")\n\n";
+    }
+
+    template <typename Value>
+    void replay(std::istream& is) {
+        trbt::record_reader<Value> reader{is};
+        std::vector<trbt::record<Value>> log;
+        for(trbt::record<Value> rec; reader.next(rec); )
+            log.push_back(rec);
+
+        if(log.empty()) {
+            std::cout << "Workload log is empty\n";
+            return;
+        }
+
+        std::cout << log.size() << " operations recorded over " 
+                  << (log.back().timestamp - log.front().timestamp) / 1e6 << " ms\n\n";
+
+        run<set_engine<trbt::rbtree<Value>>>("trbt::rbtree", log);
+        run<set_engine<std::set<Value>>>("std::set", log);
+        run<map_engine<Value>>("std::map", log);
+    }
+
+    /* Random mix of 50% searches, 20% insertions, 20% erasures, 5% lower bounds and 5% scans */
+    void record_synthetic(std::ostream& os, std::size_t ops) {
+        std::mt19937_64 mt{42};
+        std::uniform_int_distribution<std::int64_t> key_dis(0, static_cast<std::int64_t>(ops));
+        std::uniform_int_distribution<int> op_dis(0, 99);
+
+        trbt::recording_type<trbt::rbtree<std::int64_t>> tree;
+        tree.record_to(os);
+
+        for(std::size_t i = 0u; i < ops; i++) {
+            auto const key = key_dis(mt);
+            auto const op = op_dis(mt);
+            if(op < 50)
+                tree.find(key);
+            else if(op < 70)
+                tree.insert(key);
+            else if(op < 90)
+                tree.erase(key);
+            else if(op < 95)
+                tree.lower_bound(key);
+            else
+                tree.iterate(key, 16u, [](auto) { });
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    std::stringstream synthetic;
+    std::ifstream file;
+    std::istream* is = &synthetic;
+
+    if(argc > 1) {
+        file.open(argv[1], std::ios::binary);
+        if(!file) {
+            std::cerr << "Unable to open " << argv[1] << "\n";
+            return 1;
+        }
+        is = &file;
+    }
+    else
+        record_synthetic(synthetic, 1u << 20);
+
+    /* Peek at the value type tag following the magic number and version */
+    char header[16];
+    is->read(header, sizeof(header));
+    std::uint32_t tag{};
+    std::memcpy(&tag, header + 12, sizeof(tag));
+    is->clear();
+    is->seekg(0);
+
+    try {
+        switch(tag) {
+            case trbt::impl::record_type_tag<std::int32_t>():
+                replay<std::int32_t>(*is);
+                break;
+            case trbt::impl::record_type_tag<std::int64_t>():
+                replay<std::int64_t>(*is);
+                break;
+            case trbt::impl::record_type_tag<double>():
+                replay<double>(*is);
+                break;
+            case trbt::impl::record_type_tag<std::string>():
+                replay<std::string>(*is);
+                break;
+            default:
+                std::cerr << "Unsupported value type in workload log\n";
+                return 1;
+        }
+    }
+    catch(std::exception const& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
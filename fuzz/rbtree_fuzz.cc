@@ -0,0 +1,254 @@
+/* Fuzz target decoding byte streams into sequences of insertions,
+ * emplacements, hinted insertions, erasures, searches and iterator walks,
+ * performed on an rbtree and on a std::set acting as oracle. The tree's
+ * invariants are checked after every step.
+ *
+ * Built with -D TRBT_LIBFUZZER, this file only provides
+ * LLVMFuzzerTestOneInput for linking with -fsanitize=fuzzer. Otherwise it
+ * contains a standalone driver:
+ *
+ * Usage: rbtree_fuzz [--seed <n>] [--runs <n>] [file|directory]...
+ *
+ * Given files or directories, every file is run as one input. Without them,
+ * --runs random inputs (default 10000) are generated from --seed. Failing
+ * inputs are written to crash-<seed>-<run> */
+
+#define TRBT_DEBUG
+#include "trbt.h"
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <set>
+#include <stdexcept>
+#include <string>
+
+#ifndef TRBT_LIBFUZZER
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <vector>
+#endif
+
+namespace {
+    struct fuzz_failure : std::logic_error {
+        using logic_error::logic_error;
+    };
+
+    enum class fuzz_operation : std::uint8_t {
+        Insert, Emplace, HintedInsert, Erase, Find, WalkForward, WalkBackward, UpperBoundOrClear
+    };
+
+    class byte_reader {
+        public:
+            byte_reader(std::uint8_t const* data, std::size_t size) noexcept
+                : data_{data}, size_{size} { }
+
+            bool empty() const noexcept {
+                return pos_ == size_;
+            }
+
+            std::uint8_t byte() noexcept {
+                return pos_ < size_ ? data_[pos_++] : 0u;
+            }
+
+            /* Small key range so that operations frequently hit existing values */
+            int key() noexcept {
+                return static_cast<std::int8_t>(byte());
+            }
+
+        private:
+            std::uint8_t const* data_;
+            std::size_t size_;
+            std::size_t pos_{0u};
+    };
+
+    void check(bool condition, std::string const& what) {
+        if(!condition)
+            throw fuzz_failure{what};
+    }
+
+    void check_invariants(trbt::rbtree<int> const& tree, std::set<int> const& oracle) {
+        tree.assert_properties_ok([](int i) { return std::to_string(i); });
+        check(!tree.assert_leftmost_ok(), "Leftmost node is broken");
+        check(!tree.assert_rightmost_ok(), "Rightmost node is broken");
+        check(tree.size() == oracle.size(), "Size differs from oracle");
+        check(tree.empty() == oracle.empty(), "Emptiness differs from oracle");
+    }
+
+    /* Walks at most steps values from first and oracle_first in the direction given */
+    template <typename It, typename OracleIt>
+    void walk(It first, It last, OracleIt oracle_first, OracleIt oracle_last, unsigned steps) {
+        for(; steps && oracle_first != oracle_last; --steps, ++first, ++oracle_first) {
+            check(first != last, "Iteration ended early");
+            check(*first == *oracle_first, "Iteration yielded " + std::to_string(*first) +
+                                           ", expected " + std::to_string(*oracle_first));
+        }
+        if(steps)
+            check(first == last, "Iteration did not end");
+    }
+
+    void run(std::uint8_t const* data, std::size_t size) {
+        trbt::rbtree<int> tree;
+        std::set<int> oracle;
+        byte_reader reader{data, size};
+
+        while(!reader.empty()) {
+            auto const op = static_cast<fuzz_operation>(reader.byte() % 8u);
+            int const key = reader.key();
+
+            switch(op) {
+                case fuzz_operation::Insert: {
+                    auto [it, inserted] = tree.insert(key);
+                    check(inserted == oracle.insert(key).second, "Insertion of " + std::to_string(key) + " disagrees with oracle");
+                    check(*it == key, "Insertion returned wrong iterator");
+                    break;
+                }
+                case fuzz_operation::Emplace: {
+                    auto [it, inserted] = tree.emplace(key);
+                    check(inserted == oracle.emplace(key).second, "Emplacement of " + std::to_string(key) + " disagrees with oracle");
+                    check(*it == key, "Emplacement returned wrong iterator");
+                    break;
+                }
+                case fuzz_operation::HintedInsert: {
+                    /* Hints are arbitrary, so they are just as often wrong as right */
+                    auto const hint = tree.lower_bound(reader.key());
+                    auto it = tree.insert(hint, key);
+                    oracle.insert(key);
+                    check(*it == key, "Hinted insertion returned wrong iterator");
+                    break;
+                }
+                case fuzz_operation::Erase:
+                    check(tree.erase(key) == oracle.erase(key), "Erasure of " + std::to_string(key) + " disagrees with oracle");
+                    break;
+                case fuzz_operation::Find: {
+                    auto it = tree.find(key);
+                    check((it != std::end(tree)) == oracle.count(key), "Search for " + std::to_string(key) + " disagrees with oracle");
+                    check(tree.contains(key) == oracle.count(key), "contains disagrees with oracle");
+                    break;
+                }
+                case fuzz_operation::WalkForward: {
+                    unsigned const steps = reader.byte() % 32u;
+                    walk(tree.lower_bound(key), std::end(tree), oracle.lower_bound(key), std::end(oracle), steps);
+                    break;
+                }
+                case fuzz_operation::WalkBackward: {
+                    unsigned steps = reader.byte() % 32u;
+                    auto it = tree.lower_bound(key);
+                    auto oracle_it = oracle.lower_bound(key);
+                    check((it == std::end(tree)) == (oracle_it == std::end(oracle)), "lower_bound disagrees with oracle");
+                    if(it != std::end(tree))
+                        check(*it == *oracle_it, "lower_bound disagrees with oracle");
+                    for(; steps && oracle_it != std::begin(oracle); --steps) {
+                        check(it != std::begin(tree), "Reverse iteration ended early");
+                        --it;
+                        --oracle_it;
+                        check(*it == *oracle_it, "Reverse iteration yielded " + std::to_string(*it) +
+                                                 ", expected " + std::to_string(*oracle_it));
+                    }
+                    if(steps)
+                        check(it == std::begin(tree), "Reverse iteration did not end");
+                    break;
+                }
+                case fuzz_operation::UpperBoundOrClear: {
+                    if(!reader.byte()) {
+                        tree.clear();
+                        oracle.clear();
+                        break;
+                    }
+                    auto it = tree.upper_bound(key);
+                    auto oracle_it = oracle.upper_bound(key);
+                    check((it == std::end(tree)) == (oracle_it == std::end(oracle)), "upper_bound disagrees with oracle");
+                    if(it != std::end(tree))
+                        check(*it == *oracle_it, "upper_bound disagrees with oracle");
+                    break;
+                }
+            }
+
+            check_invariants(tree, oracle);
+        }
+
+        walk(std::begin(tree), std::end(tree), std::begin(oracle), std::end(oracle), ~0u);
+        walk(std::rbegin(tree), std::rend(tree), std::rbegin(oracle), std::rend(oracle), ~0u);
+    }
+}
+
+/* Failures escape as exceptions, which libFuzzer reports as crashes */
+extern "C" int LLVMFuzzerTestOneInput(std::uint8_t const* data, std::size_t size) {
+    run(data, size);
+    return 0;
+}
+
+#ifndef TRBT_LIBFUZZER
+namespace {
+    bool run_input(std::vector<std::uint8_t> const& input, std::string const& name) {
+        try {
+            run(input.data(), input.size());
+        }
+        catch(std::exception const& err) {
+            std::cerr << name << ": " << err.what() << "\n";
+            return false;
+        }
+        return true;
+    }
+
+    std::vector<std::uint8_t> read_file(std::filesystem::path const& path) {
+        std::ifstream is{path, std::ios::binary};
+        return {std::istreambuf_iterator<char>{is}, std::istreambuf_iterator<char>{}};
+    }
+}
+
+int main(int argc, char** argv) {
+    std::uint64_t seed = std::random_device{}();
+    unsigned long runs = 10000u;
+    std::vector<std::filesystem::path> paths;
+
+    for(int i = 1; i < argc; i++) {
+        std::string const arg{argv[i]};
+        if((arg == "--seed" || arg == "--runs") && i + 1 < argc)
+            (arg == "--seed" ? seed : runs) = std::stoull(argv[++i]);
+        else
+            paths.emplace_back(arg);
+    }
+
+    std::size_t failures = 0u, total = 0u;
+    if(!paths.empty()) {
+        for(auto const& path : paths) {
+            if(std::filesystem::is_directory(path)) {
+                for(auto const& entry : std::filesystem::recursive_directory_iterator{path}) {
+                    if(entry.is_regular_file()) {
+                        ++total;
+                        failures += !run_input(read_file(entry.path()), entry.path().string());
+                    }
+                }
+            }
+            else {
+                ++total;
+                failures += !run_input(read_file(path), path.string());
+            }
+        }
+    }
+    else {
+        std::cout << "Seed " << seed << ", " << runs << " runs\n";
+        std::mt19937_64 mt{seed};
+        std::uniform_int_distribution<std::size_t> size_dis(0u, 4096u);
+        std::uniform_int_distribution<unsigned> byte_dis(0u, 255u);
+        for(unsigned long run = 0u; run < runs; run++) {
+            std::vector<std::uint8_t> input(size_dis(mt));
+            for(auto& b : input)
+                b = static_cast<std::uint8_t>(byte_dis(mt));
+
+            ++total;
+            auto const name = "crash-" + std::to_string(seed) + "-" + std::to_string(run);
+            if(!run_input(input, name)) {
+                ++failures;
+                std::ofstream os{name, std::ios::binary};
+                os.write(reinterpret_cast<char const*>(input.data()), static_cast<std::streamsize>(input.size()));
+            }
+        }
+    }
+
+    std::cout << total - failures << " of " << total << " inputs passed\n";
+    return failures ? 1 : 0;
+}
+#endif
@@ -2,15 +2,31 @@
 #define TRBT_H
 
 #pragma once
+#if __has_include(<version>)
+#include <version>
+#endif
+#include <algorithm>
+#include <array>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <functional>
 #include <iostream>
 #include <iterator>
+#include <limits>
 #include <memory>
+#include <optional>
 #include <stdexcept>
+#include <string>
 #include <tuple>
 #include <type_traits>
 #include <utility>
+#include <vector>
+
+#if defined __cpp_impl_three_way_comparison && defined __cpp_lib_three_way_comparison
+#include <compare>
+#define TRBT_THREE_WAY_COMPARISON
+#endif
 
 #ifdef TRBT_DEBUG
 #include <iomanip>
@@ -18,9 +34,22 @@
 #endif
 
 namespace trbt {
-    template <typename, typename, typename>
+    template <typename, typename, typename, typename...>
     class rbtree;
 
+    template <typename, typename, typename, typename...>
+    class frozen_rbtree;
+
+    template <typename>
+    struct augment;
+
+    struct allow_duplicates;
+
+    template <typename>
+    struct key_projection;
+
+    struct statistics;
+
 namespace impl {
     template <typename, typename, typename = void>
     struct is_comparable : std::false_type { };
@@ -117,12 +146,13 @@ namespace impl {
     template <typename>
     struct is_map : std::false_type { };
 
-    template <template <typename, typename, typename> typename Tree,
+    template <template <typename, typename, typename, typename...> typename Tree,
               typename Key,
               typename Mapped,
               typename Compare,
-              typename Alloc>
-    struct is_map<Tree<std::pair<Key, Mapped>, Compare, Alloc>> : std::true_type { };
+              typename Alloc,
+              typename... Policies>
+    struct is_map<Tree<std::pair<Key, Mapped>, Compare, Alloc, Policies...>> : std::true_type { };
 
     template <typename T>
     inline bool constexpr is_map_v = is_map<T>::value;
@@ -130,6 +160,117 @@ namespace impl {
     template <typename T>
     using enable_if_map_t = std::enable_if_t<is_map_v<T>>;
 
+    template <typename, typename = void>
+    struct is_augmented : std::false_type { };
+
+    template <typename T>
+    struct is_augmented<T, std::enable_if_t<!std::is_void_v<typename T::aggregate_type>>> : std::true_type { };
+
+    template <typename T>
+    inline bool constexpr is_augmented_v = is_augmented<T>::value;
+
+    template <typename T>
+    using enable_if_augmented_t = std::enable_if_t<is_augmented_v<T>>;
+
+    template <typename Policy, typename... Policies>
+    inline bool constexpr has_policy_v = (std::is_same_v<Policy, Policies> || ...);
+
+    template <typename>
+    struct allows_duplicates : std::false_type { };
+
+    template <template <typename, typename, typename, typename...> typename Tree,
+              typename Value,
+              typename Compare,
+              typename Alloc,
+              typename... Policies>
+    struct allows_duplicates<Tree<Value, Compare, Alloc, Policies...>>
+        : std::bool_constant<has_policy_v<allow_duplicates, Policies...>> { };
+
+    template <typename T>
+    inline bool constexpr allows_duplicates_v = allows_duplicates<T>::value;
+
+    template <typename>
+    struct counts_operations : std::false_type { };
+
+    template <template <typename, typename, typename, typename...> typename Tree,
+              typename Value,
+              typename Compare,
+              typename Alloc,
+              typename... Policies>
+    struct counts_operations<Tree<Value, Compare, Alloc, Policies...>>
+        : std::bool_constant<has_policy_v<statistics, Policies...>> { };
+
+    template <typename T>
+    inline bool constexpr counts_operations_v = counts_operations<T>::value;
+
+    template <typename T>
+    using enable_if_counting_t = std::enable_if_t<counts_operations_v<T>>;
+
+    /* Projection of the first key_projection in a policy pack, void if there is none */
+    template <typename... Policies>
+    struct projection_of : type_is<void> { };
+
+    template <typename Projection, typename... Policies>
+    struct projection_of<key_projection<Projection>, Policies...> : type_is<Projection> { };
+
+    template <typename Policy, typename... Policies>
+    struct projection_of<Policy, Policies...> : projection_of<Policies...> { };
+
+    template <typename... Policies>
+    using projection_of_t = typename projection_of<Policies...>::type;
+
+    template <typename>
+    struct has_key_projection : std::false_type { };
+
+    template <template <typename, typename, typename, typename...> typename Tree,
+              typename Value,
+              typename Compare,
+              typename Alloc,
+              typename... Policies>
+    struct has_key_projection<Tree<Value, Compare, Alloc, Policies...>>
+        : std::bool_constant<!std::is_void_v<projection_of_t<Policies...>>> { };
+
+    template <typename T>
+    inline bool constexpr has_key_projection_v = has_key_projection<T>::value;
+
+    /* Values are looked up by key in maps and in trees with a key projection */
+    template <typename T>
+    using enable_if_keyed_t = std::enable_if_t<is_map_v<T> || has_key_projection_v<T>>;
+
+    /* Keys of maps with duplicates do not identify a single mapped value */
+    template <typename T>
+    using enable_if_unique_map_t = std::enable_if_t<is_map_v<T> && !allows_duplicates_v<T>>;
+
+    /* Mapped values of augmented trees cannot be modified in place, as this
+     * would leave the aggregates stale */
+    template <typename T>
+    using enable_if_mutable_map_t = std::enable_if_t<is_map_v<T> && !is_augmented_v<T> && !allows_duplicates_v<T>>;
+
+    template <typename T>
+    using enable_if_augmented_map_t = std::enable_if_t<is_map_v<T> && is_augmented_v<T>>;
+
+    /* Monoid of the first augment in a policy pack, void if there is none */
+    template <typename... Policies>
+    struct augment_monoid : type_is<void> { };
+
+    template <typename Monoid, typename... Policies>
+    struct augment_monoid<augment<Monoid>, Policies...> : type_is<Monoid> { };
+
+    template <typename Policy, typename... Policies>
+    struct augment_monoid<Policy, Policies...> : augment_monoid<Policies...> { };
+
+    template <typename... Policies>
+    using augment_monoid_t = typename augment_monoid<Policies...>::type;
+
+    template <typename Monoid>
+    struct monoid_aggregate : type_is<typename Monoid::aggregate_type> { };
+
+    template <>
+    struct monoid_aggregate<void> : type_is<void> { };
+
+    template <typename Monoid>
+    using monoid_aggregate_t = typename monoid_aggregate<Monoid>::type;
+
     template <typename, typename = void>
     struct has_mapped_type : std::false_type { };
 
@@ -168,38 +309,193 @@ namespace impl {
     template <typename T, typename P0, typename... P1toN>
     inline bool constexpr is_one_of_v = is_one_of<T, P0, P1toN...>::value;
 
+    enum class Color { Red, Black };
+    enum class Direction { Left, Right };
+    enum class ValueRelation { Less = -1, 
+                               Equal, 
+                               Greater };
+
+    inline Direction operator!(Direction dir) {
+        return static_cast<Direction>(!static_cast<std::underlying_type_t<Direction>>(dir));
+    }
+
+    inline Direction dir_from_value_rel(ValueRelation rel) {
+        return static_cast<Direction>(
+                    (static_cast<std::underlying_type_t<ValueRelation>>(rel) + 1) / 2);
+    }
+
+    template <typename>
+    struct is_std_less : std::false_type { };
+
+    template <typename T>
+    struct is_std_less<std::less<T>> : std::true_type { };
+
+    template <typename T>
+    inline bool constexpr is_std_less_v = is_std_less<T>::value;
+
+    template <typename>
+    struct is_basic_string : std::false_type { };
+
+    template <typename Char, typename Traits, typename Alloc>
+    struct is_basic_string<std::basic_string<Char, Traits, Alloc>> : std::true_type { };
+
+    template <typename T>
+    inline bool constexpr is_basic_string_v = is_basic_string<T>::value;
+
+    /* Comparators may provide a three_way member function whose result 
+     * compares to 0 the same way as that of operator<=> or strcmp */
+    template <typename, typename, typename, typename = void>
+    struct has_three_way_member : std::false_type { };
+
+    template <typename Compare, typename T, typename U>
+    struct has_three_way_member<Compare, T, U, 
+                                std::void_t<decltype(std::declval<Compare const&>().three_way(
+                                                        std::declval<T const&>(), 
+                                                        std::declval<U const&>()))>>
+        : std::true_type { };
+
+    template <typename Compare, typename T, typename U>
+    inline bool constexpr has_three_way_member_v = has_three_way_member<Compare, T, U>::value;
+
+    inline ValueRelation to_value_relation(ValueRelation rel) noexcept {
+        return rel;
+    }
+
+    template <typename Ordering>
+    ValueRelation to_value_relation(Ordering const& ord) {
+        if(ord < 0)
+            return ValueRelation::Less;
+        if(ord > 0)
+            return ValueRelation::Greater;
+        return ValueRelation::Equal;
+    }
+
+    /* Relation of left to right using a single three-way comparison when Compare 
+     * or the value types support it, otherwise falls back on calling compare twice */
+    template <typename Compare, typename T, typename U>
+    ValueRelation relation(Compare const& compare, T const& left, U const& right) {
+        if constexpr(has_three_way_member_v<Compare, T, U>)
+            return to_value_relation(compare.three_way(left, right));
+        else if constexpr(is_std_less_v<Compare> && is_basic_string_v<T> && std::is_same_v<T, U>)
+            return to_value_relation(left.compare(right));
+        #ifdef TRBT_THREE_WAY_COMPARISON
+        else if constexpr(is_std_less_v<Compare> && std::three_way_comparable_with<T, U>)
+            return to_value_relation(left <=> right);
+        #endif
+        else {
+            if(compare(left, right))
+                return ValueRelation::Less;
+            if(compare(right, left))
+                return ValueRelation::Greater;
+            return ValueRelation::Equal;
+        }
+    }
+
+    /* Whether relation determines the relation of T to U using a single comparison */
+    template <typename Compare, typename T, typename U>
+    bool constexpr relation_is_single_comparison() noexcept {
+        if constexpr(has_three_way_member_v<Compare, T, U>)
+            return true;
+        else if constexpr(is_std_less_v<Compare> && is_basic_string_v<T> && std::is_same_v<T, U>)
+            return true;
+        #ifdef TRBT_THREE_WAY_COMPARISON
+        else if constexpr(is_std_less_v<Compare> && std::three_way_comparable_with<T, U>)
+            return true;
+        #endif
+        else
+            return false;
+    }
+
+    /* Wraps the comparator of a tree, counting the number of times it is called */
+    template <typename Compare>
+    struct counting_compare {
+        Compare compare{};
+        mutable std::uint64_t calls{};
+
+        template <typename T, typename U>
+        bool operator()(T const& left, U const& right) const {
+            ++calls;
+            return compare(left, right);
+        }
+
+        template <typename T, typename U>
+        ValueRelation three_way(T const& left, U const& right) const {
+            ValueRelation rel = relation(compare, left, right);
+            if constexpr(relation_is_single_comparison<Compare, T, U>())
+                ++calls;
+            else
+                calls += rel == ValueRelation::Less ? 1u : 2u;
+            return rel;
+        }
+    };
+
     template <typename, typename>
     struct pair_comparator;
 
+    /* Compares pairs, and keys with pairs, by their keys. Pairs are bound as
+     * they are, rather than converted to std::pair<K, M>, as this would copy
+     * the mapped values of std::pair<K const, M>. Provides three_way only if
+     * Compare<K> can tell equality apart using a single comparison, so that
+     * relation_is_single_comparison holds for pair_comparator exactly when it
+     * holds for Compare<K> */
     template <typename K, typename M, template  <typename> typename Compare>
     struct pair_comparator<std::pair<K, M>, Compare<std::pair<K, M>>> {
-        bool constexpr operator()(std::pair<K, M> const& left, std::pair<K, M> const& right) const {
-            return Compare<K>{}(left.first, right.first);
+        template <typename T, typename U>
+        bool constexpr operator()(T const& left, U const& right) const {
+            return Compare<K>{}(key_of(left), key_of(right));
         }
-        bool constexpr operator()(K const& left, std::pair<K, M> const& right) const {
-            return Compare<K>{}(left, right.first);
-        }
-        bool constexpr operator()(std::pair<K, M> const& left, K const& right) const {
-            return Compare<K>{}(left.first, right);
+
+        template <typename T, typename U, typename C = Compare<K>,
+                  typename = std::enable_if_t<relation_is_single_comparison<C, K, K>()>>
+        ValueRelation three_way(T const& left, U const& right) const {
+            return relation(C{}, key_of(left), key_of(right));
         }
+
+        private:
+            static K const& key_of(K const& key) noexcept {
+                return key;
+            }
+
+            template <typename Key, typename Mapped>
+            static Key const& key_of(std::pair<Key, Mapped> const& value) noexcept {
+                return value.first;
+            }
     };
 
     template <typename K, typename M, template  <typename> typename Compare>
-    struct pair_comparator<std::pair<K const, M>, Compare<std::pair<K, M>>> {
-        bool constexpr operator()(std::pair<K, M> const& left, std::pair<K, M> const& right) const {
-            return Compare<K>{}(left.first, right.first);
+    struct pair_comparator<std::pair<K const, M>, Compare<std::pair<K, M>>>
+        : pair_comparator<std::pair<K, M>, Compare<std::pair<K, M>>> { };
+
+    /* Compares values, and keys with values, by the keys Projection yields
+     * for the values. Compare orders keys */
+    template <typename Value, typename Compare, typename Projection>
+    struct projected_comparator {
+        using key_type = remove_cvref_t<std::invoke_result_t<Projection const&, Value const&>>;
+
+        template <typename T, typename U>
+        bool constexpr operator()(T const& left, U const& right) const {
+            return Compare{}(key_of(left), key_of(right));
         }
-        bool constexpr operator()(K const& left, std::pair<K, M> const& right) const {
-            return Compare<K>{}(left, right.first);
-        }
-        bool constexpr operator()(std::pair<K, M> const& left, K const& right) const {
-            return Compare<K>{}(left.first, right);
+
+        template <typename T, typename U, typename C = Compare,
+                  typename = std::enable_if_t<relation_is_single_comparison<C, key_type, key_type>()>>
+        ValueRelation three_way(T const& left, U const& right) const {
+            return relation(C{}, key_of(left), key_of(right));
         }
+
+        private:
+            static decltype(auto) key_of(Value const& value) {
+                return Projection{}(value);
+            }
+
+            static key_type const& key_of(key_type const& key) noexcept {
+                return key;
+            }
     };
 
     template <typename Compare, typename T, typename U>
     bool equals(T const& left, U const& right) {
-        return !Compare{}(left, right) && !Compare{}(right, left);
+        return relation(Compare{}, left, right) == ValueRelation::Equal;
     }
 
     template <typename T, typename Compare>
@@ -211,6 +507,25 @@ namespace impl {
     template <typename T, typename Compare>
     using key_compare_t = typename key_compare<T, Compare>::type;
 
+    /* Key compare of a tree, which compares projected keys if it has a projection */
+    template <typename T, typename Compare, typename Projection>
+    struct projected_key_compare : type_is<projected_comparator<T, Compare, Projection>> { };
+
+    template <typename T, typename Compare>
+    struct projected_key_compare<T, Compare, void> : key_compare<T, Compare> { };
+
+    template <typename T, typename Compare, typename Projection>
+    using projected_key_compare_t = typename projected_key_compare<T, Compare, Projection>::type;
+
+    template <typename T, typename Projection>
+    struct projected_key_type : type_is<remove_cvref_t<std::invoke_result_t<Projection const&, T const&>>> { };
+
+    template <typename T>
+    struct projected_key_type<T, void> : key_type<T> { };
+
+    template <typename T, typename Projection>
+    using projected_key_type_t = typename projected_key_type<T, Projection>::type;
+
     template <typename T, typename Compare>
     struct value_compare : type_is<Compare> { };
 
@@ -278,21 +593,6 @@ namespace impl {
     template <typename T>
     inline bool constexpr requests_reverse_v = requests_reverse<T>::value;
 
-    enum class Color { Red, Black };
-    enum class Direction { Left, Right };
-    enum class ValueRelation { Less = -1, 
-                               Equal, 
-                               Greater };
-
-    inline Direction operator!(Direction dir) {
-        return static_cast<Direction>(!static_cast<std::underlying_type_t<Direction>>(dir));
-    }
-
-    inline Direction dir_from_value_rel(ValueRelation rel) {
-        return static_cast<Direction>(
-                    (static_cast<std::underlying_type_t<ValueRelation>>(rel) + 1) / 2);
-    }
-
     
     template <typename T>
     inline bool bit_is_set(T const& value, unsigned bitnum) noexcept {
@@ -300,17 +600,95 @@ namespace impl {
         
         return value & (1 << bitnum);
     }
-    template <typename Value>
-    struct node {
-        static_assert(!std::is_const_v<std::remove_reference_t<Value>>, 
-                      "Value type should never be const");
-    
+    /* Flag handling shared by both node layouts */
+    template <typename Node>
+    struct node_flags {
         static unsigned char constexpr RIGHT_BIT    = 0x1;
         static unsigned char constexpr LEFT_BIT     = 0x2;
         static unsigned char constexpr SENTINEL_BIT = 0x4;
         static unsigned char constexpr COLOR_BIT    = 0x8;
         static unsigned char constexpr LEAF         = LEFT_BIT | RIGHT_BIT;
-        
+
+        Color color() const noexcept {
+            return static_cast<Color>((self().flags & COLOR_BIT) == COLOR_BIT);
+        }
+
+        void set_color(Color color) noexcept {
+            if(color == Color::Black)
+                self().flags |= COLOR_BIT;
+            else
+                self().flags &= ~COLOR_BIT;
+        }
+
+        bool is_leaf() const noexcept {
+            return (self().flags & LEAF) == LEAF;
+        }
+
+        bool is_sentinel() const noexcept {
+            return self().flags & SENTINEL_BIT;
+        }
+    
+        bool has_left_child() const noexcept {
+            return !(self().flags & LEFT_BIT);
+        }
+
+        bool has_right_child() const noexcept {
+            return !(self().flags & RIGHT_BIT);
+        }
+    
+        void set_left_thread() noexcept {
+            self().flags |= LEFT_BIT;
+        }
+
+        void set_right_thread() noexcept {
+            self().flags |= RIGHT_BIT;
+        }
+
+        void unset_left_thread() noexcept {
+            self().flags &= ~LEFT_BIT;
+        }
+
+        void unset_right_thread() noexcept {
+            self().flags &= ~RIGHT_BIT;
+        }
+
+        static unsigned char to_color_bit(Color color) noexcept {
+            return static_cast<unsigned char>(color) * COLOR_BIT;
+        }
+
+        private:
+            Node& self() noexcept {
+                return static_cast<Node&>(*this);
+            }
+
+            Node const& self() const noexcept {
+                return static_cast<Node const&>(*this);
+            }
+    };
+
+    template <typename Value>
+    inline bool constexpr is_trivial_node_value_v = std::is_trivially_copyable_v<Value> && 
+                                                    std::is_trivially_destructible_v<Value>;
+
+    /* Aggregate of the values in the subtree rooted at a node, stored by trees
+     * with an augmentation policy only */
+    template <typename Aggregate>
+    struct node_aggregate {
+        Aggregate aggregate{};
+    };
+
+    template <>
+    struct node_aggregate<void> { };
+
+    template <typename Value, typename Aggregate = void, 
+              bool = is_trivial_node_value_v<Value> && is_trivial_node_value_v<node_aggregate<Aggregate>>>
+    struct node : node_flags<node<Value, Aggregate, false>>, node_aggregate<Aggregate> {
+        static_assert(!std::is_const_v<std::remove_reference_t<Value>>, 
+                      "Value type should never be const");
+
+        using node_flags<node>::LEAF;
+        using node_flags<node>::SENTINEL_BIT;
+        using node_flags<node>::to_color_bit;
 
         alignas(Value) unsigned char storage[sizeof(Value)];
         node *left, *right;
@@ -326,13 +704,13 @@ namespace impl {
             : left{ln}, right{rn}, flags((threaded & LEAF) | SENTINEL_BIT | to_color_bit(color)) { }
 
         node(node const& other) 
-            : left{other.left}, right{other.right}, flags{other.flags} {
+            : node_flags<node>{}, node_aggregate<Aggregate>(other), left{other.left}, right{other.right}, flags{other.flags} {
             if(!(other.flags & SENTINEL_BIT))
                 new (storage) Value(other.value());
         }
     
         node(node&& other) 
-            : left{other.left}, right{other.right}, flags{other.flags} {
+            : node_flags<node>{}, node_aggregate<Aggregate>(std::move(other)), left{other.left}, right{other.right}, flags{other.flags} {
             if(!(other.flags & SENTINEL_BIT))
                 new (storage) Value(std::move(other.value()));
         }
@@ -340,6 +718,7 @@ namespace impl {
         node& operator=(node const& other) & {
             if(!(other.flags & SENTINEL_BIT))
                 new (storage) Value(other.value());
+            node_aggregate<Aggregate>::operator=(other);
             left   = other.left;
             right  = other.right;
             flags  = other.flags;
@@ -350,6 +729,7 @@ namespace impl {
         node& operator=(node&& other) & {
             if(!(other.flags & SENTINEL_BIT))
                 new (storage) Value(std::move(other.value()));
+            node_aggregate<Aggregate>::operator=(std::move(other));
             left   = other.left;
             right  = other.right;
             flags  = other.flags;
@@ -366,53 +746,46 @@ namespace impl {
             return *reinterpret_cast<Value*>(storage);
         }
         
-        Value value() const noexcept {
+        Value const& value() const noexcept {
             return *reinterpret_cast<Value const*>(storage);
         }
+    };
 
-        Color color() const noexcept {
-            return static_cast<Color>((flags & COLOR_BIT) == COLOR_BIT);
-        }
-
-        void set_color(Color color) noexcept {
-            if(color == Color::Black)
-                flags |= COLOR_BIT;
-            else
-                flags &= ~COLOR_BIT;
-        }
+    /* Node for trivially copyable and destructible values. The value is stored
+     * directly after the links, followed by the flags, so small values fill the
+     * padding that would otherwise follow them. Copying, moving and destroying 
+     * are trivial, so nodes may be copied with memcpy and no destructor calls
+     * or sentinel checks are needed. The value of the sentinel is never read */
+    template <typename Value, typename Aggregate>
+    struct node<Value, Aggregate, true> : node_flags<node<Value, Aggregate, true>>, node_aggregate<Aggregate> {
+        static_assert(!std::is_const_v<std::remove_reference_t<Value>>, 
+                      "Value type should never be const");
 
-        bool is_leaf() const noexcept {
-            return (flags & LEAF) == LEAF;
-        }
-    
-        bool has_left_child() const noexcept {
-            return !(flags & LEFT_BIT);
-        }
+        using node_flags<node>::LEAF;
+        using node_flags<node>::SENTINEL_BIT;
+        using node_flags<node>::to_color_bit;
 
-        bool has_right_child() const noexcept {
-            return !(flags & RIGHT_BIT);
-        }
-    
-        void set_left_thread() noexcept {
-            flags |= LEFT_BIT;
-        }
+        node *left, *right;
+        union {
+            Value val;
+            unsigned char none;
+        };
+        unsigned char flags;
 
-        void set_right_thread() noexcept {
-            flags |= RIGHT_BIT;
-        }
+        template <typename T = Value, typename = disable_if_same_t<T, node>>
+        node(T&& value, node* ln, node* rn, Color color, unsigned char threaded) 
+            : left{ln}, right{rn}, val(std::forward<T>(value)), flags((threaded & LEAF) | to_color_bit(color)) { }
 
-        void unset_left_thread() noexcept {
-            flags &= ~LEFT_BIT;
-        }
+        node(node* ln, node* rn, Color color, unsigned char threaded)
+            : left{ln}, right{rn}, none{}, flags((threaded & LEAF) | SENTINEL_BIT | to_color_bit(color)) { }
 
-        void unset_right_thread() noexcept {
-            flags &= ~RIGHT_BIT;
+        Value& value() noexcept {
+            return val;
         }
-
-        static unsigned char to_color_bit(Color color) noexcept {
-            return static_cast<unsigned char>(color) * COLOR_BIT;
+        
+        Value const& value() const noexcept {
+            return val;
         }
-
     };
 
     #ifdef TRBT_DEBUG
@@ -445,14 +818,14 @@ namespace impl {
         template <typename, typename>
         friend class const_iterator_type;
 
-        using node_type           = node<typename Container::value_type>;
+        using node_type           = typename Container::node_type;
 
         /* If Container has mapped_type, reference and pointer should be allowed to modify values,
-         * otherwise they should be const */
-        using container_reference = std::conditional_t<has_mapped_type_v<Container>,
+         * otherwise, or if Container keeps aggregates of the values, they should be const */
+        using container_reference = std::conditional_t<has_mapped_type_v<Container> && !is_augmented_v<Container>,
                                                        typename Container::reference,
                                                        add_const_if_ref_t<typename Container::reference>>;
-        using container_pointer   = std::conditional_t<has_mapped_type_v<Container>,
+        using container_pointer   = std::conditional_t<has_mapped_type_v<Container> && !is_augmented_v<Container>,
                                                        typename Container::pointer,
                                                        add_const_if_ptr_t<typename Container::pointer>>;
         public:
@@ -468,11 +841,9 @@ namespace impl {
                                                          container_pointer>;
             using const_pointer     = typename Container::const_pointer;
 
-            explicit iterator_base(Container* cont) : parent_{cont}, current_{parent_->sentinel_} { }
-            iterator_base(Container* cont, node_type* t) : parent_{cont}, current_{t} { }
+            explicit iterator_base(node_type* t) noexcept : current_{t} { }
 
             Derived& operator=(Derived const& rhs) & {
-                this->parent_ = rhs.parent_;
                 this->current_ = rhs.current_;
                 return static_cast<Derived&>(*this);
             }
@@ -499,9 +870,9 @@ namespace impl {
             #endif
             Derived& operator++() {
                 if constexpr(requests_reverse_v<ReverseTag>) 
-                    this->current_ = this->parent_->predecessor(this->current_);
+                    this->current_ = backward(this->current_);
                 else 
-                    this->current_ = this->parent_->successor(this->current_);
+                    this->current_ = Container::successor(this->current_);
 
                 return static_cast<Derived&>(*this);
             }
@@ -514,9 +885,9 @@ namespace impl {
 
             Derived& operator--() {
                 if constexpr(requests_reverse_v<ReverseTag>)
-                    this->current_ = this->parent_->successor(this->current_);
+                    this->current_ = Container::successor(this->current_);
                 else
-                    this->current_ = this->parent_->predecessor(this->current_);
+                    this->current_ = backward(this->current_);
                 return static_cast<Derived&>(*this);
             }
 
@@ -546,8 +917,17 @@ namespace impl {
             }
 
         protected:
-            Container* parent_;
             node_type* current_;
+
+        private:
+            /* The sentinel's left link is a thread to itself, while its right
+             * link points to the root. Stepping forward from the sentinel thus
+             * reaches the leftmost node, stepping backward needs special care */
+            static node_type* backward(node_type* t) noexcept {
+                if(t->is_sentinel())
+                    return t->has_right_child() ? Container::rightmost(t->right) : t;
+                return Container::predecessor(t);
+            }
     };
 
     template <typename, typename>
@@ -566,17 +946,17 @@ namespace impl {
             using const_pointer     = typename base::const_pointer;
 
             using base::base;
-            iterator_type(iterator_type const& other) : base{other.parent_, other.current_} { }
+            iterator_type(iterator_type const& other) noexcept : base{other.current_} { }
 
             operator const_iterator_type<Container, ReverseTag>() {
-                return const_iterator_type<Container, ReverseTag>{this->parent_, this->current_};
+                return const_iterator_type<Container, ReverseTag>{this->current_};
             }
     };
 
     template <typename Container, typename ReverseTag>
     class const_iterator_type : public iterator_base<const_iterator_type<Container const, ReverseTag>, Container const, const_tag, ReverseTag> {
 
-        template <typename, typename, typename>
+        template <typename, typename, typename, typename...>
         friend class trbt::rbtree;
         
         using base = iterator_base<const_iterator_type<Container const, ReverseTag>, Container const, const_tag, ReverseTag>;
@@ -591,11 +971,10 @@ namespace impl {
 
             using base::base;
     
-            const_iterator_type(const_iterator_type const& other) : base{other.parent_, other.current_} { }
-            const_iterator_type(iterator_type<Container, ReverseTag> const& other) : base{other.parent_, other.current_} { }
+            const_iterator_type(const_iterator_type const& other) noexcept : base{other.current_} { }
+            const_iterator_type(iterator_type<Container, ReverseTag> const& other) noexcept : base{other.current_} { }
 
             const_iterator_type& operator=(iterator_type<Container, ReverseTag> const& other) & {
-                this->parent_ = other.parent_;
                 this->current_ = other.current_;
                 return *this;
             }
@@ -610,25 +989,364 @@ namespace impl {
     template <typename Container>
     using const_reverse_iterator = const_iterator_type<Container, reverse_tag>;
 
-} /* namespace impl */
+    /* Iterators of frozen_rbtree refer to an index in the Eytzinger layout. Index
+     * 0 is never occupied and plays the role of the sentinel in rbtree */
+    template <typename Container, typename ReverseTag>
+    class frozen_iterator_type {
+        public:
+            using value_type        = typename Container::value_type;
+            using difference_type   = std::ptrdiff_t;
+            using iterator_category = std::bidirectional_iterator_tag;
+            using reference         = typename Container::const_reference;
+            using const_reference   = typename Container::const_reference;
+            using pointer           = typename Container::const_pointer;
+            using const_pointer     = typename Container::const_pointer;
+            using size_type         = typename Container::size_type;
 
-template <typename Value, 
-          typename Compare = std::less<Value>, 
-          typename Allocator = std::allocator<impl::add_const_to_key_if_pair<impl::remove_cvref_t<Value>>>>
-class rbtree {
+            frozen_iterator_type(Container const* cont, size_type index) 
+                : parent_{cont}, index_{index} { }
+
+            friend bool operator==(frozen_iterator_type const& left, frozen_iterator_type const& right) noexcept {
+                return left.index_ == right.index_;
+            }
+
+            friend bool operator!=(frozen_iterator_type const& left, frozen_iterator_type const& right) noexcept {
+                return !(left == right);
+            }
+
+            frozen_iterator_type& operator++() {
+                if constexpr(requests_reverse_v<ReverseTag>)
+                    index_ = parent_->predecessor(index_);
+                else
+                    index_ = parent_->successor(index_);
+                return *this;
+            }
+
+            frozen_iterator_type operator++(int) {
+                auto prev = *this;
+                ++*this;
+                return prev;
+            }
+
+            frozen_iterator_type& operator--() {
+                if constexpr(requests_reverse_v<ReverseTag>)
+                    index_ = parent_->successor(index_);
+                else
+                    index_ = parent_->predecessor(index_);
+                return *this;
+            }
+
+            frozen_iterator_type operator--(int) {
+                auto next = *this;
+                --*this;
+                return next;
+            }
+
+            reference operator*() const {
+                return parent_->data_[index_];
+            }
+
+            pointer operator->() const {
+                return std::addressof(parent_->data_[index_]);
+            }
+
+        private:
+            Container const* parent_;
+            size_type index_;
+    };
+
+    inline unsigned trailing_ones(std::size_t value) noexcept {
+        #if defined __GNUC__
+        return static_cast<unsigned>(__builtin_ctzll(~static_cast<unsigned long long>(value)));
+        #else
+        unsigned count = 0u;
+        for(; value & 1u; value >>= 1u)
+            ++count;
+        return count;
+        #endif
+    }
+
+    inline unsigned trailing_zeros(std::size_t value) noexcept {
+        return trailing_ones(~value);
+    }
+
+    inline void prefetch(void const* addr) noexcept {
+        #if defined __GNUC__
+        __builtin_prefetch(addr);
+        #else
+        static_cast<void>(addr);
+        #endif
+    }
+
+} /* namespace impl */
+
+namespace execution {
+    /* Execution policies tell the reductions of rbtree how many ranges to
+     * split the values into and how to run a task on every range. This one
+     * runs a single range on the calling thread, see trbt_parallel.h for
+     * a parallel one */
+    struct sequenced_policy {
+        std::size_t chunks() const noexcept {
+            return 1u;
+        }
+
+        template <typename Task>
+        void run(std::size_t count, Task&& task) const {
+            for(std::size_t i = 0u; i < count; i++)
+                task(i);
+        }
+    };
+
+    inline sequenced_policy constexpr seq{};
+} /* namespace execution */
+
+/* Policy making rbtree store in every node the aggregate of the values in its
+ * subtree under Monoid, which must be default constructible and provide
+ *
+ *     using aggregate_type = ...;
+ *     aggregate_type identity() const;
+ *     aggregate_type lift(value_type const& value) const;
+ *     aggregate_type combine(aggregate_type const& left, aggregate_type const& right) const;
+ *
+ * where combine is associative, though not necessarily commutative, and
+ * identity is its neutral element. Aggregates of the values in any range
+ * are then available in O(log n) */
+template <typename Monoid>
+struct augment {
+    using monoid_type = Monoid;
+};
+
+/* Policy making rbtree store equal values side by side rather than rejecting
+ * all but the first. Equal values are kept in insertion order */
+struct allow_duplicates { };
+
+/* Policy making rbtree order its values by the keys Projection yields for
+ * them, Projection being default constructible and providing
+ *
+ *     key_type operator()(value_type const& value) const;
+ *
+ * which may return a reference into value. Compare then orders keys, and
+ * values may be looked up by their key alone. As only the keys decide where
+ * values are stored, the rest of the values may be modified in place through
+ * iterators. The tree cannot tell the key apart from the rest of a value, so
+ * writing to the key through a mutable iterator compiles but breaks the
+ * order of the tree. Declaring the key member const rules this out */
+template <typename Projection>
+struct key_projection {
+    using projection_type = Projection;
+};
+
+/* Policy making rbtree count the work it performs, as returned by counters.
+ * Trees without it hold neither the counters nor the code updating them */
+struct statistics { };
+
+/* Projection used by the monoids below unless given another one */
+struct identity_projection {
+    template <typename T>
+    T const& operator()(T const& value) const noexcept {
+        return value;
+    }
+};
+
+/* Sum of the projected values */
+template <typename T, typename Projection = identity_projection>
+struct sum_monoid {
+    using aggregate_type = T;
+
+    aggregate_type identity() const {
+        return aggregate_type{};
+    }
+
+    template <typename Value>
+    aggregate_type lift(Value const& value) const {
+        return static_cast<aggregate_type>(Projection{}(value));
+    }
+
+    aggregate_type combine(aggregate_type const& left, aggregate_type const& right) const {
+        return left + right;
+    }
+};
+
+/* Maximum of the projected values, the lowest value of T if there are none */
+template <typename T, typename Projection = identity_projection>
+struct max_monoid {
+    using aggregate_type = T;
+
+    aggregate_type identity() const {
+        return std::numeric_limits<aggregate_type>::lowest();
+    }
+
+    template <typename Value>
+    aggregate_type lift(Value const& value) const {
+        return static_cast<aggregate_type>(Projection{}(value));
+    }
+
+    aggregate_type combine(aggregate_type const& left, aggregate_type const& right) const {
+        return left < right ? right : left;
+    }
+};
+
+/* Default per-value codecs used by rbtree::save and rbtree::load. Trivially
+ * copyable values are written as raw bytes, strings as their length followed
+ * by their characters and pairs as their two members. Custom codecs must
+ * provide the same encode and decode member functions */
+template <typename T, typename = void>
+struct codec;
+
+template <typename T>
+struct codec<T, std::enable_if_t<std::is_trivially_copyable_v<T> && !impl::is_pair_v<T>>> {
+    void encode(std::ostream& os, T const& value) const {
+        os.write(reinterpret_cast<char const*>(std::addressof(value)), sizeof(T));
+    }
+
+    T decode(std::istream& is) const {
+        T value;
+        is.read(reinterpret_cast<char*>(std::addressof(value)), sizeof(T));
+        return value;
+    }
+};
+
+template <typename Char, typename Traits, typename Alloc>
+struct codec<std::basic_string<Char, Traits, Alloc>> {
+    void encode(std::ostream& os, std::basic_string<Char, Traits, Alloc> const& value) const {
+        codec<std::uint64_t>{}.encode(os, value.size());
+        os.write(reinterpret_cast<char const*>(value.data()), 
+                 static_cast<std::streamsize>(value.size() * sizeof(Char)));
+    }
+
+    std::basic_string<Char, Traits, Alloc> decode(std::istream& is) const {
+        auto const size = codec<std::uint64_t>{}.decode(is);
+        if(!is)
+            return {};
+
+        /* Read in chunks so that a corrupt length fails on the stream 
+         * rather than on a huge allocation */
+        std::basic_string<Char, Traits, Alloc> value;
+        Char buffer[256];
+        for(std::uint64_t remaining = size; remaining && is; ) {
+            auto const chunk = remaining < std::size(buffer) ? remaining : std::size(buffer);
+            is.read(reinterpret_cast<char*>(buffer), static_cast<std::streamsize>(chunk * sizeof(Char)));
+            value.append(buffer, static_cast<std::size_t>(chunk));
+            remaining -= chunk;
+        }
+        return value;
+    }
+};
+
+template <typename K, typename M>
+struct codec<std::pair<K, M>> {
+    void encode(std::ostream& os, std::pair<K, M> const& value) const {
+        codec<std::remove_const_t<K>>{}.encode(os, value.first);
+        codec<std::remove_const_t<M>>{}.encode(os, value.second);
+    }
+
+    std::pair<K, M> decode(std::istream& is) const {
+        auto first = codec<std::remove_const_t<K>>{}.decode(is);
+        auto second = codec<std::remove_const_t<M>>{}.decode(is);
+        return {std::move(first), std::move(second)};
+    }
+};
+
+/* Work performed by a tree since it was created or its counters were last
+ * reset. Only collected by trees with the statistics policy. Descent depths are 
+ * measured in nodes visited by a single search, insertion or erasure */
+struct operation_counters {
+    std::uint64_t comparisons{};
+    std::uint64_t left_rotations{};
+    std::uint64_t right_rotations{};
+    std::uint64_t insert_recolors{};
+    std::uint64_t remove_recolors{};
+    std::uint64_t allocations{};
+    std::uint64_t deallocations{};
+    std::uint64_t descents{};
+    std::uint64_t total_descent_depth{};
+    std::uint64_t max_descent_depth{};
+    std::uint64_t last_descent_depth{};
+
+    void begin_descent() noexcept {
+        ++descents;
+        last_descent_depth = 0u;
+    }
+
+    void descend() noexcept {
+        ++total_descent_depth;
+        if(++last_descent_depth > max_descent_depth)
+            max_descent_depth = last_descent_depth;
+    }
+};
+
+/* Shape and memory usage of a tree as reported by rbtree::stats. Depths are
+ * counted in nodes, i.e. the root has depth 1. An unsuccessful search ends
+ * at one of the size + 1 empty links, its depth is that of the node holding
+ * the link. Padding is the part of each node not occupied by the value, the 
+ * links or the flags */
+struct tree_statistics {
+    std::size_t size{};
+    std::size_t height{};
+    std::size_t black_height{};
+    std::vector<std::size_t> depth_histogram{};
+    double average_successful_depth{};
+    double average_unsuccessful_depth{};
+    std::size_t red_nodes{};
+    std::size_t black_nodes{};
+    std::size_t node_bytes{};
+    std::size_t value_bytes{};
+    std::size_t padding_bytes{};
+    std::size_t sentinel_bytes{};
+};
+
+namespace impl {
+    /* Counters of trees with the statistics policy. Other trees derive from
+     * the empty primary template, which takes up no space */
+    template <bool Counting>
+    struct counter_storage { };
+
+    template <>
+    struct counter_storage<true> {
+        mutable operation_counters counters_{};
+    };
+} /* namespace impl */
+
+/* Discarded unless the tree counts its operations, in which case counters_ exists */
+#define TRBT_COUNT(...) do { if constexpr(counting) static_cast<void>(this->counters_.__VA_ARGS__); } while(false)
+
+template <typename Value, 
+          typename Compare = std::less<Value>, 
+          typename Allocator = std::allocator<impl::add_const_to_key_if_pair_t<impl::remove_cvref_t<Value>>>,
+          typename... Policies>
+class rbtree : private impl::counter_storage<impl::has_policy_v<statistics, Policies...>> {
     static_assert(!std::is_reference_v<Value>, "Value type must not be a reference");
     /* No need for remove_cvref since the previous assert would have triggered */
     static_assert(!std::is_const_v<Value>, "Value type must not be const");
     static_assert(!std::is_volatile_v<Value>, "Value type must not be volatile");
-    static_assert(impl::is_comparable_v<impl::remove_cvref_t<Value>,
-                                        impl::key_compare_t<impl::remove_cvref_t<Value>, Compare>>, 
-                                        "Value type is not comparable");
 
     template <typename, typename, typename, typename>
     friend class impl::iterator_base;
 
+    using monoid_type     = impl::augment_monoid_t<Policies...>;
+    using projection_type = impl::projection_of_t<Policies...>;
+    static bool constexpr augmented = !std::is_void_v<monoid_type>;
+    static bool constexpr multi = impl::has_policy_v<allow_duplicates, Policies...>;
+    static bool constexpr projected = !std::is_void_v<projection_type>;
+    static bool constexpr counting = impl::has_policy_v<statistics, Policies...>;
+
+    /* Keys of maps are the first members of their values */
+    static_assert(!(projected && impl::is_pair_v<Value>), "Maps cannot have a key projection");
+    static_assert(impl::is_comparable_v<impl::remove_cvref_t<Value>,
+                                        impl::projected_key_compare_t<impl::remove_cvref_t<Value>, Compare, projection_type>>,
+                                        "Value type is not comparable");
+
+    /* Bound searches stop at a value equal to the one searched for only if
+     * telling equality apart costs no additional comparison and the value
+     * equal to it is unique. Otherwise one comparison per level suffices */
+    static bool constexpr three_way_search = !multi &&
+        impl::relation_is_single_comparison<impl::projected_key_compare_t<impl::remove_cvref_t<Value>, Compare, projection_type>,
+                                            impl::value_type_t<impl::remove_cvref_t<Value>>,
+                                            impl::value_type_t<impl::remove_cvref_t<Value>>>();
+
     using Alloc     = typename std::allocator_traits<Allocator>::template 
-                                    rebind_alloc<impl::node<impl::value_type_t<impl::remove_cvref_t<Value>>>>;
+                                    rebind_alloc<impl::node<impl::value_type_t<impl::remove_cvref_t<Value>>,
+                                                            impl::monoid_aggregate_t<monoid_type>>>;
     using Color         = impl::Color;
     using Direction     = impl::Direction;
     using ValueRelation = impl::ValueRelation;
@@ -640,19 +1358,20 @@ class rbtree {
     #endif
 
     public:
-        using key_type               = impl::key_type_t<impl::remove_cvref_t<Value>>;
+        using key_type               = impl::projected_key_type_t<impl::remove_cvref_t<Value>, projection_type>;
         using mapped_type            = impl::mapped_type_t<impl::remove_cvref_t<Value>>;
         using value_type             = impl::value_type_t<impl::remove_cvref_t<Value>>;
         using size_type              = std::size_t;
         using difference_type        = std::ptrdiff_t;
-        using key_compare            = impl::key_compare_t<impl::remove_cvref_t<Value>, Compare>;
-        using value_compare          = impl::value_compare_t<impl::remove_cvref_t<Value>, Compare>;
+        using key_compare            = impl::projected_key_compare_t<impl::remove_cvref_t<Value>, Compare, projection_type>;
+        using value_compare          = std::conditional_t<projected, key_compare, impl::value_compare_t<impl::remove_cvref_t<Value>, Compare>>;
         using allocator_type         = Allocator;
         using reference              = value_type&;
         using const_reference        = value_type const&;
         using pointer                = typename std::allocator_traits<Allocator>::pointer;
         using const_pointer          = typename std::allocator_traits<Allocator>::const_pointer;
-        using node_type              = impl::node<value_type>;
+        using aggregate_type         = impl::monoid_aggregate_t<monoid_type>;
+        using node_type              = impl::node<value_type, aggregate_type>;
         using iterator               = impl::iterator<rbtree>;
         using const_iterator         = impl::const_iterator<rbtree>;
         using reverse_iterator       = impl::reverse_iterator<rbtree>;
@@ -686,10 +1405,18 @@ class rbtree {
 
         allocator_type get_allocator() const;
 
+        tree_statistics stats() const;
+
         #ifdef TRBT_DEBUG
         void print(std::ostream& os = std::cout) const;
         #endif
 
+        /* Work counted by trees with the statistics policy */
+        template <typename T = rbtree, typename = impl::enable_if_counting_t<T>>
+        operation_counters counters() const noexcept;
+        template <typename T = rbtree, typename = impl::enable_if_counting_t<T>>
+        void reset_counters() noexcept;
+
         template <typename T = value_type, typename = impl::enable_if_convertible_t<T, value_type>>
         std::pair<iterator, bool> insert(T&& value);
         template <typename InputIt, typename = impl::enable_if_iterator_t<InputIt>>
@@ -706,20 +1433,58 @@ class rbtree {
 
         size_type erase(value_type const& value);
 
+        /* Removes the value equal to value, the first of them if there are
+         * several, and returns it moved out of the tree */
+        std::optional<value_type> extract_value(value_type const& value);
+
+        /* As above, given only the key of the value, so that values need not
+         * be constructed to be taken out of maps and trees with a key
+         * projection */
+        template <typename T = rbtree, typename = impl::enable_if_keyed_t<T>>
+        std::optional<value_type> take(key_type const& key);
+
+        /* Smallest and greatest value, the tree must not be empty */
+        const_reference min() const;
+        const_reference max() const;
+
+        /* Remove and return the smallest or greatest value, the first or last
+         * of them if there are several. The extreme node is reached without
+         * any comparisons */
+        std::optional<value_type> pop_min();
+        std::optional<value_type> pop_max();
+
+        /* Removes and returns the k smallest values, in order */
+        std::vector<value_type> pop_min_n(size_type k);
+
         bool contains(value_type const& value) const;
         size_type count(value_type const& value) const;
         iterator find(value_type const& value);
         const_iterator find(value_type const& value) const;
 
-        template <typename T = rbtree, typename = impl::enable_if_map_t<T>>
+        /* Lookups by key alone in maps and trees with a key projection */
+        template <typename T = rbtree, typename = impl::enable_if_keyed_t<T>>
+        bool contains(key_type const& key) const;
+        template <typename T = rbtree, typename = impl::enable_if_keyed_t<T>>
+        iterator find(key_type const& key);
+        template <typename T = rbtree, typename = impl::enable_if_keyed_t<T>>
+        const_iterator find(key_type const& key) const;
+
+        template <typename T = rbtree, typename = impl::enable_if_mutable_map_t<T>>
         mapped_type& operator[](key_type const& key);
-        template <typename T = rbtree, typename = impl::enable_if_map_t<T>>
+        template <typename T = rbtree, typename = impl::enable_if_mutable_map_t<T>>
         mapped_type& operator[](key_type&& key);
-        template <typename T = rbtree, typename = impl::enable_if_map_t<T>>
+        template <typename T = rbtree, typename = impl::enable_if_mutable_map_t<T>>
         mapped_type& at(key_type const& key);
-        template <typename T = rbtree, typename = impl::enable_if_map_t<T>>
+        template <typename T = rbtree, typename = impl::enable_if_unique_map_t<T>>
         mapped_type const& at(key_type const& key) const;
 
+        frozen_rbtree<Value, Compare, Allocator, Policies...> freeze() const;
+
+        template <typename Codec = codec<value_type>>
+        void save(std::ostream& os, Codec const& cdc = Codec{}) const;
+        template <typename Codec = codec<value_type>>
+        void load(std::istream& is, Codec const& cdc = Codec{});
+
         void swap(rbtree& other) noexcept(std::allocator_traits<Allocator>::is_always_equal::value &&
                                                   std::is_nothrow_swappable<Compare>::value);
 
@@ -729,6 +1494,78 @@ class rbtree {
         iterator upper_bound(value_type const& value);
         const_iterator upper_bound(value_type const& value) const;
 
+        std::pair<iterator, iterator> equal_range(value_type const& value);
+        std::pair<const_iterator, const_iterator> equal_range(value_type const& value) const;
+
+        /* Calls f with every value, in order or in reverse order, by following
+         * the threads directly rather than going through iterators. The next
+         * node is prefetched while f runs. Returns f */
+        template <typename F>
+        F for_each(F f);
+        template <typename F>
+        F for_each(F f) const;
+        template <typename F>
+        F for_each_reverse(F f);
+        template <typename F>
+        F for_each_reverse(F f) const;
+
+        /* As above, restricted to the values in [first, last) */
+        template <typename F>
+        F for_each(const_iterator first, const_iterator last, F f);
+        template <typename F>
+        F for_each(const_iterator first, const_iterator last, F f) const;
+
+        /* As above, restricted to the values in [lo, hi] */
+        template <typename F>
+        F for_each_in_range(value_type const& lo, value_type const& hi, F f);
+        template <typename F>
+        F for_each_in_range(value_type const& lo, value_type const& hi, F f) const;
+        template <typename F>
+        F for_each_in_range_reverse(value_type const& lo, value_type const& hi, F f);
+        template <typename F>
+        F for_each_in_range_reverse(value_type const& lo, value_type const& hi, F f) const;
+
+        /* Splits the values into at most k non-empty, contiguous ranges, in
+         * order, of roughly equal size. Sizes are estimated from the shape of
+         * the tree, so this takes O(k log n) rather than linear time */
+        std::vector<std::pair<const_iterator, const_iterator>> split_ranges(size_type k) const;
+        /* As above, restricted to the values in [lo, hi] */
+        std::vector<std::pair<const_iterator, const_iterator>> split_ranges(value_type const& lo, value_type const& hi, size_type k) const;
+
+        /* Reductions over the values in [lo, hi]. The values are split into
+         * policy.chunks() ranges, which policy.run reduces independently of
+         * each other before their results are combined with init in order.
+         * The result is therefore the same under any policy as long as op is
+         * associative, and reproducible for a given number of chunks even
+         * if it is not, as with floating point addition */
+        template <typename ExecutionPolicy, typename T, typename BinaryOp>
+        T reduce(ExecutionPolicy&& policy, value_type const& lo, value_type const& hi, T init, BinaryOp op) const;
+
+        template <typename ExecutionPolicy, typename T, typename BinaryOp, typename UnaryOp>
+        T transform_reduce(ExecutionPolicy&& policy, value_type const& lo, value_type const& hi,
+                           T init, BinaryOp reduce, UnaryOp transform) const;
+
+        template <typename ExecutionPolicy, typename Predicate>
+        size_type count_if(ExecutionPolicy&& policy, value_type const& lo, value_type const& hi, Predicate pred) const;
+
+        /* Aggregate of all values, or of those in [lo, hi], under the monoid
+         * of the augmentation policy. Takes O(1) and O(log n) respectively */
+        template <typename T = rbtree, typename = impl::enable_if_augmented_t<T>>
+        aggregate_type aggregate() const;
+        template <typename T = rbtree, typename = impl::enable_if_augmented_t<T>>
+        aggregate_type aggregate(value_type const& lo, value_type const& hi) const;
+
+        /* Calls f with the mapped value at pos and updates the aggregates
+         * depending on it, as they cannot be modified through iterators */
+        template <typename F, typename T = rbtree, typename = impl::enable_if_augmented_map_t<T>>
+        void modify(const_iterator pos, F f);
+
+        /* Calls f, in order, with the values of every subtree whose aggregate
+         * satisfies keep, skipping the others as a whole, until f returns
+         * false. Returns whether all values visited were passed to f */
+        template <typename Keep, typename F, typename T = rbtree, typename = impl::enable_if_augmented_t<T>>
+        bool for_each_pruned(Keep keep, F f) const;
+
         #ifdef TRBT_DEBUG
         template <typename StringConverter>
         void assert_properties_ok(StringConverter sc) const;
@@ -751,18 +1588,18 @@ class rbtree {
         const_reverse_iterator crbegin() const noexcept;
         const_reverse_iterator crend() const noexcept;
 
-        template <typename Val_, typename Comp_, typename Alloc_>
-        friend bool operator==(rbtree<Val_, Comp_, Alloc_> const& left, rbtree<Val_, Comp_, Alloc_> const& right) noexcept;
-        template <typename Val_, typename Comp_, typename Alloc_>
-        friend bool operator!=(rbtree<Val_, Comp_, Alloc_> const& left, rbtree<Val_, Comp_, Alloc_> const& right) noexcept;
-        template <typename Val_, typename Comp_, typename Alloc_>
-        friend bool operator<(rbtree<Val_, Comp_, Alloc_> const& left, rbtree<Val_, Comp_, Alloc_> const& right) noexcept;
-        template <typename Val_, typename Comp_, typename Alloc_>
-        friend bool operator<=(rbtree<Val_, Comp_, Alloc_> const& left, rbtree<Val_, Comp_, Alloc_> const& right) noexcept;
-        template <typename Val_, typename Comp_, typename Alloc_>
-        friend bool operator>(rbtree<Val_, Comp_, Alloc_> const& left, rbtree<Val_, Comp_, Alloc_> const& right) noexcept;
-        template <typename Val_, typename Comp_, typename Alloc_>
-        friend bool operator>=(rbtree<Val_, Comp_, Alloc_> const& left, rbtree<Val_, Comp_, Alloc_> const& right) noexcept;
+        template <typename Val_, typename Comp_, typename Alloc_, typename... Pol_>
+        friend bool operator==(rbtree<Val_, Comp_, Alloc_, Pol_...> const& left, rbtree<Val_, Comp_, Alloc_, Pol_...> const& right) noexcept;
+        template <typename Val_, typename Comp_, typename Alloc_, typename... Pol_>
+        friend bool operator!=(rbtree<Val_, Comp_, Alloc_, Pol_...> const& left, rbtree<Val_, Comp_, Alloc_, Pol_...> const& right) noexcept;
+        template <typename Val_, typename Comp_, typename Alloc_, typename... Pol_>
+        friend bool operator<(rbtree<Val_, Comp_, Alloc_, Pol_...> const& left, rbtree<Val_, Comp_, Alloc_, Pol_...> const& right) noexcept;
+        template <typename Val_, typename Comp_, typename Alloc_, typename... Pol_>
+        friend bool operator<=(rbtree<Val_, Comp_, Alloc_, Pol_...> const& left, rbtree<Val_, Comp_, Alloc_, Pol_...> const& right) noexcept;
+        template <typename Val_, typename Comp_, typename Alloc_, typename... Pol_>
+        friend bool operator>(rbtree<Val_, Comp_, Alloc_, Pol_...> const& left, rbtree<Val_, Comp_, Alloc_, Pol_...> const& right) noexcept;
+        template <typename Val_, typename Comp_, typename Alloc_, typename... Pol_>
+        friend bool operator>=(rbtree<Val_, Comp_, Alloc_, Pol_...> const& left, rbtree<Val_, Comp_, Alloc_, Pol_...> const& right) noexcept;
 
     private:
         node_type* sentinel_{nullptr};
@@ -770,18 +1607,25 @@ class rbtree {
         node_type* rightmost_{nullptr};
         size_type size_{};
         Alloc allocator_{};
-        key_compare compare_{};
+        std::conditional_t<counting, impl::counting_compare<key_compare>, key_compare> compare_{};
 
         template <typename T = value_type>
         inline node_type* allocate_node(T&& value, node_type* ln, node_type* rn, Color col, unsigned char thread);
         inline node_type* allocate_node(node_type* ln, node_type* rn, Color col, unsigned char thread);
+        inline void deallocate_node(node_type* node) noexcept;
 
         void init(unsigned char thread);
         void clear(node_type* current) noexcept;
 
         node_type* clone(node_type* pred, node_type* succ, node_type* other);
 
-        node_type* find(value_type const& value, node_type* current) const;
+        template <typename Generator>
+        node_type* build_sorted(size_type count, size_type depth, size_type red_depth, 
+                                node_type* pred, node_type*& last, Generator& next);
+
+        /* The private searches take either values or keys */
+        template <typename T>
+        node_type* find(T const& value, node_type* current) const;
 
         node_type* link(node_type* node, Direction dir) const;
         static node_type* leftmost(node_type* root);
@@ -789,16 +1633,31 @@ class rbtree {
         static inline node_type* successor(node_type* node);
         static inline node_type* predecessor(node_type* node);
 
-        static node_type* left_rotate(node_type* root, node_type* parent);
-        static node_type* right_rotate(node_type* root, node_type* parent);
-        static inline node_type* left_right_rotate(node_type* root, node_type* parent);
-        static inline node_type* right_left_rotate(node_type* root, node_type* parent);
-        static inline node_type* left_left_rotate(node_type* root, node_type* parent);
-        static inline node_type* right_right_rotate(node_type* root, node_type* parent);
+        /* Recompute the aggregate of node from those of its children, of node
+         * and all its ancestors respectively */
+        void update(node_type* node) const;
+        void update_path(node_type* node) const;
+
+        node_type* left_rotate(node_type* root, node_type* parent);
+        node_type* right_rotate(node_type* root, node_type* parent);
+        inline node_type* left_right_rotate(node_type* root, node_type* parent);
+        inline node_type* right_left_rotate(node_type* root, node_type* parent);
+        inline node_type* left_left_rotate(node_type* root, node_type* parent);
+        inline node_type* right_right_rotate(node_type* root, node_type* parent);
 
         void recolor_insert(node_type* current, node_type* parent, node_type* grandparent, node_type* great_grandparent);
         void recolor_remove(Direction dir, node_type* current, node_type*& parent, node_type* grandparent, node_type* sibling);
 
+        /* Parent of node, found by following the threads out of its subtree
+         * rather than by comparisons, in time proportional to the height of
+         * node. The parent of the root is the sentinel */
+        node_type* parent_of(node_type* node) const;
+
+        /* Restores the red-black properties bottom-up after node has been
+         * linked in as a red leaf. Recoloring moves up two levels at a time
+         * and takes amortized O(1) steps, a rotation ends the repair */
+        void rebalance_inserted(node_type* node);
+
         void enqueue_as_left_child(node_type* new_node, node_type* current);
         void enqueue_as_right_child(node_type* new_node, node_type* current);
 
@@ -822,11 +1681,44 @@ class rbtree {
         template <typename... Args>
         std::pair<iterator, bool> emplace(node_type* current, Args&&... args);
         
-        size_type erase(value_type const& value, node_type* current);
+        /* Unlinks a node holding value, the first of them if there are
+         * several, and returns it without deallocating it. Returns nullptr if
+         * there is none */
+        template <typename T>
+        node_type* remove(T const& value, node_type* current);
+
+        /* Unlinks and returns the leftmost or rightmost node, the tree must
+         * not be empty */
+        node_type* remove_extreme(Direction side);
 
-        node_type* lower_bound(value_type const& value, node_type* current) const;
+        /* Unlinks node, which must be in the tree, without searching for it.
+         * The tree is repaired bottom-up, with the ancestors found through
+         * parent_of rather than by comparisons */
+        void unlink(node_type* node);
+
+        /* Restores the red-black properties after the subtree on side dir of
+         * parent has lost a black node */
+        void rebalance_removed(node_type* parent, Direction dir);
+
+        template <typename T>
+        node_type* lower_bound(T const& value, node_type* current) const;
         node_type* upper_bound(value_type const& value, node_type* current) const;
 
+        /* Lower and upper bound found in a single descent, which only splits
+         * in two at the first value equal to value */
+        std::pair<node_type*, node_type*> equal_range(value_type const& value, node_type* current) const;
+
+        /* Nodes delimiting [lo, hi] in order, the second one being past the end */
+        std::pair<node_type*, node_type*> range_bounds(value_type const& lo, value_type const& hi) const;
+
+        std::vector<std::pair<const_iterator, const_iterator>> split_ranges(value_type const* lo, value_type const* hi, size_type k) const;
+
+        /* Calls f with the values from first up to, but not including, last */
+        template <typename Reference, bool Reverse, typename F>
+        F traverse(node_type* first, node_type* last, F f) const;
+        template <typename Reference, typename F>
+        F traverse_range_reverse(value_type const& lo, value_type const& hi, F f) const;
+
         #ifdef TRBT_DEBUG
         void print(node_type* t, std::ostream& os, unsigned indentation = 0) const;
         #endif
@@ -872,43 +1764,43 @@ rbtree(Pair<Key, Mapped>...)
 
 
 /* Member functions */
-template <typename Value, typename Compare, typename Allocator>
-rbtree<Value, Compare, Allocator>::rbtree() {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+rbtree<Value, Compare, Allocator, Policies...>::rbtree() {
     init(node_type::LEAF);
 }
 
-template <typename Value, typename Compare, typename Allocator>
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
 template <typename T, typename>
-rbtree<Value, Compare, Allocator>::rbtree(T&& value) {
+rbtree<Value, Compare, Allocator, Policies...>::rbtree(T&& value) {
     init(node_type::LEFT_BIT);
     sentinel_->right = allocate_node(std::forward<T>(value), sentinel_, sentinel_, Color::Black, node_type::LEAF);
     leftmost_ = rightmost_ = sentinel_->right;
 }
 
-template <typename Value, typename Compare, typename Allocator>
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
 template <typename... Args, typename>
-rbtree<Value, Compare, Allocator>::rbtree(Args&&... values) {
+rbtree<Value, Compare, Allocator, Policies...>::rbtree(Args&&... values) {
     init(node_type::LEAF);
     (insert(std::forward<Args>(values)), ...);
 }
 
-template <typename Value, typename Compare, typename Allocator>
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
 template <typename InputIt, typename>
-rbtree<Value, Compare, Allocator>::rbtree(InputIt first, InputIt last) {
+rbtree<Value, Compare, Allocator, Policies...>::rbtree(InputIt first, InputIt last) {
     init(node_type::LEAF);
     insert(first, last);
 }
 
-template <typename Value, typename Compare, typename Allocator>
-rbtree<Value, Compare, Allocator>::rbtree(rbtree const& other) {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+rbtree<Value, Compare, Allocator, Policies...>::rbtree(rbtree const& other) {
     init(other.sentinel_->flags);
     size_ = other.size_;
     if(!other.sentinel_->is_leaf()) 
         sentinel_->right = clone(sentinel_, sentinel_, other.sentinel_->right);
 }
 
-template <typename Value, typename Compare, typename Allocator>
-rbtree<Value, Compare, Allocator>::rbtree(rbtree&& other) 
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+rbtree<Value, Compare, Allocator, Policies...>::rbtree(rbtree&& other) 
     : sentinel_{other.sentinel_}, leftmost_{other.leftmost_}, rightmost_{other.rightmost_},
       size_{other.size_} {
 
@@ -917,15 +1809,15 @@ rbtree<Value, Compare, Allocator>::rbtree(rbtree&& other)
     other.size_ = 0u;
 }
 
-template <typename Value, typename Compare, typename Allocator>
-rbtree<Value, Compare, Allocator>::~rbtree() {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+rbtree<Value, Compare, Allocator, Policies...>::~rbtree() {
     clear();
-    allocator_.deallocate(sentinel_, 1u);
+    deallocate_node(sentinel_);
 }
 
-template <typename Value, typename Compare, typename Allocator>
-rbtree<Value, Compare, Allocator>& 
-rbtree<Value, Compare, Allocator>::operator=(rbtree const& other) & {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+rbtree<Value, Compare, Allocator, Policies...>& 
+rbtree<Value, Compare, Allocator, Policies...>::operator=(rbtree const& other) & {
     auto cpy{other};
     std::swap(sentinel_, cpy.sentinel_);
     std::swap(size_, cpy.size_);
@@ -934,9 +1826,9 @@ rbtree<Value, Compare, Allocator>::operator=(rbtree const& other) & {
     return *this;
 }
 
-template <typename Value, typename Compare, typename Allocator>
-rbtree<Value, Compare, Allocator>& 
-rbtree<Value, Compare, Allocator>::operator=(rbtree&& other) & {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+rbtree<Value, Compare, Allocator, Policies...>& 
+rbtree<Value, Compare, Allocator, Policies...>::operator=(rbtree&& other) & {
     std::swap(sentinel_, other.sentinel_);
     std::swap(size_, other.size_);
     std::swap(leftmost_, other.leftmost_);
@@ -944,25 +1836,25 @@ rbtree<Value, Compare, Allocator>::operator=(rbtree&& other) & {
     return *this;
 }
 
-template <typename Value, typename Compare, typename Allocator>
-bool rbtree<Value, Compare, Allocator>::empty() const {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+bool rbtree<Value, Compare, Allocator, Policies...>::empty() const {
     return !sentinel_->has_right_child();
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::size_type
-rbtree<Value, Compare, Allocator>::size() const noexcept {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::size_type
+rbtree<Value, Compare, Allocator, Policies...>::size() const noexcept {
     return size_;
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::size_type
-rbtree<Value, Compare, Allocator>::max_size() const noexcept {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::size_type
+rbtree<Value, Compare, Allocator, Policies...>::max_size() const noexcept {
     return std::allocator_traits<Alloc>::max_size(allocator_);
 }
 
-template <typename Value, typename Compare, typename Allocator>
-void rbtree<Value, Compare, Allocator>::clear() noexcept {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+void rbtree<Value, Compare, Allocator, Policies...>::clear() noexcept {
     if(!empty()) {
         clear(sentinel_->right);
         
@@ -973,15 +1865,90 @@ void rbtree<Value, Compare, Allocator>::clear() noexcept {
     }
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::allocator_type 
-rbtree<Value, Compare, Allocator>::get_allocator() const {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::allocator_type 
+rbtree<Value, Compare, Allocator, Policies...>::get_allocator() const {
     return allocator_;
 }
 
+/* Single pass over all nodes using an explicit stack, the size of which is 
+ * bounded by the height of the tree */
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+tree_statistics rbtree<Value, Compare, Allocator, Policies...>::stats() const {
+    std::size_t aggregate_bytes = 0u;
+    if constexpr(augmented)
+        aggregate_bytes = sizeof(aggregate_type);
+
+    tree_statistics st;
+    st.size = size_;
+    st.node_bytes = size_ * sizeof(node_type);
+    st.value_bytes = size_ * sizeof(value_type);
+    st.padding_bytes = size_ * (sizeof(node_type) - sizeof(value_type) - aggregate_bytes -
+                                sizeof(sentinel_->left) - sizeof(sentinel_->right) - sizeof(sentinel_->flags));
+    st.sentinel_bytes = sizeof(node_type);
+
+    if(empty())
+        return st;
+
+    for(node_type* current = sentinel_->right; ; current = current->left) {
+        st.black_height += current->color() == Color::Black;
+        if(!current->has_left_child())
+            break;
+    }
+
+    std::size_t successful = 0u, unsuccessful = 0u;
+    std::vector<std::pair<node_type*, std::size_t>> stack{{sentinel_->right, 1u}};
+    while(!stack.empty()) {
+        auto [current, depth] = stack.back();
+        stack.pop_back();
+
+        if(st.depth_histogram.size() < depth)
+            st.depth_histogram.resize(depth);
+        ++st.depth_histogram[depth - 1u];
+
+        if(current->color() == Color::Red)
+            ++st.red_nodes;
+        else
+            ++st.black_nodes;
+
+        successful += depth;
+
+        if(current->has_left_child())
+            stack.emplace_back(current->left, depth + 1u);
+        else
+            unsuccessful += depth;
+
+        if(current->has_right_child())
+            stack.emplace_back(current->right, depth + 1u);
+        else
+            unsuccessful += depth;
+    }
+
+    st.height = st.depth_histogram.size();
+    st.average_successful_depth = static_cast<double>(successful) / static_cast<double>(size_);
+    st.average_unsuccessful_depth = static_cast<double>(unsuccessful) / static_cast<double>(size_ + 1u);
+
+    return st;
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename, typename>
+operation_counters rbtree<Value, Compare, Allocator, Policies...>::counters() const noexcept {
+    operation_counters snapshot = this->counters_;
+    snapshot.comparisons = compare_.calls;
+    return snapshot;
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename, typename>
+void rbtree<Value, Compare, Allocator, Policies...>::reset_counters() noexcept {
+    this->counters_ = operation_counters{};
+    compare_.calls = 0u;
+}
+
 #ifdef TRBT_DEBUG
-template <typename Value, typename Compare, typename Allocator>
-void rbtree<Value, Compare, Allocator>::print(std::ostream& os) const {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+void rbtree<Value, Compare, Allocator, Policies...>::print(std::ostream& os) const {
     if(empty())
         os << "Tree is empty\n";
     else
@@ -989,236 +1956,787 @@ void rbtree<Value, Compare, Allocator>::print(std::ostream& os) const {
 }
 #endif
 
-template <typename Value, typename Compare, typename Allocator>
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
 template <typename T, typename>
-std::pair<typename rbtree<Value, Compare, Allocator>::iterator, bool> 
-rbtree<Value, Compare, Allocator>::insert(T&& value) {
+std::pair<typename rbtree<Value, Compare, Allocator, Policies...>::iterator, bool> 
+rbtree<Value, Compare, Allocator, Policies...>::insert(T&& value) {
     if(empty()) {
         node_type* node = insert_empty(std::forward<T>(value));
         
-        return {iterator{this, node}, true};
+        return {iterator{node}, true};
     }
     return insert(std::forward<T>(value), sentinel_->right);
 }
 
-template <typename Value, typename Compare, typename Allocator>
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
 template <typename InputIt, typename>
-void rbtree<Value, Compare, Allocator>::insert(InputIt first, InputIt last) {
+void rbtree<Value, Compare, Allocator, Policies...>::insert(InputIt first, InputIt last) {
     while(first != last)
         insert(*first++);
 }
 
-template <typename Value, typename Compare, typename Allocator>
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
 template <typename T, typename>
-typename rbtree<Value, Compare, Allocator>::iterator
-rbtree<Value, Compare, Allocator>::insert(const_iterator hint, T&& value) {
-    using impl::equals;
+typename rbtree<Value, Compare, Allocator, Policies...>::iterator
+rbtree<Value, Compare, Allocator, Policies...>::insert(const_iterator hint, T&& value) {
+    if(empty())
+        return iterator{insert_empty(std::forward<T>(value))};
+
+    node_type* succ = hint.current_;
+    node_type* pred = succ == sentinel_ ? rightmost_ : predecessor(succ);
+
+    /* The hint is correct if value belongs between pred and succ. If so, value
+     * cannot be in the tree and is linked in between them without any further
+     * comparisons */
+    if constexpr(multi) {
+        /* Equal values go after pred but before succ, so as to come after those already in the tree */
+        if((succ != sentinel_ && !compare_(value, succ->value())) || (pred != sentinel_ && compare_(value, pred->value())))
+            return insert(std::forward<T>(value)).first;
+    }
+    else if(succ != sentinel_) {
+        if(auto rel = impl::relation(compare_, value, succ->value()); rel == ValueRelation::Equal)
+            return iterator{succ};
+        else if(rel == ValueRelation::Greater)
+            return insert(std::forward<T>(value)).first;
+    }
+    if(!multi && pred != sentinel_) {
+        if(auto rel = impl::relation(compare_, pred->value(), value); rel == ValueRelation::Equal)
+            return iterator{pred};
+        else if(rel == ValueRelation::Greater)
+            return insert(std::forward<T>(value)).first;
+    }
 
-    bool suitable_hint = hint.current_->color() == Color::Black &&
-                                 !hint.current_->has_left_child() &&
-                                  hint != end() &&
-                                  compare_(value, hint.current_->value());
+    node_type* new_node = allocate_node(std::forward<T>(value), nullptr, nullptr, 
+                                        Color::Red, node_type::LEAF);
 
-    if(suitable_hint) {
-        if(hint.current_->left != sentinel_ &&
-                equals<key_compare>(value, hint.current_->left->value())) 
-        {
-            return iterator{this, hint.current_->left};;
-        }
+    /* Either succ has no left child or pred, the rightmost node of its left
+     * subtree, has no right child. The new node takes that link, so no
+     * descent from the root is needed */
+    if(succ != sentinel_ && !succ->has_left_child())
+        enqueue_as_left_child(new_node, succ);
+    else
+        enqueue_as_right_child(new_node, pred);
 
-        node_type* node = allocate_node(std::forward<T>(value), nullptr, nullptr, Color::Red, node_type::LEAF);
-        enqueue_as_left_child(node, hint.current_);
+    rebalance_inserted(new_node);
 
-        return iterator{this, node};
-    }
-    
-    return insert(std::forward<T>(value)).first;
+    if constexpr(augmented)
+        update_path(new_node);
+
+    return iterator{new_node};
 }
 
-template <typename Value, typename Compare, typename Allocator>
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
 template <typename... Args>
-std::pair<typename rbtree<Value, Compare, Allocator>::iterator, bool> 
-rbtree<Value, Compare, Allocator>::emplace(Args&&... args) {
+std::pair<typename rbtree<Value, Compare, Allocator, Policies...>::iterator, bool> 
+rbtree<Value, Compare, Allocator, Policies...>::emplace(Args&&... args) {
     if(empty()) {
         node_type* node = emplace_empty(std::forward<Args>(args)...);
 
-        return {iterator{this, node}, true};
+        return {iterator{node}, true};
     }
     return emplace(sentinel_->right, std::forward<Args>(args)...);
 }
 
-template <typename Value, typename Compare, typename Allocator>
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
 template <typename... Args>
-typename rbtree<Value, Compare, Allocator>::iterator
-rbtree<Value, Compare, Allocator>::emplace_hint(const_iterator hint, Args&&... args) {
-    using impl::equals;
+typename rbtree<Value, Compare, Allocator, Policies...>::iterator
+rbtree<Value, Compare, Allocator, Policies...>::emplace_hint(const_iterator hint, Args&&... args) {
+    return insert(hint, value_type{std::forward<Args>(args)...});
+}
 
-    value_type value{std::forward<Args>(args)...};
-    bool suitable_hint = hint.current_->color() == Color::Black &&
-                                   !hint.current_->has_left_child() &&
-                                    hint != end() &&
-                                    compare_(value, hint.current_->value());;
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::size_type
+rbtree<Value, Compare, Allocator, Policies...>::erase(value_type const& value) {
+    if(empty())
+        return 0u;
 
-    if(suitable_hint) {
-        if(hint.current_->left != sentinel_ && 
-                equals<Compare>(value, hint.current_->left->value()))
-        {
-            return iterator{this, hint.current_->left};
+    /* The equal values are found in a single descent and unlinked one after
+     * the other without any further comparisons */
+    if constexpr(multi) {
+        auto [first, last] = equal_range(value, sentinel_->right);
+        size_type n = 0u;
+        while(first != last) {
+            node_type* next = successor(first);
+            unlink(first);
+            deallocate_node(first);
+            first = next;
+            ++n;
         }
+        return n;
+    }
+    else {
+        node_type* node = remove(value, sentinel_->right);
+        if(!node)
+            return 0u;
 
-        node_type* node = allocate_node(std::move(value), nullptr, nullptr, Color::Red, node_type::LEAF);
-        enqueue_as_left_child(node, hint.current_);
-
-        return iterator{this, node};
+        deallocate_node(node);
+        return 1u;
     }
-    
-    return emplace(std::move(value)).first;
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+std::optional<typename rbtree<Value, Compare, Allocator, Policies...>::value_type>
+rbtree<Value, Compare, Allocator, Policies...>::extract_value(value_type const& value) {
+    if(empty())
+        return std::nullopt;
+
+    node_type* node = remove(value, sentinel_->right);
+    if(!node)
+        return std::nullopt;
 
+    std::optional<value_type> extracted{std::move(node->value())};
+    deallocate_node(node);
+    return extracted;
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::size_type
-rbtree<Value, Compare, Allocator>::erase(value_type const& value) {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename, typename>
+std::optional<typename rbtree<Value, Compare, Allocator, Policies...>::value_type>
+rbtree<Value, Compare, Allocator, Policies...>::take(key_type const& key) {
     if(empty())
-        return 0u;
-    
-    return erase(value, sentinel_->right);
+        return std::nullopt;
+
+    node_type* node = remove(key, sentinel_->right);
+    if(!node)
+        return std::nullopt;
+
+    std::optional<value_type> taken{std::move(node->value())};
+    deallocate_node(node);
+    return taken;
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::const_reference
+rbtree<Value, Compare, Allocator, Policies...>::min() const {
+    return leftmost_->value();
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::const_reference
+rbtree<Value, Compare, Allocator, Policies...>::max() const {
+    return rightmost_->value();
 }
 
-template <typename Value, typename Compare, typename Allocator>
-bool rbtree<Value, Compare, Allocator>::contains(value_type const& value) const  {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+std::optional<typename rbtree<Value, Compare, Allocator, Policies...>::value_type>
+rbtree<Value, Compare, Allocator, Policies...>::pop_min() {
     if(empty())
-        return false;
+        return std::nullopt;
 
-    node_type* current = sentinel_->right;
+    node_type* node = remove_extreme(Direction::Left);
+    std::optional<value_type> popped{std::move(node->value())};
+    deallocate_node(node);
+    return popped;
+}
 
-    while(true) {
-        if(compare_(value, current->value())) {
-            if(current->has_left_child())
-                current = current->left;
-            else
-                return false;
-        }
-        else if(compare_(current->value(), value)) {
-            if(current->has_right_child())
-                current = current->right;
-            else
-                return false;
-        }
-        else
-            break;
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+std::optional<typename rbtree<Value, Compare, Allocator, Policies...>::value_type>
+rbtree<Value, Compare, Allocator, Policies...>::pop_max() {
+    if(empty())
+        return std::nullopt;
+
+    node_type* node = remove_extreme(Direction::Right);
+    std::optional<value_type> popped{std::move(node->value())};
+    deallocate_node(node);
+    return popped;
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+std::vector<typename rbtree<Value, Compare, Allocator, Policies...>::value_type>
+rbtree<Value, Compare, Allocator, Policies...>::pop_min_n(size_type k) {
+    std::vector<value_type> popped;
+    popped.reserve(std::min(k, size()));
+
+    /* Draining the whole tree needs no rebalancing */
+    if(k >= size()) {
+        traverse<value_type&, false>(leftmost_, sentinel_, [&popped](value_type& value) {
+            popped.push_back(std::move(value));
+        });
+        clear();
+        return popped;
     }
 
-    return true;
+    while(k--) {
+        node_type* node = remove_extreme(Direction::Left);
+        popped.push_back(std::move(node->value()));
+        deallocate_node(node);
+    }
+    return popped;
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+bool rbtree<Value, Compare, Allocator, Policies...>::contains(value_type const& value) const  {
+    if(empty())
+        return false;
+
+    return find(value, sentinel_->right) != sentinel_;
 } 
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::size_type
-rbtree<Value, Compare, Allocator>::count(value_type const& value) const {
-    return static_cast<size_type>(contains(value));
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::size_type
+rbtree<Value, Compare, Allocator, Policies...>::count(value_type const& value) const {
+    if constexpr(multi) {
+        if(empty())
+            return 0u;
+
+        size_type n = 0u;
+        for(node_type* node = find(value, sentinel_->right); node != sentinel_ && !compare_(value, node->value()); node = successor(node))
+            ++n;
+        return n;
+    }
+    else
+        return static_cast<size_type>(contains(value));
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::iterator 
-rbtree<Value, Compare, Allocator>::find(value_type const& value) {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::iterator 
+rbtree<Value, Compare, Allocator, Policies...>::find(value_type const& value) {
     if(empty())
         return end();
     
-    return iterator{this, find(value, sentinel_->right)};
+    return iterator{find(value, sentinel_->right)};
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::const_iterator 
-rbtree<Value, Compare, Allocator>::find(value_type const& value) const {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::const_iterator 
+rbtree<Value, Compare, Allocator, Policies...>::find(value_type const& value) const {
     if(empty())
         return cend();
     
-    return const_iterator{this, find(value, sentinel_->right)};
+    return const_iterator{find(value, sentinel_->right)};
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename, typename>
+bool rbtree<Value, Compare, Allocator, Policies...>::contains(key_type const& key) const {
+    if(empty())
+        return false;
+
+    return find(key, sentinel_->right) != sentinel_;
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename, typename>
+typename rbtree<Value, Compare, Allocator, Policies...>::iterator 
+rbtree<Value, Compare, Allocator, Policies...>::find(key_type const& key) {
+    if(empty())
+        return end();
+
+    return iterator{find(key, sentinel_->right)};
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename, typename>
+typename rbtree<Value, Compare, Allocator, Policies...>::const_iterator 
+rbtree<Value, Compare, Allocator, Policies...>::find(key_type const& key) const {
+    if(empty())
+        return cend();
+
+    return const_iterator{find(key, sentinel_->right)};
 }
 
-template <typename Value, typename Compare, typename Allocator>
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
 template <typename, typename>
-typename rbtree<Value, Compare, Allocator>::mapped_type& 
-rbtree<Value, Compare, Allocator>::operator[](key_type const& key) {
-    return (*insert(std::pair{key, mapped_type{}}, sentinel_->right)).second;
+typename rbtree<Value, Compare, Allocator, Policies...>::mapped_type& 
+rbtree<Value, Compare, Allocator, Policies...>::operator[](key_type const& key) {
+    return (*insert(std::pair{key, mapped_type{}}, sentinel_->right).first).second;
 }
 
-template <typename Value, typename Compare, typename Allocator>
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
 template <typename, typename>
-typename rbtree<Value, Compare, Allocator>::mapped_type& 
-rbtree<Value, Compare, Allocator>::operator[](key_type&& key) {
+typename rbtree<Value, Compare, Allocator, Policies...>::mapped_type& 
+rbtree<Value, Compare, Allocator, Policies...>::operator[](key_type&& key) {
     return (*insert(std::pair{std::move(key), mapped_type{}}, sentinel_->right).first).second;
 }
 
-template <typename Value, typename Compare, typename Allocator>
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
 template <typename, typename>
-typename rbtree<Value, Compare, Allocator>::mapped_type& 
-rbtree<Value, Compare, Allocator>::at(key_type const& key) {
+typename rbtree<Value, Compare, Allocator, Policies...>::mapped_type& 
+rbtree<Value, Compare, Allocator, Policies...>::at(key_type const& key) {
 
-    if(auto it = find(std::pair{key, mapped_type{}}); it != end())
+    if(auto it = find(key); it != end())
         return it->second;
 
     throw std::out_of_range{"Specified key not in tree"};
 }
 
-template <typename Value, typename Compare, typename Allocator>
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
 template <typename, typename>
-typename rbtree<Value, Compare, Allocator>::mapped_type const& 
-rbtree<Value, Compare, Allocator>::at(key_type const& key) const {
+typename rbtree<Value, Compare, Allocator, Policies...>::mapped_type const& 
+rbtree<Value, Compare, Allocator, Policies...>::at(key_type const& key) const {
 
-    if(auto it = find(std::pair{key, mapped_type{}}); it != end())
+    if(auto it = find(key); it != end())
         return it->second;
 
     throw std::out_of_range{"Specified key not in tree"};
 }
 
-template <typename Value, typename Compare, typename Allocator>
-void rbtree<Value, Compare, Allocator>::swap(rbtree& other) noexcept(std::allocator_traits<Allocator>::is_always_equal::value &&
-                                                        std::is_nothrow_swappable<Compare>::value) {
-    std::swap(sentinel_, other.sentinel_);
-    std::swap(size_, other.size_);
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+frozen_rbtree<Value, Compare, Allocator, Policies...> rbtree<Value, Compare, Allocator, Policies...>::freeze() const {
+    return frozen_rbtree<Value, Compare, Allocator, Policies...>{*this};
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::iterator 
-rbtree<Value, Compare, Allocator>::lower_bound(value_type const& value) {
-    if(empty())
-        return end();
+/* Writes the number of values followed by each value, in order */
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename Codec>
+void rbtree<Value, Compare, Allocator, Policies...>::save(std::ostream& os, Codec const& cdc) const {
+    codec<std::uint64_t>{}.encode(os, size_);
+    for(node_type* current = leftmost_; current != sentinel_ && os; current = successor(current))
+        cdc.encode(os, current->value());
 
-    return iterator{this, lower_bound(value, sentinel_->right)};
+    if(!os)
+        throw std::ios_base::failure{"Unable to write tree to stream"};
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::const_iterator 
-rbtree<Value, Compare, Allocator>::lower_bound(value_type const& value) const {
-    if(empty())
-        return end();
+/* Replaces the contents of the tree with values written by save. As the
+ * values are known to be sorted, the tree is built in a single pass without
+ * any comparisons, holding only one decoded value at a time */
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename Codec>
+void rbtree<Value, Compare, Allocator, Policies...>::load(std::istream& is, Codec const& cdc) {
+    clear();
 
-    return const_iterator{this, lower_bound(value, sentinel_->right)};
-}
+    auto const count = codec<std::uint64_t>{}.decode(is);
+    if(!is)
+        throw std::ios_base::failure{"Unable to read tree size from stream"};
+    if(!count)
+        return;
+
+    auto next = [&is, &cdc]() {
+        value_type value = cdc.decode(is);
+        if(!is)
+            throw std::ios_base::failure{"Unexpected end of stream while reading tree"};
+        return value;
+    };
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::iterator 
-rbtree<Value, Compare, Allocator>::upper_bound(value_type const& value) {
-    if(empty())
-        return end();
+    /* All levels but the deepest are full. Coloring the nodes on the deepest 
+     * level red, provided it is not the root, satisfies the red-black properties */
+    size_type height = 0u;
+    while(count >> (height + 1u))
+        ++height;
 
-    return iterator{this, upper_bound(value, sentinel_->right)};
-}
+    node_type* last = nullptr;
+    try {
+        sentinel_->right = build_sorted(count, 0u, height ? height : 1u, sentinel_, last, next);
+    }
+    catch(...) {
+        /* Walk the values built so far from the last one backwards */
+        while(last && last != sentinel_) {
+            node_type* pred = predecessor(last);
+            deallocate_node(last);
+            last = pred;
+        }
+        sentinel_->right = sentinel_;
+        throw;
+    }
 
-template <typename Value, typename Compare, typename Allocator> 
-typename rbtree<Value, Compare, Allocator>::const_iterator 
-rbtree<Value, Compare, Allocator>::upper_bound(value_type const& value) const {
+    last->right = sentinel_;
+    sentinel_->unset_right_thread();
+    leftmost_ = leftmost(sentinel_->right);
+    rightmost_ = last;
+    size_ = count;
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+void rbtree<Value, Compare, Allocator, Policies...>::swap(rbtree& other) noexcept(std::allocator_traits<Allocator>::is_always_equal::value &&
+                                                        std::is_nothrow_swappable<Compare>::value) {
+    using std::swap;
+    swap(sentinel_, other.sentinel_);
+    swap(size_, other.size_);
+    swap(leftmost_, other.leftmost_);
+    swap(rightmost_, other.rightmost_);
+    swap(compare_, other.compare_);
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::iterator 
+rbtree<Value, Compare, Allocator, Policies...>::lower_bound(value_type const& value) {
     if(empty())
         return end();
 
-    return const_iterator{this, upper_bound(value, sentinel_->right)};
+    return iterator{lower_bound(value, sentinel_->right)};
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::const_iterator 
+rbtree<Value, Compare, Allocator, Policies...>::lower_bound(value_type const& value) const {
+    if(empty())
+        return end();
+
+    return const_iterator{lower_bound(value, sentinel_->right)};
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::iterator 
+rbtree<Value, Compare, Allocator, Policies...>::upper_bound(value_type const& value) {
+    if(empty())
+        return end();
+
+    return iterator{upper_bound(value, sentinel_->right)};
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies> 
+typename rbtree<Value, Compare, Allocator, Policies...>::const_iterator 
+rbtree<Value, Compare, Allocator, Policies...>::upper_bound(value_type const& value) const {
+    if(empty())
+        return end();
+
+    return const_iterator{upper_bound(value, sentinel_->right)};
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+std::pair<typename rbtree<Value, Compare, Allocator, Policies...>::iterator, typename rbtree<Value, Compare, Allocator, Policies...>::iterator>
+rbtree<Value, Compare, Allocator, Policies...>::equal_range(value_type const& value) {
+    if(empty())
+        return {end(), end()};
+
+    auto [first, last] = equal_range(value, sentinel_->right);
+    return {iterator{first}, iterator{last}};
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+std::pair<typename rbtree<Value, Compare, Allocator, Policies...>::const_iterator, typename rbtree<Value, Compare, Allocator, Policies...>::const_iterator>
+rbtree<Value, Compare, Allocator, Policies...>::equal_range(value_type const& value) const {
+    if(empty())
+        return {end(), end()};
+
+    auto [first, last] = equal_range(value, sentinel_->right);
+    return {const_iterator{first}, const_iterator{last}};
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename F>
+F rbtree<Value, Compare, Allocator, Policies...>::for_each(F f) {
+    return traverse<typename iterator::reference, false>(leftmost_, sentinel_, std::move(f));
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename F>
+F rbtree<Value, Compare, Allocator, Policies...>::for_each(F f) const {
+    return traverse<const_reference, false>(leftmost_, sentinel_, std::move(f));
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename F>
+F rbtree<Value, Compare, Allocator, Policies...>::for_each_reverse(F f) {
+    return traverse<typename iterator::reference, true>(rightmost_, sentinel_, std::move(f));
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename F>
+F rbtree<Value, Compare, Allocator, Policies...>::for_each_reverse(F f) const {
+    return traverse<const_reference, true>(rightmost_, sentinel_, std::move(f));
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename F>
+F rbtree<Value, Compare, Allocator, Policies...>::for_each(const_iterator first, const_iterator last, F f) {
+    return traverse<typename iterator::reference, false>(first.current_, last.current_, std::move(f));
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename F>
+F rbtree<Value, Compare, Allocator, Policies...>::for_each(const_iterator first, const_iterator last, F f) const {
+    return traverse<const_reference, false>(first.current_, last.current_, std::move(f));
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename F>
+F rbtree<Value, Compare, Allocator, Policies...>::for_each_in_range(value_type const& lo, value_type const& hi, F f) {
+    auto [first, last] = range_bounds(lo, hi);
+    return traverse<typename iterator::reference, false>(first, last, std::move(f));
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename F>
+F rbtree<Value, Compare, Allocator, Policies...>::for_each_in_range(value_type const& lo, value_type const& hi, F f) const {
+    auto [first, last] = range_bounds(lo, hi);
+    return traverse<const_reference, false>(first, last, std::move(f));
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename F>
+F rbtree<Value, Compare, Allocator, Policies...>::for_each_in_range_reverse(value_type const& lo, value_type const& hi, F f) {
+    return traverse_range_reverse<typename iterator::reference>(lo, hi, std::move(f));
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename F>
+F rbtree<Value, Compare, Allocator, Policies...>::for_each_in_range_reverse(value_type const& lo, value_type const& hi, F f) const {
+    return traverse_range_reverse<const_reference>(lo, hi, std::move(f));
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+std::vector<std::pair<typename rbtree<Value, Compare, Allocator, Policies...>::const_iterator,
+                      typename rbtree<Value, Compare, Allocator, Policies...>::const_iterator>>
+rbtree<Value, Compare, Allocator, Policies...>::split_ranges(size_type k) const {
+    return split_ranges(nullptr, nullptr, k);
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+std::vector<std::pair<typename rbtree<Value, Compare, Allocator, Policies...>::const_iterator,
+                      typename rbtree<Value, Compare, Allocator, Policies...>::const_iterator>>
+rbtree<Value, Compare, Allocator, Policies...>::split_ranges(value_type const& lo, value_type const& hi, size_type k) const {
+    if(compare_(hi, lo))
+        return {};
+    return split_ranges(&lo, &hi, k);
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+std::vector<std::pair<typename rbtree<Value, Compare, Allocator, Policies...>::const_iterator,
+                      typename rbtree<Value, Compare, Allocator, Policies...>::const_iterator>>
+rbtree<Value, Compare, Allocator, Policies...>::split_ranges(value_type const* lo, value_type const* hi, size_type k) const {
+    /* A piece is either a whole subtree or a single node. Subtrees partly
+     * outside of [lo, hi] are straddling and always split */
+    struct piece {
+        node_type* node;
+        bool subtree;
+        bool straddling;
+        size_type weight;
+    };
+
+    auto const below = [this, lo](node_type* t) { return lo && compare_(t->value(), *lo); };
+    auto const above = [this, hi](node_type* t) { return hi && compare_(*hi, t->value()); };
+
+    /* Appends the subtree rooted at t unless it lies outside of [lo, hi]. Its
+     * size is estimated from the lengths of its outermost paths */
+    auto const push_subtree = [&below, &above](std::vector<piece>& pieces, node_type* t) {
+        size_type left = 1u, right = 1u;
+        node_type* l = t;
+        node_type* r = t;
+        for(; l->has_left_child(); l = l->left)
+            ++left;
+        for(; r->has_right_child(); r = r->right)
+            ++right;
+        if(below(r) || above(l))
+            return;
+
+        auto const height = std::min<size_type>((left + right + 1u) / 2u, std::numeric_limits<size_type>::digits - 2u);
+        pieces.push_back({t, true, below(l) || above(r), (size_type{1u} << height) - 1u});
+    };
+
+    std::vector<std::pair<const_iterator, const_iterator>> ranges;
+    if(empty() || !k)
+        return ranges;
+
+    std::vector<piece> pieces;
+    push_subtree(pieces, sentinel_->right);
+
+    /* Replaces every piece for which split returns true by its left subtree,
+     * its root and its right subtree. Returns whether any piece was split */
+    auto const split_pieces = [&](auto split) {
+        std::vector<piece> next;
+        next.reserve(3u * pieces.size());
+        bool any = false;
+        for(auto const& p : pieces) {
+            if(!p.subtree || !split(p)) {
+                next.push_back(p);
+                continue;
+            }
+            if(p.node->has_left_child())
+                push_subtree(next, p.node->left);
+            if(!below(p.node) && !above(p.node))
+                next.push_back({p.node, false, false, 1u});
+            if(p.node->has_right_child())
+                push_subtree(next, p.node->right);
+            any = true;
+        }
+        pieces = std::move(next);
+        return any;
+    };
+
+    /* First narrow the pieces down to [lo, hi], then split pieces heavier
+     * than the threshold until there are enough of them to be grouped into
+     * k ranges of similar weight */
+    while(split_pieces([](piece const& p) { return p.straddling; }))
+        ;
+
+    size_type const oversampling = 8u;
+    size_type total = 0u;
+    for(auto const& p : pieces)
+        total += p.weight;
+    size_type const threshold = std::max<size_type>(1u, total / (oversampling * k));
+
+    while(pieces.size() < oversampling * k && split_pieces([threshold](piece const& p) {
+        return p.weight > threshold && !p.node->is_leaf();
+    }))
+        ;
+    if(pieces.empty())
+        return ranges;
+
+    /* Cut before the first piece reaching each multiple of total / k, while
+     * leaving at least one piece for every remaining range */
+    k = std::min(k, pieces.size());
+    total = 0u;
+    for(auto const& p : pieces)
+        total += p.weight;
+
+    auto first_node = [](piece const& p) {
+        return p.subtree ? leftmost(p.node) : p.node;
+    };
+
+    ranges.reserve(k);
+    node_type* begin = first_node(pieces.front());
+    size_type cumulative = 0u, pos = 0u;
+    for(size_type j = 1u; j < k; j++) {
+        auto const target = static_cast<size_type>(static_cast<double>(total) * j / k);
+        auto const max_pos = pieces.size() - (k - j);
+        cumulative += pieces[pos++].weight;
+        while(pos < max_pos && cumulative < target)
+            cumulative += pieces[pos++].weight;
+
+        node_type* end = first_node(pieces[pos]);
+        ranges.emplace_back(const_iterator{begin}, const_iterator{end});
+        begin = end;
+    }
+
+    auto const& last = pieces.back();
+    ranges.emplace_back(const_iterator{begin}, const_iterator{successor(last.subtree ? rightmost(last.node) : last.node)});
+    return ranges;
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename ExecutionPolicy, typename T, typename BinaryOp, typename UnaryOp>
+T rbtree<Value, Compare, Allocator, Policies...>::transform_reduce(ExecutionPolicy&& policy, value_type const& lo, value_type const& hi,
+                                                      T init, BinaryOp reduce, UnaryOp transform) const {
+    auto const ranges = split_ranges(lo, hi, policy.chunks());
+
+    /* Every range is reduced on its own, starting from its first value, and
+     * the partial results are then combined in order */
+    std::vector<std::optional<T>> partial(ranges.size());
+    policy.run(ranges.size(), [this, &ranges, &partial, &reduce, &transform](std::size_t i) {
+        node_type* first = ranges[i].first.current_;
+        auto& acc = partial[i].emplace(transform(static_cast<const_reference>(first->value())));
+        traverse<const_reference, false>(successor(first), ranges[i].second.current_, [&acc, &reduce, &transform](const_reference value) {
+            acc = reduce(std::move(acc), transform(value));
+        });
+    });
+
+    for(auto& p : partial)
+        init = reduce(std::move(init), std::move(*p));
+    return init;
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename ExecutionPolicy, typename T, typename BinaryOp>
+T rbtree<Value, Compare, Allocator, Policies...>::reduce(ExecutionPolicy&& policy, value_type const& lo, value_type const& hi,
+                                            T init, BinaryOp op) const {
+    return transform_reduce(std::forward<ExecutionPolicy>(policy), lo, hi, std::move(init), std::move(op),
+                            [](const_reference value) -> value_type const& { return value; });
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename ExecutionPolicy, typename Predicate>
+typename rbtree<Value, Compare, Allocator, Policies...>::size_type
+rbtree<Value, Compare, Allocator, Policies...>::count_if(ExecutionPolicy&& policy, value_type const& lo, value_type const& hi,
+                                            Predicate pred) const {
+    return transform_reduce(std::forward<ExecutionPolicy>(policy), lo, hi, size_type{0u}, std::plus<size_type>{},
+                            [&pred](const_reference value) -> size_type { return pred(value) ? 1u : 0u; });
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename, typename>
+typename rbtree<Value, Compare, Allocator, Policies...>::aggregate_type
+rbtree<Value, Compare, Allocator, Policies...>::aggregate() const {
+    return empty() ? monoid_type{}.identity() : sentinel_->right->aggregate;
+}
+
+/* The values in [lo, hi] are those of the first node inside the range found
+ * when descending, along with those of the nodes below it which lie in the
+ * range, and of whole subtrees hanging off the paths from there to lo and hi */
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename, typename>
+typename rbtree<Value, Compare, Allocator, Policies...>::aggregate_type
+rbtree<Value, Compare, Allocator, Policies...>::aggregate(value_type const& lo, value_type const& hi) const {
+    monoid_type const monoid{};
+    if(empty() || compare_(hi, lo))
+        return monoid.identity();
+
+    node_type* split = sentinel_->right;
+    while(true) {
+        if(compare_(split->value(), lo)) {
+            if(!split->has_right_child())
+                return monoid.identity();
+            split = split->right;
+        }
+        else if(compare_(hi, split->value())) {
+            if(!split->has_left_child())
+                return monoid.identity();
+            split = split->left;
+        }
+        else
+            break;
+    }
+
+    /* Left of split, every node not less than lo is in the range together
+     * with its right subtree, and is preceded by the nodes found below it */
+    auto left = monoid.identity();
+    for(node_type* current = split->has_left_child() ? split->left : nullptr; current; ) {
+        if(compare_(current->value(), lo)) {
+            current = current->has_right_child() ? current->right : nullptr;
+            continue;
+        }
+        auto piece = monoid.lift(static_cast<const_reference>(current->value()));
+        if(current->has_right_child())
+            piece = monoid.combine(piece, current->right->aggregate);
+        left = monoid.combine(piece, left);
+        current = current->has_left_child() ? current->left : nullptr;
+    }
+
+    auto right = monoid.identity();
+    for(node_type* current = split->has_right_child() ? split->right : nullptr; current; ) {
+        if(compare_(hi, current->value())) {
+            current = current->has_left_child() ? current->left : nullptr;
+            continue;
+        }
+        auto piece = monoid.lift(static_cast<const_reference>(current->value()));
+        if(current->has_left_child())
+            piece = monoid.combine(current->left->aggregate, piece);
+        right = monoid.combine(right, piece);
+        current = current->has_right_child() ? current->right : nullptr;
+    }
+
+    return monoid.combine(monoid.combine(left, monoid.lift(static_cast<const_reference>(split->value()))), right);
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename F, typename, typename>
+void rbtree<Value, Compare, Allocator, Policies...>::modify(const_iterator pos, F f) {
+    f(pos.current_->value().second);
+    update_path(pos.current_);
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename Keep, typename F, typename, typename>
+bool rbtree<Value, Compare, Allocator, Policies...>::for_each_pruned(Keep keep, F f) const {
+    if(empty())
+        return true;
+
+    auto const kept = [&keep](node_type* node) {
+        return keep(static_cast<aggregate_type const&>(node->aggregate));
+    };
+
+    /* In-order traversal with an explicit stack of the nodes whose left
+     * subtree is being visited, bounded by the height of the tree */
+    std::array<node_type*, 2u * std::numeric_limits<size_type>::digits> stack;
+    size_type depth = 0u;
+    node_type* current = kept(sentinel_->right) ? sentinel_->right : nullptr;
+    while(current || depth) {
+        for(; current; current = current->has_left_child() && kept(current->left) ? current->left : nullptr)
+            stack[depth++] = current;
+
+        current = stack[--depth];
+        if(!f(static_cast<const_reference>(current->value())))
+            return false;
+        current = current->has_right_child() && kept(current->right) ? current->right : nullptr;
+    }
+    return true;
 }
 
 #ifdef TRBT_DEBUG
-template <typename Value, typename Compare, typename Allocator>
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
 template <typename StringConverter>
-void rbtree<Value, Compare, Allocator>::assert_properties_ok(StringConverter sc) const {
+void rbtree<Value, Compare, Allocator, Policies...>::assert_properties_ok(StringConverter sc) const {
     if(!empty()) {
         if(sentinel_->right->color() != Color::Black)
             throw color_violation_exception{"Root is red\n"};
@@ -1228,80 +2746,80 @@ void rbtree<Value, Compare, Allocator>::assert_properties_ok(StringConverter sc)
 }
 #endif
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::iterator 
-rbtree<Value, Compare, Allocator>::begin() noexcept {
-    return iterator{this, leftmost_};
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::iterator 
+rbtree<Value, Compare, Allocator, Policies...>::begin() noexcept {
+    return iterator{leftmost_};
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::iterator 
-rbtree<Value, Compare, Allocator>::end() noexcept {
-    return iterator{this};
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::iterator 
+rbtree<Value, Compare, Allocator, Policies...>::end() noexcept {
+    return iterator{sentinel_};
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::const_iterator 
-rbtree<Value, Compare, Allocator>::begin() const noexcept {
-    return const_iterator{this, leftmost_};
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::const_iterator 
+rbtree<Value, Compare, Allocator, Policies...>::begin() const noexcept {
+    return const_iterator{leftmost_};
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::const_iterator 
-rbtree<Value, Compare, Allocator>::end() const noexcept {
-    return const_iterator{this};
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::const_iterator 
+rbtree<Value, Compare, Allocator, Policies...>::end() const noexcept {
+    return const_iterator{sentinel_};
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::const_iterator 
-rbtree<Value, Compare, Allocator>::cbegin() const noexcept {
-    return const_iterator{this, leftmost_};
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::const_iterator 
+rbtree<Value, Compare, Allocator, Policies...>::cbegin() const noexcept {
+    return const_iterator{leftmost_};
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::const_iterator 
-rbtree<Value, Compare, Allocator>::cend() const noexcept {
-    return const_iterator{this};
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::const_iterator 
+rbtree<Value, Compare, Allocator, Policies...>::cend() const noexcept {
+    return const_iterator{sentinel_};
 }
     
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::reverse_iterator 
-rbtree<Value, Compare, Allocator>::rbegin() noexcept {
-    return reverse_iterator{this, rightmost_};
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::reverse_iterator 
+rbtree<Value, Compare, Allocator, Policies...>::rbegin() noexcept {
+    return reverse_iterator{rightmost_};
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::reverse_iterator 
-rbtree<Value, Compare, Allocator>::rend() noexcept {
-    return reverse_iterator{this};
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::reverse_iterator 
+rbtree<Value, Compare, Allocator, Policies...>::rend() noexcept {
+    return reverse_iterator{sentinel_};
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::const_reverse_iterator 
-rbtree<Value, Compare, Allocator>::rbegin() const noexcept {
-    return const_reverse_iterator{this, rightmost_};
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::const_reverse_iterator 
+rbtree<Value, Compare, Allocator, Policies...>::rbegin() const noexcept {
+    return const_reverse_iterator{rightmost_};
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::const_reverse_iterator 
-rbtree<Value, Compare, Allocator>::rend() const noexcept {
-    return const_reverse_iterator{this};
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::const_reverse_iterator 
+rbtree<Value, Compare, Allocator, Policies...>::rend() const noexcept {
+    return const_reverse_iterator{sentinel_};
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::const_reverse_iterator 
-rbtree<Value, Compare, Allocator>::crbegin() const noexcept {
-    return const_reverse_iterator{this, rightmost_};
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::const_reverse_iterator 
+rbtree<Value, Compare, Allocator, Policies...>::crbegin() const noexcept {
+    return const_reverse_iterator{rightmost_};
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::const_reverse_iterator 
-rbtree<Value, Compare, Allocator>::crend() const noexcept {
-    return const_reverse_iterator{this};
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::const_reverse_iterator 
+rbtree<Value, Compare, Allocator, Policies...>::crend() const noexcept {
+    return const_reverse_iterator{sentinel_};
 }
 
-template <typename Val_, typename Comp_, typename Alloc_>
-bool operator==(rbtree<Val_, Comp_, Alloc_> const& left, rbtree<Val_, Comp_, Alloc_> const& right) noexcept {
+template <typename Val_, typename Comp_, typename Alloc_, typename... Pol_>
+bool operator==(rbtree<Val_, Comp_, Alloc_, Pol_...> const& left, rbtree<Val_, Comp_, Alloc_, Pol_...> const& right) noexcept {
     using impl::equals;
     
     if(left.size() != right.size())
@@ -1311,68 +2829,66 @@ bool operator==(rbtree<Val_, Comp_, Alloc_> const& left, rbtree<Val_, Comp_, All
     auto right_it = std::cbegin(right);
 
     while(left_it != std::cend(left) && right_it != std::cend(right))
-        if(!equals<impl::key_compare_t<impl::remove_cvref_t<Val_>, Comp_>>(*left_it++, *right_it++))
+        if(!equals<typename rbtree<Val_, Comp_, Alloc_, Pol_...>::key_compare>(*left_it++, *right_it++))
             return false;
 
     return true;
 }
 
-template <typename Val_, typename Comp_, typename Alloc_>
-bool operator!=(rbtree<Val_, Comp_, Alloc_> const& left, rbtree<Val_, Comp_, Alloc_> const& right) noexcept {
+template <typename Val_, typename Comp_, typename Alloc_, typename... Pol_>
+bool operator!=(rbtree<Val_, Comp_, Alloc_, Pol_...> const& left, rbtree<Val_, Comp_, Alloc_, Pol_...> const& right) noexcept {
     return !(left == right);
 }
 
-template <typename Val_, typename Comp_, typename Alloc_>
-bool operator<(rbtree<Val_, Comp_, Alloc_> const& left, rbtree<Val_, Comp_, Alloc_> const& right) noexcept {
+template <typename Val_, typename Comp_, typename Alloc_, typename... Pol_>
+bool operator<(rbtree<Val_, Comp_, Alloc_, Pol_...> const& left, rbtree<Val_, Comp_, Alloc_, Pol_...> const& right) noexcept {
     Comp_ compare{};
     auto left_it  = std::cbegin(left);
     auto right_it = std::cbegin(right);
 
     while(left_it != std::cend(left) && right_it != std::cend(right)) {
-        if(compare(*left_it, *right_it))
-            return true;
-        else if(compare(*right_it++, *left_it++))
-            return false;
+        auto rel = impl::relation(compare, *left_it++, *right_it++);
+        if(rel != impl::ValueRelation::Equal)
+            return rel == impl::ValueRelation::Less;
     }
 
     return left.size() < right.size();
 }
 
-template <typename Val_, typename Comp_, typename Alloc_>
-bool operator>(rbtree<Val_, Comp_, Alloc_> const& left, rbtree<Val_, Comp_, Alloc_> const& right) noexcept {
+template <typename Val_, typename Comp_, typename Alloc_, typename... Pol_>
+bool operator>(rbtree<Val_, Comp_, Alloc_, Pol_...> const& left, rbtree<Val_, Comp_, Alloc_, Pol_...> const& right) noexcept {
     Comp_ compare{};
 
     auto left_it = std::cbegin(left);
     auto right_it = std::cbegin(right);
 
     while(left_it != std::cend(left) && right_it != std::cend(right)) {
-        if(compare(*left_it, *right_it))
-            return false;
-        else if(compare(*right_it++, *left_it++))
-            return true;
+        auto rel = impl::relation(compare, *left_it++, *right_it++);
+        if(rel != impl::ValueRelation::Equal)
+            return rel == impl::ValueRelation::Greater;
     }
 
     return left.size() > right.size();
 }
 
-template <typename Val_, typename Comp_, typename Alloc_>
-bool operator<=(rbtree<Val_, Comp_, Alloc_> const& left, rbtree<Val_, Comp_, Alloc_> const& right) noexcept {
+template <typename Val_, typename Comp_, typename Alloc_, typename... Pol_>
+bool operator<=(rbtree<Val_, Comp_, Alloc_, Pol_...> const& left, rbtree<Val_, Comp_, Alloc_, Pol_...> const& right) noexcept {
     return !(left > right);
 }
 
-template <typename Val_, typename Comp_, typename Alloc_>
-bool operator>=(rbtree<Val_, Comp_, Alloc_> const& left, rbtree<Val_, Comp_, Alloc_> const& right) noexcept {
+template <typename Val_, typename Comp_, typename Alloc_, typename... Pol_>
+bool operator>=(rbtree<Val_, Comp_, Alloc_, Pol_...> const& left, rbtree<Val_, Comp_, Alloc_, Pol_...> const& right) noexcept {
     return !(left < right);
 }
 
-template <typename Val_, typename Comp_, typename Alloc_>
-void swap(rbtree<Val_, Comp_, Alloc_>& left, rbtree<Val_, Comp_, Alloc_>& right) noexcept(noexcept(left.swap(right))) {
+template <typename Val_, typename Comp_, typename Alloc_, typename... Pol_>
+void swap(rbtree<Val_, Comp_, Alloc_, Pol_...>& left, rbtree<Val_, Comp_, Alloc_, Pol_...>& right) noexcept(noexcept(left.swap(right))) {
     left.swap(right);
 }
 
 #ifdef TRBT_DEBUG
-template <typename Value, typename Compare, typename Allocator>
-void rbtree<Value, Compare, Allocator>::print(node_type* t, std::ostream& os, unsigned indentation) const {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+void rbtree<Value, Compare, Allocator, Policies...>::print(node_type* t, std::ostream& os, unsigned indentation) const {
     if(t->has_right_child())
         print(t->right, os, indentation + 2);
     
@@ -1390,27 +2906,37 @@ void rbtree<Value, Compare, Allocator>::print(node_type* t, std::ostream& os, un
 }
 #endif
 
-template <typename Value, typename Compare, typename Allocator>
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
 template <typename T>
-typename rbtree<Value, Compare, Allocator>::node_type*
-rbtree<Value, Compare, Allocator>::allocate_node(T&& value, node_type* ln, node_type* rn, Color col, unsigned char thread) {
+typename rbtree<Value, Compare, Allocator, Policies...>::node_type*
+rbtree<Value, Compare, Allocator, Policies...>::allocate_node(T&& value, node_type* ln, node_type* rn, Color col, unsigned char thread) {
     node_type* node = allocator_.allocate(1u);
+    TRBT_COUNT(allocations++);
     node = new (node) node_type{std::forward<T>(value), ln, rn, col, thread};
 
     return node;
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::node_type* 
-rbtree<Value, Compare, Allocator>::allocate_node(node_type* ln, node_type* rn, Color col, unsigned char thread) {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::node_type* 
+rbtree<Value, Compare, Allocator, Policies...>::allocate_node(node_type* ln, node_type* rn, Color col, unsigned char thread) {
     node_type* node = allocator_.allocate(1u);
+    TRBT_COUNT(allocations++);
     node = new (node) node_type(ln, rn, col, thread);
 
     return node;
 }
 
-template <typename Value, typename Compare, typename Allocator>
-void rbtree<Value, Compare, Allocator>::init(unsigned char thread) {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+void rbtree<Value, Compare, Allocator, Policies...>::deallocate_node(node_type* node) noexcept {
+    if constexpr(!std::is_trivially_destructible_v<node_type>)
+        node->~node_type();
+    allocator_.deallocate(node, 1u);
+    TRBT_COUNT(deallocations++);
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+void rbtree<Value, Compare, Allocator, Policies...>::init(unsigned char thread) {
     sentinel_ = allocate_node(nullptr, nullptr, Color::Black, thread);
     sentinel_->left = sentinel_;
 
@@ -1422,21 +2948,33 @@ void rbtree<Value, Compare, Allocator>::init(unsigned char thread) {
     leftmost_ = rightmost_ = sentinel_;
 }
 
-template <typename Value, typename Compare, typename Allocator>
-void rbtree<Value, Compare, Allocator>::clear(node_type* current) noexcept {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+void rbtree<Value, Compare, Allocator, Policies...>::clear(node_type* current) noexcept {
     if(current->has_left_child())
         clear(current->left);
     if(current->has_right_child())
         clear(current->right);
     
-    allocator_.deallocate(current, 1u);
+    deallocate_node(current);
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::node_type* 
-rbtree<Value, Compare, Allocator>::clone(node_type* pred, node_type* succ, node_type* other) {
-
-    node_type* node = allocate_node(other->value(), pred, succ, other->color(), other->flags);
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::node_type* 
+rbtree<Value, Compare, Allocator, Policies...>::clone(node_type* pred, node_type* succ, node_type* other) {
+
+    node_type* node;
+    if constexpr(std::is_trivially_copyable_v<node_type>) {
+        node = allocator_.allocate(1u);
+        TRBT_COUNT(allocations++);
+        std::memcpy(static_cast<void*>(node), other, sizeof(node_type));
+        node->left  = pred;
+        node->right = succ;
+    }
+    else {
+        node = allocate_node(other->value(), pred, succ, other->color(), other->flags);
+        if constexpr(augmented)
+            node->aggregate = other->aggregate;
+    }
 
     if(other->has_left_child())
         node->left = clone(pred, node, other->left);
@@ -1450,69 +2988,139 @@ rbtree<Value, Compare, Allocator>::clone(node_type* pred, node_type* succ, node_
     return node;
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::node_type*
-rbtree<Value, Compare, Allocator>::find(value_type const& value, node_type* current) const {
+/* Builds a balanced subtree of count nodes whose values are produced, in order,
+ * by next. last is the most recently built node, whose right thread is fixed up
+ * by the caller once its successor exists */
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename Generator>
+typename rbtree<Value, Compare, Allocator, Policies...>::node_type*
+rbtree<Value, Compare, Allocator, Policies...>::build_sorted(size_type count, size_type depth, size_type red_depth, 
+                                                node_type* pred, node_type*& last, Generator& next) {
+    size_type const left_count = (count - 1u) / 2u;
+    node_type* left = left_count ? build_sorted(left_count, depth + 1u, red_depth, pred, last, next) : nullptr;
+
+    node_type* node = allocate_node(next(), left ? left : pred, nullptr, 
+                                    depth == red_depth ? Color::Red : Color::Black,
+                                    left ? node_type::RIGHT_BIT : node_type::LEAF);
+    if(left)
+        last->right = node;
+    last = node;
+
+    if(size_type const right_count = count - 1u - left_count) {
+        node->right = build_sorted(right_count, depth + 1u, red_depth, node, last, next);
+        node->unset_right_thread();
+    }
+
+    if constexpr(augmented)
+        update(node);
+
+    return node;
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename T>
+typename rbtree<Value, Compare, Allocator, Policies...>::node_type*
+rbtree<Value, Compare, Allocator, Policies...>::find(T const& value, node_type* current) const {
+    /* The first of the equal values, in order */
+    if constexpr(multi) {
+        current = lower_bound(value, current);
+        return current == sentinel_ || compare_(value, current->value()) ? sentinel_ : current;
+    }
+
+    TRBT_COUNT(begin_descent());
     while(true) {
-        if(compare_(value, current->value())) {
-            if(current->has_left_child())
-                current = current->left;
-            else
-                return sentinel_;
-        }
-        else if(compare_(current->value(), value)) {
-            if(current->has_right_child())
-                current = current-> right;
-            else
-                return sentinel_;
-        }
-        else break;
+        TRBT_COUNT(descend());
+        auto rel = impl::relation(compare_, value, current->value());
+
+        if(rel == ValueRelation::Equal)
+            break;
+
+        current = link(current, dir_from_value_rel(rel));
+        if(current == sentinel_)
+            break;
     }
     return current;
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::node_type*
-rbtree<Value, Compare, Allocator>::link(node_type* node, Direction dir) const {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::node_type*
+rbtree<Value, Compare, Allocator, Policies...>::link(node_type* node, Direction dir) const {
     if(dir == Direction::Right)
         return node->has_right_child() ? node->right : sentinel_;
     
     return node->has_left_child() ? node->left : sentinel_;
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::node_type*
-rbtree<Value, Compare, Allocator>::leftmost(node_type* root) {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::node_type*
+rbtree<Value, Compare, Allocator, Policies...>::leftmost(node_type* root) {
     while(root->has_left_child())
         root = root->left;
 
     return root;
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::node_type*
-rbtree<Value, Compare, Allocator>::rightmost(node_type* root) {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::node_type*
+rbtree<Value, Compare, Allocator, Policies...>::rightmost(node_type* root) {
     while(root->has_right_child())
         root = root->right;
 
     return root;
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::node_type*
-rbtree<Value, Compare, Allocator>::successor(node_type* node) {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::node_type*
+rbtree<Value, Compare, Allocator, Policies...>::successor(node_type* node) {
     return node->has_right_child() ? leftmost(node->right) : node->right;
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::node_type*
-rbtree<Value, Compare, Allocator>::predecessor(node_type* node) {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::node_type*
+rbtree<Value, Compare, Allocator, Policies...>::predecessor(node_type* node) {
     return node->has_left_child() ? rightmost(node->left) : node->left;
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::node_type*
-rbtree<Value, Compare, Allocator>::left_rotate(node_type* root, node_type* parent) {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+void rbtree<Value, Compare, Allocator, Policies...>::update(node_type* node) const {
+    monoid_type const monoid{};
+    auto aggregate = monoid.lift(static_cast<const_reference>(node->value()));
+    if(node->has_left_child())
+        aggregate = monoid.combine(node->left->aggregate, aggregate);
+    if(node->has_right_child())
+        aggregate = monoid.combine(aggregate, node->right->aggregate);
+    node->aggregate = std::move(aggregate);
+}
+
+/* The aggregates of the nodes on the path are recomputed bottom-up, so each
+ * is computed from up to date children */
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+void rbtree<Value, Compare, Allocator, Policies...>::update_path(node_type* node) const {
+    /* Rotations may leave values equal to node on either side of it, so the
+     * path cannot be found by comparisons and is climbed through parent_of */
+    if constexpr(multi) {
+        for(; node != sentinel_; node = parent_of(node))
+            update(node);
+        return;
+    }
+
+    /* The height of a red-black tree is less than twice the logarithm of its size */
+    std::array<node_type*, 2u * std::numeric_limits<size_type>::digits> path;
+    size_type depth = 0u;
+    for(node_type* current = sentinel_->right; current != node; ++depth) {
+        path[depth] = current;
+        current = compare_(node->value(), current->value()) ? current->left : current->right;
+    }
+
+    update(node);
+    while(depth)
+        update(path[--depth]);
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::node_type*
+rbtree<Value, Compare, Allocator, Policies...>::left_rotate(node_type* root, node_type* parent) {
+    TRBT_COUNT(left_rotations++);
     node_type* new_root = root->right;
 
     if(new_root->has_left_child())
@@ -1532,12 +3140,18 @@ rbtree<Value, Compare, Allocator>::left_rotate(node_type* root, node_type* paren
     root->set_color(Color::Red);
     new_root->set_color(Color::Black);
 
+    if constexpr(augmented) {
+        update(root);
+        update(new_root);
+    }
+
     return new_root;
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::node_type*
-rbtree<Value, Compare, Allocator>::right_rotate(node_type* root, node_type* parent) {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::node_type*
+rbtree<Value, Compare, Allocator, Policies...>::right_rotate(node_type* root, node_type* parent) {
+    TRBT_COUNT(right_rotations++);
     node_type* new_root = root->left;
 
     if(new_root->has_right_child())
@@ -1557,64 +3171,54 @@ rbtree<Value, Compare, Allocator>::right_rotate(node_type* root, node_type* pare
     root->set_color(Color::Red);
     new_root->set_color(Color::Black);
 
+    if constexpr(augmented) {
+        update(root);
+        update(new_root);
+    }
+
     return new_root;
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::node_type*
-rbtree<Value, Compare, Allocator>::left_right_rotate(node_type* root, node_type* parent) {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::node_type*
+rbtree<Value, Compare, Allocator, Policies...>::left_right_rotate(node_type* root, node_type* parent) {
     left_rotate(root->left, root);
     return right_rotate(root, parent);
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::node_type*
-rbtree<Value, Compare, Allocator>::right_left_rotate(node_type* root, node_type* parent) {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::node_type*
+rbtree<Value, Compare, Allocator, Policies...>::right_left_rotate(node_type* root, node_type* parent) {
     right_rotate(root->right, root);
     return left_rotate(root, parent);
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::node_type*
-rbtree<Value, Compare, Allocator>::left_left_rotate(node_type* root, node_type* parent) {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::node_type*
+rbtree<Value, Compare, Allocator, Policies...>::left_left_rotate(node_type* root, node_type* parent) {
     right_rotate(root->left, root);
     return right_rotate(root, parent);
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::node_type*
-rbtree<Value, Compare, Allocator>::right_right_rotate(node_type* root, node_type* parent) {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::node_type*
+rbtree<Value, Compare, Allocator, Policies...>::right_right_rotate(node_type* root, node_type* parent) {
     left_rotate(root->right, root);
     return left_rotate(root, parent);
 }
 
-template <typename Value, typename Compare, typename Allocator>
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
 template <typename T>
-impl::ValueRelation rbtree<Value, Compare, Allocator>::insert_position(T const& value, node_type*& current, node_type*& parent, node_type*& grandparent, node_type*& great_grandparent) {
+impl::ValueRelation rbtree<Value, Compare, Allocator, Policies...>::insert_position(T const& value, node_type*& current, node_type*& parent, node_type*& grandparent, node_type*& great_grandparent) {
 
-    static_assert(std::is_convertible_v<value_type, impl::remove_cvref_t<T>> ||
-                  std::is_same_v<node_type, std::remove_pointer_t<T>>);
+    static_assert(std::is_convertible_v<value_type, impl::remove_cvref_t<T>>);
 
     Direction dir;
     ValueRelation relation;
 
-    auto auto_compare = [](auto const& left, auto const& right) {
-        Compare comp;
-        if constexpr(std::is_same_v<impl::remove_cvref_t<decltype(left)>, node_type>) {
-            if constexpr(std::is_same_v<impl::remove_cvref_t<decltype(right)>, node_type>) 
-                return comp(left.value(), right.value());
-            else
-                return comp(left.value(), right);
-        }
-        else {
-            if constexpr(std::is_same_v<impl::remove_cvref_t<decltype(right)>, node_type>)
-                return comp(left, right.value());
-            else
-                return comp(left, right);
-        }
-    };
-
+    TRBT_COUNT(begin_descent());
     while(true) {
+        TRBT_COUNT(descend());
         if(link(current, Direction::Left)->color() == Color::Red && link(current, Direction::Right)->color() == Color::Red)
             recolor_insert(current, parent, grandparent, great_grandparent);
 
@@ -1622,28 +3226,21 @@ impl::ValueRelation rbtree<Value, Compare, Allocator>::insert_position(T const&
         grandparent = parent;
         parent = current;
 
-    
-        if(auto_compare(value, current->value())) {
-            if(!current->has_left_child()) {
-                relation = ValueRelation::Less;
-                break;
-            }
-            else
-                dir = Direction::Left;
-        }
-        else if(auto_compare(current->value(), value)) {
-            if(!current->has_right_child()) {
-                relation = ValueRelation::Greater;
-                break;
-            }
-            else
-                dir = Direction::Right;
-        }
-        else {
+        /* Values equal to one in the tree are placed after it if duplicates are allowed */
+        if constexpr(multi)
+            relation = compare_(value, current->value()) ? ValueRelation::Less : ValueRelation::Greater;
+        else
+            relation = impl::relation(compare_, value, current->value());
+
+        if(relation == ValueRelation::Equal) {
             sentinel_->right->set_color(Color::Black);
             return ValueRelation::Equal;
         }
 
+        dir = dir_from_value_rel(relation);
+        if(link(current, dir) == sentinel_)
+            break;
+
         current = link(current, dir);
     }
 
@@ -1651,13 +3248,15 @@ impl::ValueRelation rbtree<Value, Compare, Allocator>::insert_position(T const&
     return relation;
 }
 
-template <typename Value, typename Compare, typename Allocator>
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
 template <typename T>
-typename rbtree<Value, Compare, Allocator>::node_type*
-rbtree<Value, Compare, Allocator>::insert_empty(T&& value) {
+typename rbtree<Value, Compare, Allocator, Policies...>::node_type*
+rbtree<Value, Compare, Allocator, Policies...>::insert_empty(T&& value) {
     sentinel_->right = allocate_node(std::forward<T>(value), sentinel_, sentinel_, 
                                    Color::Black, node_type::LEAF);
     sentinel_->unset_right_thread();
+    if constexpr(augmented)
+        update(sentinel_->right);
 
     ++size_;
 
@@ -1666,13 +3265,15 @@ rbtree<Value, Compare, Allocator>::insert_empty(T&& value) {
     return sentinel_->right;
 }
 
-template <typename Value, typename Compare, typename Allocator>
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
 template <typename... Args>
-typename rbtree<Value, Compare, Allocator>::node_type*
-rbtree<Value, Compare, Allocator>::emplace_empty(Args&&... args) {
+typename rbtree<Value, Compare, Allocator, Policies...>::node_type*
+rbtree<Value, Compare, Allocator, Policies...>::emplace_empty(Args&&... args) {
     sentinel_->right = allocate_node(value_type{std::forward<Args>(args)...}, sentinel_, sentinel_, 
                                    Color::Black, node_type::LEAF);
     sentinel_->unset_right_thread();
+    if constexpr(augmented)
+        update(sentinel_->right);
 
     ++size_;
     leftmost_ = rightmost_ = sentinel_->right;
@@ -1680,8 +3281,9 @@ rbtree<Value, Compare, Allocator>::emplace_empty(Args&&... args) {
     return sentinel_->right;
 }
 
-template <typename Value, typename Compare, typename Allocator>
-void rbtree<Value, Compare, Allocator>::recolor_insert(node_type* current, node_type* parent, node_type* grandparent, node_type* great_grandparent) {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+void rbtree<Value, Compare, Allocator, Policies...>::recolor_insert(node_type* current, node_type* parent, node_type* grandparent, node_type* great_grandparent) {
+    TRBT_COUNT(insert_recolors++);
     current->set_color(Color::Red);
 
     if(current->has_left_child() && current->has_right_child()) {
@@ -1693,9 +3295,10 @@ void rbtree<Value, Compare, Allocator>::recolor_insert(node_type* current, node_
     if(parent->color() == Color::Red) {
         grandparent->set_color(Color::Red);
 
-        bool current_is_left_child = compare_(current->value(), parent->value());
-        /* Nodes are on a line, double rotation */
-        if(current_is_left_child != compare_(current->value(), grandparent->value())) {
+        bool current_is_left_child = parent->left == current;
+        bool parent_is_left_child  = grandparent->left == parent;
+        /* Nodes form a triangle, double rotation */
+        if(current_is_left_child != parent_is_left_child) {
             if(current_is_left_child)
                 right_left_rotate(grandparent, great_grandparent);
             else
@@ -1705,7 +3308,7 @@ void rbtree<Value, Compare, Allocator>::recolor_insert(node_type* current, node_
         }
         /* Single rotation */
         else {
-            if(compare_(parent->value(), grandparent->value()))
+            if(parent_is_left_child)
                 right_rotate(grandparent, great_grandparent);
             else
                 left_rotate(grandparent, great_grandparent);
@@ -1715,8 +3318,9 @@ void rbtree<Value, Compare, Allocator>::recolor_insert(node_type* current, node_
     }
 }
 
-template <typename Value, typename Compare, typename Allocator>
-void rbtree<Value, Compare, Allocator>::recolor_remove(Direction dir, node_type* current, node_type*& parent, node_type* grandparent, node_type* sibling) {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+void rbtree<Value, Compare, Allocator, Policies...>::recolor_remove(Direction dir, node_type* current, node_type*& parent, node_type* grandparent, node_type* sibling) {
+    TRBT_COUNT(remove_recolors++);
 
     /* Node in opposite direciton is red, current and link(current, dir) are black. 
      * rotate red node into the path */
@@ -1768,36 +3372,91 @@ void rbtree<Value, Compare, Allocator>::recolor_remove(Direction dir, node_type*
     sentinel_->set_color(Color::Black);
 }
 
-template <typename Value, typename Compare, typename Allocator>
-void rbtree<Value, Compare, Allocator>::enqueue_as_left_child(node_type* new_node, node_type* parent) {
+/* If node is a left child, its parent is the successor of the rightmost node
+ * of its subtree, otherwise the predecessor of the leftmost one */
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::node_type*
+rbtree<Value, Compare, Allocator, Policies...>::parent_of(node_type* node) const {
+    if(node_type* after = rightmost(node)->right; after != sentinel_ && after->left == node)
+        return after;
+
+    /* The predecessor of the leftmost node is the sentinel, whose right child is the root */
+    return leftmost(node)->left;
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+void rbtree<Value, Compare, Allocator, Policies...>::rebalance_inserted(node_type* node) {
+    node_type* parent = parent_of(node);
+
+    /* A red parent is not the root, so the grandparent is a node */
+    while(parent->color() == Color::Red) {
+        node_type* grandparent = parent_of(parent);
+        bool const parent_is_left_child = grandparent->left == parent;
+        node_type* uncle = link(grandparent, parent_is_left_child ? Direction::Right : Direction::Left);
+
+        /* Red uncle, push the grandparent's blackness down and continue above it */
+        if(uncle->color() == Color::Red) {
+            TRBT_COUNT(insert_recolors++);
+            parent->set_color(Color::Black);
+            uncle->set_color(Color::Black);
+            grandparent->set_color(Color::Red);
+
+            node = grandparent;
+            parent = parent_of(node);
+            continue;
+        }
+
+        /* Black uncle, the rotations leave a black subtree root with two red children */
+        node_type* great_grandparent = parent_of(grandparent);
+        bool const node_is_left_child = parent->left == node;
+        if(node_is_left_child != parent_is_left_child) {
+            if(parent_is_left_child)
+                left_right_rotate(grandparent, great_grandparent);
+            else
+                right_left_rotate(grandparent, great_grandparent);
+        }
+        else {
+            if(parent_is_left_child)
+                right_rotate(grandparent, great_grandparent);
+            else
+                left_rotate(grandparent, great_grandparent);
+        }
+        break;
+    }
+
+    sentinel_->right->set_color(Color::Black);
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+void rbtree<Value, Compare, Allocator, Policies...>::enqueue_as_left_child(node_type* new_node, node_type* parent) {
 
     parent->unset_left_thread();
     new_node->left = parent->left;
     new_node->right = parent;
     parent->left = new_node;
 
-    if(compare_(new_node->value(), leftmost_->value()))
-        leftmost_ = parent->left;
+    if(parent == leftmost_)
+        leftmost_ = new_node;
 
     ++size_;
 }
 
-template <typename Value, typename Compare, typename Allocator>
-void rbtree<Value, Compare, Allocator>::enqueue_as_right_child(node_type* new_node, node_type* parent) {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+void rbtree<Value, Compare, Allocator, Policies...>::enqueue_as_right_child(node_type* new_node, node_type* parent) {
     parent->unset_right_thread();
     new_node->left = parent;
     new_node->right = parent->right;
     parent->right = new_node;
 
-    if(compare_(rightmost_->value(), new_node->value()))
-        rightmost_ = parent->right;
+    if(parent == rightmost_)
+        rightmost_ = new_node;
 
     ++size_;
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::node_type*
-rbtree<Value, Compare, Allocator>::enqueue_node(node_type* new_node, Direction enq_dir, 
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::node_type*
+rbtree<Value, Compare, Allocator, Policies...>::enqueue_node(node_type* new_node, Direction enq_dir, 
                                                 node_type* current, node_type* parent, 
                                                 node_type* grandparent, 
                                                 node_type* great_grandparent) 
@@ -1813,18 +3472,26 @@ rbtree<Value, Compare, Allocator>::enqueue_node(node_type* new_node, Direction e
     recolor_insert(current, parent, grandparent, great_grandparent);
     sentinel_->right->set_color(Color::Black);
 
+    /* Rotations keep the aggregates of the nodes they move consistent with
+     * their children, so only the ancestors of the new node are stale */
+    if constexpr(augmented)
+        update_path(new_node);
+
     return current;
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::node_type*
-rbtree<Value, Compare, Allocator>::dequeue_node(node_type* to_deq, node_type* to_deq_parent, node_type* descendant, node_type* descendant_parent) {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::node_type*
+rbtree<Value, Compare, Allocator, Policies...>::dequeue_node(node_type* to_deq, node_type* to_deq_parent, node_type* descendant, node_type* descendant_parent) {
     
     if(to_deq == leftmost_) 
         leftmost_ = successor(leftmost_);
     if(to_deq == rightmost_) 
         rightmost_ = predecessor(rightmost_);
 
+    /* Deepest node whose subtree has changed */
+    node_type* changed = to_deq_parent;
+
     /* Dequeueing a leaf */
     if(to_deq->is_leaf()) {
         if(to_deq_parent->left == to_deq) {
@@ -1867,6 +3534,8 @@ rbtree<Value, Compare, Allocator>::dequeue_node(node_type* to_deq, node_type* to
             to_deq_parent->left = descendant;
         else
             to_deq_parent->right = descendant;
+
+        changed = descendant_parent == to_deq ? descendant : descendant_parent;
     }
     /* Node to dequeue has exactly 1 child */
     else {
@@ -1888,20 +3557,25 @@ rbtree<Value, Compare, Allocator>::dequeue_node(node_type* to_deq, node_type* to
             succ->left = pred;
     }
 
+    if constexpr(augmented) {
+        if(changed != sentinel_)
+            update_path(changed);
+    }
+
     return to_deq;
 }
 
-template <typename Value, typename Compare, typename Allocator>
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
 template <typename T>
-std::pair<typename rbtree<Value, Compare, Allocator>::iterator, bool> 
-rbtree<Value, Compare, Allocator>::insert(T&& value, node_type* current) {
+std::pair<typename rbtree<Value, Compare, Allocator, Policies...>::iterator, bool> 
+rbtree<Value, Compare, Allocator, Policies...>::insert(T&& value, node_type* current) {
 
     node_type *parent = sentinel_, *grandparent = sentinel_, *great_grandparent = sentinel_;
 
     auto relation = insert_position(value, current, parent, grandparent, great_grandparent);
     
     if(relation == ValueRelation::Equal)
-        return {iterator{this, current}, false};
+        return {iterator{current}, false};
 
     node_type* new_node = allocate_node(std::forward<T>(value), nullptr, nullptr, 
                                         Color::Red, node_type::LEAF);
@@ -1909,13 +3583,13 @@ rbtree<Value, Compare, Allocator>::insert(T&& value, node_type* current) {
     node_type* node = enqueue_node(new_node, dir_from_value_rel(relation), current, 
                                    parent, grandparent, great_grandparent);
 
-    return {iterator{this, node}, true};
+    return {iterator{node}, true};
 }
 
-template <typename Value, typename Compare, typename Allocator>
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
 template <typename... Args>
-std::pair<typename rbtree<Value, Compare, Allocator>::iterator, bool> 
-rbtree<Value, Compare, Allocator>::emplace(node_type* current, Args&&... args) {
+std::pair<typename rbtree<Value, Compare, Allocator, Policies...>::iterator, bool> 
+rbtree<Value, Compare, Allocator, Policies...>::emplace(node_type* current, Args&&... args) {
     using zeroth_type = impl::remove_cvref_t<impl::nth_type_t<0, Args...>>;
 
     node_type *parent = sentinel_, *grandparent = sentinel_, *great_grandparent = sentinel_;
@@ -1931,53 +3605,79 @@ rbtree<Value, Compare, Allocator>::emplace(node_type* current, Args&&... args) {
                                  Color::Red, node_type::LEAF);
     }
     
-    ValueRelation relation = insert_position(*new_node, current, parent, grandparent, 
-                                              great_grandparent);
+    ValueRelation relation = insert_position(new_node->value(), current, parent, grandparent, 
+                                             great_grandparent);
     if(relation == ValueRelation::Equal) {
-        allocator_.deallocate(new_node, 1u);
-        return {iterator{this, current}, false};    
+        deallocate_node(new_node);
+        return {iterator{current}, false};    
     }
 
     node_type* node = enqueue_node(new_node, dir_from_value_rel(relation),
                                    current, parent, grandparent, great_grandparent);
 
-    return {iterator{this, node}, true};
+    return {iterator{node}, true};
 }
 
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::size_type
-rbtree<Value, Compare, Allocator>::erase(value_type const& value, node_type* current) {
-    using impl::equals;
-
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename T>
+typename rbtree<Value, Compare, Allocator, Policies...>::node_type*
+rbtree<Value, Compare, Allocator, Policies...>::remove(T const& value, node_type* current) {
     node_type *parent = sentinel_, *grandparent = sentinel_, *sibling = sentinel_;
+
+    /* Node to remove and the side of its parent it hangs from. With a single
+     * three-way comparison per level, it is the node equal to value, below
+     * which no more comparisons are needed. Otherwise it is the last node not
+     * less than value, i.e. its lower bound, which is checked for equality
+     * once the descent is over */
     node_type *found = nullptr, *found_parent = nullptr;
-    
+    Direction found_dir = Direction::Right;
+    bool known_equal = false;
+
     Direction dir;
-    
+
+    TRBT_COUNT(begin_descent());
     while(true) {
-        dir = static_cast<Direction>(compare_(current->value(), value));
-        
+        TRBT_COUNT(descend());
+        bool candidate;
+        if(known_equal) {
+            /* Below the node to remove lies its predecessor */
+            dir = Direction::Right;
+            candidate = false;
+        }
+        else if constexpr(three_way_search) {
+            ValueRelation rel = impl::relation(compare_, current->value(), value);
+            dir = rel == ValueRelation::Less ? Direction::Right : Direction::Left;
+            candidate = known_equal = rel == ValueRelation::Equal;
+        }
+        else {
+            dir = compare_(current->value(), value) ? Direction::Right : Direction::Left;
+            candidate = dir == Direction::Left;
+        }
+
         /* Ensure node to remove is red */
         if(current->color() == Color::Black && link(current, dir)->color() == Color::Black) {
             recolor_remove(dir, current, parent, grandparent, sibling);
 
-            /* Ensure rotations haven't separated found and found_parent */
-            if(found_parent && found_parent->right != found && found_parent->left != found) {
-                if(found_parent == sentinel_)
-                    found_parent = sentinel_->right;
-                else 
-                    found_parent = link(found_parent, static_cast<Direction>(
-                                           compare_(found_parent->value(), found->value())));
+            /* A rotation about found, which is then parent, moves the new
+             * root of the rotated subtree in between it and found_parent. The
+             * descent continued to the left of found, so found ends up on
+             * that side of the new root */
+            if(found) {
+                node_type* child = found_dir == Direction::Left ? found_parent->left : found_parent->right;
+                if(child != found) {
+                    found_parent = child;
+                    found_dir = Direction::Left;
+                }
             }
         }
 
-        /* Correct node found, store and keep moving down */
-        if(!found && equals<key_compare>(current->value(), value)) {
+        if(candidate) {
             found = current;
             found_parent = parent;
+            found_dir = static_cast<Direction>(parent->right == current);
         }
-        
+
         if(link(current, dir) == sentinel_)
             break;
 
@@ -1985,79 +3685,327 @@ rbtree<Value, Compare, Allocator>::erase(value_type const& value, node_type* cur
         parent      = current;
         sibling     = link(current, !dir);
         current     = link(current, dir);
-    } 
+    }
 
-    size_type deleted = 0u;
+    if(found && !known_equal && compare_(value, found->value()))
+        found = nullptr;
 
     if(found) {
-        allocator_.deallocate(dequeue_node(found, found_parent, current, parent), 1u);
+        dequeue_node(found, found_parent, current, parent);
         --size_;
-        ++deleted;
     }
 
     if(!empty())
         sentinel_->right->set_color(Color::Black);
 
-    return deleted;
+    return found;
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::node_type*
-rbtree<Value, Compare, Allocator>::lower_bound(value_type const& value, node_type* current) const {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::node_type*
+rbtree<Value, Compare, Allocator, Policies...>::remove_extreme(Direction side) {
+    node_type *current = sentinel_->right, *parent = sentinel_, 
+              *grandparent = sentinel_, *sibling = sentinel_;
+
+    /* The extreme node has no child on side, so the descent ends at it */
+    TRBT_COUNT(begin_descent());
     while(true) {
-        if(compare_(value, current->value())) {
-            if(!current->has_left_child())
+        TRBT_COUNT(descend());
+        if(current->color() == Color::Black && link(current, side)->color() == Color::Black)
+            recolor_remove(side, current, parent, grandparent, sibling);
+
+        if(link(current, side) == sentinel_)
+            break;
+
+        grandparent = parent;
+        parent      = current;
+        sibling     = link(current, !side);
+        current     = link(current, side);
+    }
+
+    dequeue_node(current, parent, current, parent);
+    --size_;
+
+    if(!empty())
+        sentinel_->right->set_color(Color::Black);
+
+    return current;
+}
+
+/* The node taking up a slot in the tree is node itself if it has at most one
+ * child, otherwise its predecessor, which replaces it. Removing that slot
+ * only upsets black heights if it was black and not replaced by a red child */
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+void rbtree<Value, Compare, Allocator, Policies...>::unlink(node_type* node) {
+    node_type* parent = parent_of(node);
+    node_type* slot = node;
+    node_type* slot_parent = parent;
+    if(node->has_left_child() && node->has_right_child()) {
+        slot = rightmost(node->left);
+        slot_parent = node->left == slot ? node : parent_of(slot);
+    }
+
+    /* Side of slot_parent the slot hangs from, and its child moving up if any */
+    Direction const dir = slot_parent->left == slot ? Direction::Left : Direction::Right;
+    node_type* child = slot->has_left_child() ? slot->left : 
+                       slot->has_right_child() ? slot->right : nullptr;
+    bool const black_lost = slot->color() == Color::Black;
+
+    dequeue_node(node, parent, slot, slot_parent);
+    --size_;
+
+    if(empty())
+        return;
+
+    if(black_lost) {
+        if(child)
+            child->set_color(Color::Black);
+        else
+            rebalance_removed(slot_parent == node ? slot : slot_parent, dir);
+    }
+    sentinel_->right->set_color(Color::Black);
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+void rbtree<Value, Compare, Allocator, Policies...>::rebalance_removed(node_type* parent, Direction dir) {
+    /* The short side of the root is as short as the other one once the root is reached */
+    while(parent != sentinel_) {
+        /* The other side is at least one black node high, so the sibling is a node */
+        node_type* sibling = link(parent, !dir);
+
+        /* Red sibling, rotate it above parent to get a black one */
+        if(sibling->color() == Color::Red) {
+            if(dir == Direction::Left)
+                left_rotate(parent, parent_of(parent));
+            else
+                right_rotate(parent, parent_of(parent));
+            sibling = link(parent, !dir);
+        }
+
+        node_type* far = link(sibling, !dir);
+        if(link(sibling, dir)->color() == Color::Black && far->color() == Color::Black) {
+            TRBT_COUNT(remove_recolors++);
+            sibling->set_color(Color::Red);
+
+            /* A red parent turning black makes up for the loss, otherwise
+             * the whole subtree of parent is short */
+            if(parent->color() == Color::Red) {
+                parent->set_color(Color::Black);
+                return;
+            }
+            node_type* grandparent = parent_of(parent);
+            dir = grandparent->left == parent ? Direction::Left : Direction::Right;
+            parent = grandparent;
+            continue;
+        }
+
+        /* Red near child only, rotate it into the sibling's place so that the far child is red */
+        if(far->color() == Color::Black) {
+            far = sibling;
+            if(dir == Direction::Left)
+                sibling = right_rotate(sibling, parent);
+            else
+                sibling = left_rotate(sibling, parent);
+        }
+
+        /* Rotating the sibling above parent adds a black node on the short side */
+        Color const color = parent->color();
+        if(dir == Direction::Left)
+            left_rotate(parent, parent_of(parent));
+        else
+            right_rotate(parent, parent_of(parent));
+
+        sibling->set_color(color);
+        parent->set_color(Color::Black);
+        far->set_color(Color::Black);
+        return;
+    }
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+std::pair<typename rbtree<Value, Compare, Allocator, Policies...>::node_type*, typename rbtree<Value, Compare, Allocator, Policies...>::node_type*>
+rbtree<Value, Compare, Allocator, Policies...>::range_bounds(value_type const& lo, value_type const& hi) const {
+    if(empty() || compare_(hi, lo))
+        return {sentinel_, sentinel_};
+
+    return {lower_bound(lo, sentinel_->right), upper_bound(hi, sentinel_->right)};
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename Reference, bool Reverse, typename F>
+F rbtree<Value, Compare, Allocator, Policies...>::traverse(node_type* first, node_type* last, F f) const {
+    /* Following the threads is a single chain of dependent loads. While
+     * descending towards the next node, the children on the far side of the
+     * nodes passed, which are visited later, are prefetched so that their
+     * loads overlap with the chain */
+    auto const inward  = Reverse ? &node_type::right : &node_type::left;
+    auto const outward = Reverse ? &node_type::left : &node_type::right;
+    auto const has_inward_child  = [](node_type* t) {
+        return Reverse ? t->has_right_child() : t->has_left_child();
+    };
+    auto const has_outward_child = [](node_type* t) {
+        return Reverse ? t->has_left_child() : t->has_right_child();
+    };
+
+    while(first != last) {
+        node_type* next = first->*outward;
+        if(has_outward_child(first)) {
+            while(has_inward_child(next)) {
+                if(has_outward_child(next))
+                    impl::prefetch(next->*outward);
+                next = next->*inward;
+            }
+            if(has_outward_child(next))
+                impl::prefetch(next->*outward);
+        }
+        f(static_cast<Reference>(first->value()));
+        first = next;
+    }
+    return f;
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename Reference, typename F>
+F rbtree<Value, Compare, Allocator, Policies...>::traverse_range_reverse(value_type const& lo, value_type const& hi, F f) const {
+    auto [first, last] = range_bounds(lo, hi);
+    if(first == last)
+        return f;
+
+    /* The predecessor of the leftmost node is the sentinel */
+    return traverse<Reference, true>(last == sentinel_ ? rightmost_ : predecessor(last), 
+                                     predecessor(first), std::move(f));
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename T>
+typename rbtree<Value, Compare, Allocator, Policies...>::node_type*
+rbtree<Value, Compare, Allocator, Policies...>::lower_bound(T const& value, node_type* current) const {
+    /* Nearest node not less than value to the right of the path so far */
+    node_type* bound = sentinel_;
+
+    TRBT_COUNT(begin_descent());
+    while(true) {
+        TRBT_COUNT(descend());
+        bool left;
+        if constexpr(three_way_search) {
+            auto rel = impl::relation(compare_, value, current->value());
+            if(rel == ValueRelation::Equal)
                 return current;
+            left = rel == ValueRelation::Less;
+        }
+        else
+            left = !compare_(current->value(), value);
 
+        if(left) {
+            bound = current;
+            if(!current->has_left_child())
+                break;
             current = current->left;
         }
-        else if(compare_(current->value(), value)) {
-            node_type* succ = successor(current);
-            if(succ == sentinel_)
+        else {
+            if(!current->has_right_child())
                 break;
-            else if(!compare_(succ->value(), value))
-                return succ;
-
             current = current->right;
         }
+    }
+    return bound;
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename rbtree<Value, Compare, Allocator, Policies...>::node_type*
+rbtree<Value, Compare, Allocator, Policies...>::upper_bound(value_type const& value, node_type* current) const {
+    /* Nearest node greater than value to the right of the path so far */
+    node_type* bound = sentinel_;
+
+    TRBT_COUNT(begin_descent());
+    while(true) {
+        TRBT_COUNT(descend());
+        bool left;
+        if constexpr(three_way_search) {
+            /* The successor is the leftmost node of the right subtree, so
+             * this is still a single path from the root */
+            auto rel = impl::relation(compare_, value, current->value());
+            if(rel == ValueRelation::Equal)
+                return successor(current);
+            left = rel == ValueRelation::Less;
+        }
         else
-            return current;
+            left = compare_(value, current->value());
+
+        if(left) {
+            bound = current;
+            if(!current->has_left_child())
+                break;
+            current = current->left;
+        }
+        else {
+            if(!current->has_right_child())
+                break;
+            current = current->right;
+        }
     }
-    return sentinel_;
+    return bound;
 }
 
-template <typename Value, typename Compare, typename Allocator>
-typename rbtree<Value, Compare, Allocator>::node_type*
-rbtree<Value, Compare, Allocator>::upper_bound(value_type const& value, node_type* current) const {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+std::pair<typename rbtree<Value, Compare, Allocator, Policies...>::node_type*, typename rbtree<Value, Compare, Allocator, Policies...>::node_type*>
+rbtree<Value, Compare, Allocator, Policies...>::equal_range(value_type const& value, node_type* current) const {
+    /* Nearest node greater than value to the right of the path so far */
+    node_type* upper = sentinel_;
+
+    TRBT_COUNT(begin_descent());
     while(true) {
-        if(compare_(value, current->value())) {
+        TRBT_COUNT(descend());
+        auto rel = impl::relation(compare_, value, current->value());
+
+        if(rel == ValueRelation::Less) {
+            upper = current;
             if(!current->has_left_child())
-                return current;
+                return {upper, upper};
 
             current = current->left;
         }
-        else if(compare_(current->value(), value)) {
-            node_type* succ = successor(current);
-            if(succ == sentinel_)
-                break;
-            else if(compare_(value, succ->value()))
-                return succ;
+        else if(rel == ValueRelation::Greater) {
+            if(!current->has_right_child())
+                return {upper, upper};
 
             current = current->right;
         }
         else
-            return successor(current);
+            break;
     }
 
-    return sentinel_;
-}
+    if constexpr(!multi)
+        return {current, successor(current)};
 
+    /* Values equal to current may lie in both of its subtrees */
+    node_type* lower = current;
+    for(node_type* node = link(current, Direction::Left); node != sentinel_;) {
+        TRBT_COUNT(descend());
+        if(compare_(node->value(), value))
+            node = link(node, Direction::Right);
+        else {
+            lower = node;
+            node = link(node, Direction::Left);
+        }
+    }
+    for(node_type* node = link(current, Direction::Right); node != sentinel_;) {
+        TRBT_COUNT(descend());
+        if(compare_(value, node->value())) {
+            upper = node;
+            node = link(node, Direction::Left);
+        }
+        else
+            node = link(node, Direction::Right);
+    }
 
+    return {lower, upper};
+}
             
 #ifdef TRBT_DEBUG
-template <typename Value, typename Compare, typename Allocator>
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
 template <typename StringConverter>
-int rbtree<Value, Compare, Allocator>::assert_properties_ok(node_type* t, StringConverter sc) const {
+int rbtree<Value, Compare, Allocator, Policies...>::assert_properties_ok(node_type* t, StringConverter sc) const {
     node_type *lh = link(t, Direction::Left), *rh = link(t, Direction::Right);
     
     if(t->color() == Color::Red) {
@@ -2066,13 +4014,14 @@ int rbtree<Value, Compare, Allocator>::assert_properties_ok(node_type* t, String
                                             " is red and has red children\n"};
     }
 
-    if(lh != sentinel_ && !compare_(lh->value(), t->value())) {
+    /* Equal values may end up on either side of each other after rotations */
+    if(lh != sentinel_ && (multi ? compare_(t->value(), lh->value()) : !compare_(lh->value(), t->value()))) {
         throw bst_property_violation_exception{"Bst property violated by node " + 
                                                 sc(t->value()) + 
                                                " and its left child " + 
                                                 sc(lh->value()) + "\n"};
     }
-    if(rh != sentinel_ && !compare_(t->value(), rh->value())) {
+    if(rh != sentinel_ && (multi ? compare_(rh->value(), t->value()) : !compare_(t->value(), rh->value()))) {
         throw bst_property_violation_exception{"BST property violated by node " +
                                                 sc(t->value()) + 
                                                " and its right child " + 
@@ -2107,8 +4056,8 @@ int rbtree<Value, Compare, Allocator>::assert_properties_ok(node_type* t, String
     return height_contribution - 1;
 }
 
-template <typename Value, typename Compare, typename Allocator>
-int rbtree<Value, Compare, Allocator>::assert_leftmost_ok() const {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+int rbtree<Value, Compare, Allocator, Policies...>::assert_leftmost_ok() const {
     using namespace impl;
 
     if(empty()) {
@@ -2128,8 +4077,8 @@ int rbtree<Value, Compare, Allocator>::assert_leftmost_ok() const {
     return flags;
 }
 
-template <typename Value, typename Compare, typename Allocator>
-int rbtree<Value, Compare, Allocator>::assert_rightmost_ok() const {
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+int rbtree<Value, Compare, Allocator, Policies...>::assert_rightmost_ok() const {
     using namespace impl;
 
     if(empty())
@@ -2149,6 +4098,418 @@ int rbtree<Value, Compare, Allocator>::assert_rightmost_ok() const {
 }
 #endif
 
+/* Immutable snapshot of an rbtree, stored in Eytzinger (BFS) order in a single 
+ * allocation. The children of the value at index k are found at indices 2k and 2k + 1, 
+ * allowing branch-free searches that prefetch the descendants several levels ahead */
+template <typename Value, 
+          typename Compare = std::less<Value>, 
+          typename Allocator = std::allocator<impl::add_const_to_key_if_pair_t<impl::remove_cvref_t<Value>>>,
+          typename... Policies>
+class frozen_rbtree {
+    template <typename, typename>
+    friend class impl::frozen_iterator_type;
+
+    /* The policies of the tree frozen decide how values are compared and
+     * whether equal ones may occur. Aggregates are not carried over */
+    using tree_type = rbtree<Value, Compare, Allocator, Policies...>;
+    using Alloc     = typename std::allocator_traits<Allocator>::template 
+                                    rebind_alloc<impl::value_type_t<impl::remove_cvref_t<Value>>>;
+    using ValueRelation = impl::ValueRelation;
+
+    public:
+        using key_type               = typename tree_type::key_type;
+        using mapped_type            = typename tree_type::mapped_type;
+        using value_type             = typename tree_type::value_type;
+        using size_type              = typename tree_type::size_type;
+        using difference_type        = typename tree_type::difference_type;
+        using key_compare            = typename tree_type::key_compare;
+        using value_compare          = typename tree_type::value_compare;
+        using allocator_type         = Allocator;
+        using reference              = value_type&;
+        using const_reference        = value_type const&;
+        using pointer                = value_type*;
+        using const_pointer          = value_type const*;
+        using iterator               = impl::frozen_iterator_type<frozen_rbtree, impl::non_reverse_tag>;
+        using const_iterator         = iterator;
+        using reverse_iterator       = impl::frozen_iterator_type<frozen_rbtree, impl::reverse_tag>;
+        using const_reverse_iterator = reverse_iterator;
+
+        frozen_rbtree() = default;
+        explicit frozen_rbtree(tree_type const& tree);
+
+        frozen_rbtree(frozen_rbtree const& other);
+        frozen_rbtree(frozen_rbtree&& other) noexcept;
+
+        ~frozen_rbtree();
+
+        frozen_rbtree& operator=(frozen_rbtree const& other) &;
+        frozen_rbtree& operator=(frozen_rbtree&& other) & noexcept;
+
+        inline bool empty() const noexcept;
+        inline size_type size() const noexcept;
+
+        allocator_type get_allocator() const;
+
+        bool contains(value_type const& value) const;
+        size_type count(value_type const& value) const;
+        const_iterator find(value_type const& value) const;
+
+        template <typename T = tree_type, typename = impl::enable_if_keyed_t<T>>
+        bool contains(key_type const& key) const;
+        template <typename T = tree_type, typename = impl::enable_if_keyed_t<T>>
+        const_iterator find(key_type const& key) const;
+
+        template <typename T = tree_type, typename = impl::enable_if_unique_map_t<T>>
+        mapped_type const& at(key_type const& key) const;
+
+        const_iterator lower_bound(value_type const& value) const;
+        const_iterator upper_bound(value_type const& value) const;
+        std::pair<const_iterator, const_iterator> equal_range(value_type const& value) const;
+
+        const_iterator begin() const noexcept;
+        const_iterator end() const noexcept;
+        const_iterator cbegin() const noexcept;
+        const_iterator cend() const noexcept;
+
+        const_reverse_iterator rbegin() const noexcept;
+        const_reverse_iterator rend() const noexcept;
+        const_reverse_iterator crbegin() const noexcept;
+        const_reverse_iterator crend() const noexcept;
+
+        void swap(frozen_rbtree& other) noexcept;
+
+    private:
+        value_type* data_{nullptr};
+        size_type size_{};
+        Alloc allocator_{};
+        key_compare compare_{};
+
+        template <typename Less>
+        size_type descend(Less less) const;
+
+        /* Index of the first value equal to value, which may also be a key, 0 if there is none */
+        template <typename T>
+        size_type find_index(T const& value) const;
+
+        size_type first() const noexcept;
+        size_type last() const noexcept;
+        size_type successor(size_type index) const noexcept;
+        size_type predecessor(size_type index) const noexcept;
+
+        void destroy() noexcept;
+};
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+frozen_rbtree<Value, Compare, Allocator, Policies...>::frozen_rbtree(tree_type const& tree) 
+    : data_{nullptr}, size_{tree.size()}, allocator_{tree.get_allocator()}, compare_{} {
+    if(!size_)
+        return;
+
+    /* Index 0 is left unused */
+    data_ = allocator_.allocate(size_ + 1u);
+
+    /* Visit the implicit tree in order while traversing the original one */
+    size_type index = first();
+    for(auto const& value : tree) {
+        std::allocator_traits<Alloc>::construct(allocator_, data_ + index, value);
+        index = successor(index);
+    }
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+frozen_rbtree<Value, Compare, Allocator, Policies...>::frozen_rbtree(frozen_rbtree const& other) 
+    : data_{nullptr}, size_{other.size_}, allocator_{other.allocator_}, compare_{other.compare_} {
+    if(!size_)
+        return;
+
+    data_ = allocator_.allocate(size_ + 1u);
+    for(size_type i = 1u; i <= size_; i++)
+        std::allocator_traits<Alloc>::construct(allocator_, data_ + i, other.data_[i]);
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+frozen_rbtree<Value, Compare, Allocator, Policies...>::frozen_rbtree(frozen_rbtree&& other) noexcept
+    : data_{other.data_}, size_{other.size_}, allocator_{std::move(other.allocator_)}, 
+      compare_{std::move(other.compare_)} {
+    other.data_ = nullptr;
+    other.size_ = 0u;
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+frozen_rbtree<Value, Compare, Allocator, Policies...>::~frozen_rbtree() {
+    destroy();
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+frozen_rbtree<Value, Compare, Allocator, Policies...>&
+frozen_rbtree<Value, Compare, Allocator, Policies...>::operator=(frozen_rbtree const& other) & {
+    auto cpy{other};
+    swap(cpy);
+    return *this;
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+frozen_rbtree<Value, Compare, Allocator, Policies...>&
+frozen_rbtree<Value, Compare, Allocator, Policies...>::operator=(frozen_rbtree&& other) & noexcept {
+    swap(other);
+    return *this;
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+bool frozen_rbtree<Value, Compare, Allocator, Policies...>::empty() const noexcept {
+    return !size_;
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename frozen_rbtree<Value, Compare, Allocator, Policies...>::size_type
+frozen_rbtree<Value, Compare, Allocator, Policies...>::size() const noexcept {
+    return size_;
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename frozen_rbtree<Value, Compare, Allocator, Policies...>::allocator_type
+frozen_rbtree<Value, Compare, Allocator, Policies...>::get_allocator() const {
+    return allocator_;
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+bool frozen_rbtree<Value, Compare, Allocator, Policies...>::contains(value_type const& value) const {
+    return find(value) != end();
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename frozen_rbtree<Value, Compare, Allocator, Policies...>::size_type
+frozen_rbtree<Value, Compare, Allocator, Policies...>::count(value_type const& value) const {
+    /* Equal values are adjacent in order, starting at the one find returns */
+    size_type n = 0u;
+    for(size_type index = find_index(value); index && !compare_(value, data_[index]); index = successor(index))
+        ++n;
+    return n;
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename frozen_rbtree<Value, Compare, Allocator, Policies...>::const_iterator
+frozen_rbtree<Value, Compare, Allocator, Policies...>::find(value_type const& value) const {
+    return const_iterator{this, find_index(value)};
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename, typename>
+bool frozen_rbtree<Value, Compare, Allocator, Policies...>::contains(key_type const& key) const {
+    return find_index(key) != 0u;
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename, typename>
+typename frozen_rbtree<Value, Compare, Allocator, Policies...>::const_iterator
+frozen_rbtree<Value, Compare, Allocator, Policies...>::find(key_type const& key) const {
+    return const_iterator{this, find_index(key)};
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename, typename>
+typename frozen_rbtree<Value, Compare, Allocator, Policies...>::mapped_type const& 
+frozen_rbtree<Value, Compare, Allocator, Policies...>::at(key_type const& key) const {
+
+    if(auto it = find(key); it != end())
+        return it->second;
+
+    throw std::out_of_range{"Specified key not in tree"};
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename frozen_rbtree<Value, Compare, Allocator, Policies...>::const_iterator
+frozen_rbtree<Value, Compare, Allocator, Policies...>::lower_bound(value_type const& value) const {
+    return const_iterator{this, descend([this, &value](value_type const& current) {
+        return compare_(current, value);
+    })};
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename frozen_rbtree<Value, Compare, Allocator, Policies...>::const_iterator
+frozen_rbtree<Value, Compare, Allocator, Policies...>::upper_bound(value_type const& value) const {
+    return const_iterator{this, descend([this, &value](value_type const& current) {
+        return !compare_(value, current);
+    })};
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+std::pair<typename frozen_rbtree<Value, Compare, Allocator, Policies...>::const_iterator,
+          typename frozen_rbtree<Value, Compare, Allocator, Policies...>::const_iterator>
+frozen_rbtree<Value, Compare, Allocator, Policies...>::equal_range(value_type const& value) const {
+    return {lower_bound(value), upper_bound(value)};
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename frozen_rbtree<Value, Compare, Allocator, Policies...>::const_iterator
+frozen_rbtree<Value, Compare, Allocator, Policies...>::begin() const noexcept {
+    return const_iterator{this, first()};
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename frozen_rbtree<Value, Compare, Allocator, Policies...>::const_iterator
+frozen_rbtree<Value, Compare, Allocator, Policies...>::end() const noexcept {
+    return const_iterator{this, 0u};
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename frozen_rbtree<Value, Compare, Allocator, Policies...>::const_iterator
+frozen_rbtree<Value, Compare, Allocator, Policies...>::cbegin() const noexcept {
+    return begin();
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename frozen_rbtree<Value, Compare, Allocator, Policies...>::const_iterator
+frozen_rbtree<Value, Compare, Allocator, Policies...>::cend() const noexcept {
+    return end();
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename frozen_rbtree<Value, Compare, Allocator, Policies...>::const_reverse_iterator
+frozen_rbtree<Value, Compare, Allocator, Policies...>::rbegin() const noexcept {
+    return const_reverse_iterator{this, last()};
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename frozen_rbtree<Value, Compare, Allocator, Policies...>::const_reverse_iterator
+frozen_rbtree<Value, Compare, Allocator, Policies...>::rend() const noexcept {
+    return const_reverse_iterator{this, 0u};
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename frozen_rbtree<Value, Compare, Allocator, Policies...>::const_reverse_iterator
+frozen_rbtree<Value, Compare, Allocator, Policies...>::crbegin() const noexcept {
+    return rbegin();
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename frozen_rbtree<Value, Compare, Allocator, Policies...>::const_reverse_iterator
+frozen_rbtree<Value, Compare, Allocator, Policies...>::crend() const noexcept {
+    return rend();
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+void frozen_rbtree<Value, Compare, Allocator, Policies...>::swap(frozen_rbtree& other) noexcept {
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    std::swap(allocator_, other.allocator_);
+    std::swap(compare_, other.compare_);
+}
+
+template <typename Val_, typename Comp_, typename Alloc_, typename... Pol_>
+void swap(frozen_rbtree<Val_, Comp_, Alloc_, Pol_...>& left, frozen_rbtree<Val_, Comp_, Alloc_, Pol_...>& right) noexcept {
+    left.swap(right);
+}
+
+/* Descends to the bottom of the implicit tree, going right whenever less 
+ * holds for the current value. The last node at which the search turned
+ * left is found by stripping the trailing right turns from the index */
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename Less>
+typename frozen_rbtree<Value, Compare, Allocator, Policies...>::size_type
+frozen_rbtree<Value, Compare, Allocator, Policies...>::descend(Less less) const {
+    /* Descendants four levels down occupy 16 consecutive slots */
+    size_type constexpr prefetch_distance = 16u;
+
+    size_type index = 1u;
+    while(index <= size_) {
+        impl::prefetch(reinterpret_cast<void const*>(
+                       reinterpret_cast<std::uintptr_t>(data_) + 
+                       prefetch_distance * index * sizeof(value_type)));
+        index = 2u * index + static_cast<size_type>(less(data_[index]));
+    }
+
+    return index >> (impl::trailing_ones(index) + 1u);
+}
+
+/* The lower bound of value is the first value equal to it if there is one */
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+template <typename T>
+typename frozen_rbtree<Value, Compare, Allocator, Policies...>::size_type
+frozen_rbtree<Value, Compare, Allocator, Policies...>::find_index(T const& value) const {
+    size_type index = descend([this, &value](value_type const& current) {
+        return compare_(current, value);
+    });
+
+    if(index && compare_(value, data_[index]))
+        index = 0u;
+
+    return index;
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename frozen_rbtree<Value, Compare, Allocator, Policies...>::size_type
+frozen_rbtree<Value, Compare, Allocator, Policies...>::first() const noexcept {
+    size_type index = 0u;
+    if(size_) {
+        index = 1u;
+        while(2u * index <= size_)
+            index *= 2u;
+    }
+    return index;
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename frozen_rbtree<Value, Compare, Allocator, Policies...>::size_type
+frozen_rbtree<Value, Compare, Allocator, Policies...>::last() const noexcept {
+    size_type index = 0u;
+    if(size_) {
+        index = 1u;
+        while(2u * index + 1u <= size_)
+            index = 2u * index + 1u;
+    }
+    return index;
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename frozen_rbtree<Value, Compare, Allocator, Policies...>::size_type
+frozen_rbtree<Value, Compare, Allocator, Policies...>::successor(size_type index) const noexcept {
+    if(!index)
+        return first();
+
+    if(2u * index + 1u <= size_) {
+        index = 2u * index + 1u;
+        while(2u * index <= size_)
+            index *= 2u;
+        return index;
+    }
+
+    /* Climb while index is a right child, then once more */
+    return index >> (impl::trailing_ones(index) + 1u);
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+typename frozen_rbtree<Value, Compare, Allocator, Policies...>::size_type
+frozen_rbtree<Value, Compare, Allocator, Policies...>::predecessor(size_type index) const noexcept {
+    if(!index)
+        return last();
+
+    if(2u * index <= size_) {
+        index = 2u * index;
+        while(2u * index + 1u <= size_)
+            index = 2u * index + 1u;
+        return index;
+    }
+
+    /* Climb while index is a left child, then once more */
+    return index >> (impl::trailing_zeros(index) + 1u);
+}
+
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+void frozen_rbtree<Value, Compare, Allocator, Policies...>::destroy() noexcept {
+    if(!data_)
+        return;
+
+    for(size_type i = 1u; i <= size_; i++)
+        std::allocator_traits<Alloc>::destroy(allocator_, data_ + i);
+
+    allocator_.deallocate(data_, size_ + 1u);
+    data_ = nullptr;
+    size_ = 0u;
+}
+
 } /* namespace trbt */
 
+#undef TRBT_COUNT
+
 #endif
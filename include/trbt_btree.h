@@ -0,0 +1,454 @@
+#ifndef TRBT_BTREE_H
+#define TRBT_BTREE_H
+
+#pragma once
+#include "trbt.h"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if defined __AVX2__ || defined __SSE2__
+#include <immintrin.h>
+#endif
+
+namespace trbt {
+
+namespace impl {
+    template <typename Key>
+    inline bool constexpr is_btree_key_v = is_one_of_v<Key, std::int32_t, std::int64_t, double>;
+
+    inline unsigned popcount(unsigned value) noexcept {
+        #if defined __GNUC__
+        return static_cast<unsigned>(__builtin_popcount(value));
+        #else
+        unsigned count = 0u;
+        for(; value; value &= value - 1u)
+            ++count;
+        return count;
+        #endif
+    }
+
+    /* Number of keys in the sorted block of N keys that are less than (or,
+     * if Upper is set, less than or equal to) value. Uses AVX2 or SSE when
+     * available and falls back on a branch-free scalar loop otherwise */
+    template <bool Upper, std::size_t N, typename Key>
+    unsigned count_preceding(Key const* keys, Key value) noexcept {
+        static_assert(N % 8u == 0u);
+
+        #if defined __AVX2__
+        if constexpr(std::is_same_v<Key, std::int32_t>) {
+            __m256i const v = _mm256_set1_epi32(value);
+            unsigned mask = 0u;
+            for(std::size_t i = 0u; i < N; i += 8u) {
+                __m256i const k = _mm256_load_si256(reinterpret_cast<__m256i const*>(keys + i));
+                __m256i const cmp = Upper ? _mm256_cmpgt_epi32(k, v) : _mm256_cmpgt_epi32(v, k);
+                mask |= static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(cmp))) << i;
+            }
+            return Upper ? N - popcount(mask) : popcount(mask);
+        }
+        else if constexpr(std::is_same_v<Key, std::int64_t>) {
+            __m256i const v = _mm256_set1_epi64x(value);
+            unsigned mask = 0u;
+            for(std::size_t i = 0u; i < N; i += 4u) {
+                __m256i const k = _mm256_load_si256(reinterpret_cast<__m256i const*>(keys + i));
+                __m256i const cmp = Upper ? _mm256_cmpgt_epi64(k, v) : _mm256_cmpgt_epi64(v, k);
+                mask |= static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(cmp))) << i;
+            }
+            return Upper ? N - popcount(mask) : popcount(mask);
+        }
+        else if constexpr(std::is_same_v<Key, double>) {
+            __m256d const v = _mm256_set1_pd(value);
+            unsigned mask = 0u;
+            for(std::size_t i = 0u; i < N; i += 4u) {
+                __m256d const k = _mm256_load_pd(keys + i);
+                __m256d const cmp = Upper ? _mm256_cmp_pd(k, v, _CMP_LE_OQ) : _mm256_cmp_pd(k, v, _CMP_LT_OQ);
+                mask |= static_cast<unsigned>(_mm256_movemask_pd(cmp)) << i;
+            }
+            return popcount(mask);
+        }
+        else
+        #elif defined __SSE2__
+        if constexpr(std::is_same_v<Key, std::int32_t>) {
+            __m128i const v = _mm_set1_epi32(value);
+            unsigned mask = 0u;
+            for(std::size_t i = 0u; i < N; i += 4u) {
+                __m128i const k = _mm_load_si128(reinterpret_cast<__m128i const*>(keys + i));
+                __m128i const cmp = Upper ? _mm_cmpgt_epi32(k, v) : _mm_cmpgt_epi32(v, k);
+                mask |= static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(cmp))) << i;
+            }
+            return Upper ? N - popcount(mask) : popcount(mask);
+        }
+        #if defined __SSE4_2__
+        else if constexpr(std::is_same_v<Key, std::int64_t>) {
+            __m128i const v = _mm_set1_epi64x(value);
+            unsigned mask = 0u;
+            for(std::size_t i = 0u; i < N; i += 2u) {
+                __m128i const k = _mm_load_si128(reinterpret_cast<__m128i const*>(keys + i));
+                __m128i const cmp = Upper ? _mm_cmpgt_epi64(k, v) : _mm_cmpgt_epi64(v, k);
+                mask |= static_cast<unsigned>(_mm_movemask_pd(_mm_castsi128_pd(cmp))) << i;
+            }
+            return Upper ? N - popcount(mask) : popcount(mask);
+        }
+        #endif
+        else if constexpr(std::is_same_v<Key, double>) {
+            __m128d const v = _mm_set1_pd(value);
+            unsigned mask = 0u;
+            for(std::size_t i = 0u; i < N; i += 2u) {
+                __m128d const k = _mm_load_pd(keys + i);
+                __m128d const cmp = Upper ? _mm_cmple_pd(k, v) : _mm_cmplt_pd(k, v);
+                mask |= static_cast<unsigned>(_mm_movemask_pd(cmp)) << i;
+            }
+            return popcount(mask);
+        }
+        else
+        #endif
+        {
+            unsigned count = 0u;
+            for(std::size_t i = 0u; i < N; i++)
+                count += static_cast<unsigned>(Upper ? !(value < keys[i]) : keys[i] < value);
+            return count;
+        }
+    }
+} /* namespace impl */
+
+/* Read-only static B+-tree over arithmetic keys. The sorted keys are stored in
+ * leaves of BlockSize keys each. Every internal node holds BlockSize separators,
+ * the largest key of each of its first BlockSize children, and has BlockSize + 1
+ * children. Nodes are cache line aligned and all levels share one allocation.
+ * Within a node, the child to descend into is found by counting the number of
+ * separators less than the value searched for using SIMD comparisons */
+template <typename Key, std::size_t BlockSize = 16u>
+class frozen_btree {
+    static_assert(impl::is_btree_key_v<Key>, "Key must be a 32 or 64 bit signed integer or a double");
+    static_assert(BlockSize == 16u || BlockSize == 32u, "BlockSize must be either 16 or 32");
+
+    public:
+        using key_type               = Key;
+        using value_type             = Key;
+        using size_type              = std::size_t;
+        using difference_type        = std::ptrdiff_t;
+        using key_compare            = std::less<Key>;
+        using reference              = value_type const&;
+        using const_reference        = value_type const&;
+        using pointer                = value_type const*;
+        using const_pointer          = value_type const*;
+        using iterator               = value_type const*;
+        using const_iterator         = value_type const*;
+        using reverse_iterator       = std::reverse_iterator<const_iterator>;
+        using const_reverse_iterator = reverse_iterator;
+
+        frozen_btree() = default;
+
+        template <typename Compare, typename Allocator, typename... Policies>
+        explicit frozen_btree(rbtree<Key, Compare, Allocator, Policies...> const& tree);
+
+        frozen_btree(frozen_btree const& other);
+        frozen_btree(frozen_btree&& other) noexcept;
+
+        ~frozen_btree();
+
+        frozen_btree& operator=(frozen_btree const& other) &;
+        frozen_btree& operator=(frozen_btree&& other) & noexcept;
+
+        inline bool empty() const noexcept;
+        inline size_type size() const noexcept;
+
+        bool contains(value_type value) const noexcept;
+        size_type count(value_type value) const noexcept;
+        const_iterator find(value_type value) const noexcept;
+
+        const_iterator lower_bound(value_type value) const noexcept;
+        const_iterator upper_bound(value_type value) const noexcept;
+        std::pair<const_iterator, const_iterator> equal_range(value_type value) const noexcept;
+
+        const_iterator begin() const noexcept;
+        const_iterator end() const noexcept;
+        const_iterator cbegin() const noexcept;
+        const_iterator cend() const noexcept;
+
+        const_reverse_iterator rbegin() const noexcept;
+        const_reverse_iterator rend() const noexcept;
+        const_reverse_iterator crbegin() const noexcept;
+        const_reverse_iterator crend() const noexcept;
+
+        void swap(frozen_btree& other) noexcept;
+
+    private:
+        static std::size_t constexpr ALIGNMENT  = 64u;
+        static size_type constexpr   MAX_LEVELS = 32u;
+        static size_type constexpr   FANOUT     = BlockSize + 1u;
+
+        Key* keys_{nullptr};
+        size_type size_{};
+        size_type nodes_{};
+        size_type levels_{};
+        /* Offset, in nodes, of the first node of each level. Level 0 holds the leaves */
+        size_type offsets_[MAX_LEVELS]{};
+        size_type widths_[MAX_LEVELS]{};
+
+        static Key constexpr padding() noexcept;
+
+        void allocate(size_type nodes);
+        void deallocate() noexcept;
+
+        template <bool Upper>
+        size_type search(value_type value) const noexcept;
+};
+
+template <typename Key, typename Compare, typename Allocator, typename... Policies>
+frozen_btree<Key> freeze_btree(rbtree<Key, Compare, Allocator, Policies...> const& tree) {
+    return frozen_btree<Key>{tree};
+}
+
+template <typename Key, std::size_t BlockSize>
+template <typename Compare, typename Allocator, typename... Policies>
+frozen_btree<Key, BlockSize>::frozen_btree(rbtree<Key, Compare, Allocator, Policies...> const& tree)
+    : keys_{nullptr}, size_{tree.size()}, nodes_{}, levels_{}, offsets_{}, widths_{} {
+    static_assert(std::is_same_v<Compare, std::less<Key>>, "Only trees ordered by std::less can be converted");
+    static_assert(!impl::has_key_projection_v<rbtree<Key, Compare, Allocator, Policies...>>,
+                  "Trees ordered by projected keys cannot be converted");
+
+    if(!size_)
+        return;
+
+    widths_[0] = (size_ + BlockSize - 1u) / BlockSize;
+    nodes_ = widths_[0];
+    levels_ = 1u;
+    while(widths_[levels_ - 1u] > 1u) {
+        widths_[levels_] = (widths_[levels_ - 1u] + FANOUT - 1u) / FANOUT;
+        nodes_ += widths_[levels_];
+        ++levels_;
+    }
+
+    offsets_[0] = 0u;
+    for(size_type l = 1u; l < levels_; l++)
+        offsets_[l] = offsets_[l - 1u] + widths_[l - 1u];
+
+    allocate(nodes_);
+
+    /* Leaves, padded with the largest representable key */
+    Key* out = keys_;
+    for(auto value : tree)
+        *out++ = value;
+    for(Key* pad = keys_ + widths_[0] * BlockSize; out != pad; ++out)
+        *out = padding();
+
+    /* Separators are the largest keys of the children. The largest key in
+     * the subtree of a node is the last key of its rightmost leaf */
+    for(size_type l = 1u; l < levels_; l++) {
+        for(size_type node = 0u; node < widths_[l]; node++) {
+            Key* separators = keys_ + (offsets_[l] + node) * BlockSize;
+            for(size_type i = 0u; i < BlockSize; i++) {
+                size_type child = node * FANOUT + i;
+                if(child >= widths_[l - 1u]) {
+                    separators[i] = padding();
+                    continue;
+                }
+
+                size_type level = l - 1u;
+                for(; level > 0u; --level) {
+                    size_type last = child * FANOUT + BlockSize;
+                    child = last < widths_[level - 1u] ? last : widths_[level - 1u] - 1u;
+                }
+
+                separators[i] = keys_[(child + 1u) * BlockSize - 1u];
+            }
+        }
+    }
+}
+
+template <typename Key, std::size_t BlockSize>
+frozen_btree<Key, BlockSize>::frozen_btree(frozen_btree const& other)
+    : keys_{nullptr}, size_{other.size_}, nodes_{other.nodes_}, levels_{other.levels_},
+      offsets_{}, widths_{} {
+    std::copy(std::begin(other.offsets_), std::end(other.offsets_), std::begin(offsets_));
+    std::copy(std::begin(other.widths_), std::end(other.widths_), std::begin(widths_));
+
+    if(nodes_) {
+        allocate(nodes_);
+        std::copy(other.keys_, other.keys_ + nodes_ * BlockSize, keys_);
+    }
+}
+
+template <typename Key, std::size_t BlockSize>
+frozen_btree<Key, BlockSize>::frozen_btree(frozen_btree&& other) noexcept
+    : keys_{nullptr}, size_{}, nodes_{}, levels_{}, offsets_{}, widths_{} {
+    swap(other);
+}
+
+template <typename Key, std::size_t BlockSize>
+frozen_btree<Key, BlockSize>::~frozen_btree() {
+    deallocate();
+}
+
+template <typename Key, std::size_t BlockSize>
+frozen_btree<Key, BlockSize>& frozen_btree<Key, BlockSize>::operator=(frozen_btree const& other) & {
+    auto cpy{other};
+    swap(cpy);
+    return *this;
+}
+
+template <typename Key, std::size_t BlockSize>
+frozen_btree<Key, BlockSize>& frozen_btree<Key, BlockSize>::operator=(frozen_btree&& other) & noexcept {
+    swap(other);
+    return *this;
+}
+
+template <typename Key, std::size_t BlockSize>
+bool frozen_btree<Key, BlockSize>::empty() const noexcept {
+    return !size_;
+}
+
+template <typename Key, std::size_t BlockSize>
+typename frozen_btree<Key, BlockSize>::size_type frozen_btree<Key, BlockSize>::size() const noexcept {
+    return size_;
+}
+
+template <typename Key, std::size_t BlockSize>
+bool frozen_btree<Key, BlockSize>::contains(value_type value) const noexcept {
+    return find(value) != end();
+}
+
+template <typename Key, std::size_t BlockSize>
+typename frozen_btree<Key, BlockSize>::size_type
+frozen_btree<Key, BlockSize>::count(value_type value) const noexcept {
+    /* Trees allowing duplicates may hold a run of equal keys */
+    auto const [first, last] = equal_range(value);
+    return static_cast<size_type>(last - first);
+}
+
+template <typename Key, std::size_t BlockSize>
+typename frozen_btree<Key, BlockSize>::const_iterator
+frozen_btree<Key, BlockSize>::find(value_type value) const noexcept {
+    const_iterator it = lower_bound(value);
+    return it != end() && !(value < *it) ? it : end();
+}
+
+template <typename Key, std::size_t BlockSize>
+typename frozen_btree<Key, BlockSize>::const_iterator
+frozen_btree<Key, BlockSize>::lower_bound(value_type value) const noexcept {
+    return keys_ + search<false>(value);
+}
+
+template <typename Key, std::size_t BlockSize>
+typename frozen_btree<Key, BlockSize>::const_iterator
+frozen_btree<Key, BlockSize>::upper_bound(value_type value) const noexcept {
+    return keys_ + search<true>(value);
+}
+
+template <typename Key, std::size_t BlockSize>
+std::pair<typename frozen_btree<Key, BlockSize>::const_iterator, typename frozen_btree<Key, BlockSize>::const_iterator>
+frozen_btree<Key, BlockSize>::equal_range(value_type value) const noexcept {
+    return {lower_bound(value), upper_bound(value)};
+}
+
+template <typename Key, std::size_t BlockSize>
+typename frozen_btree<Key, BlockSize>::const_iterator frozen_btree<Key, BlockSize>::begin() const noexcept {
+    return keys_;
+}
+
+template <typename Key, std::size_t BlockSize>
+typename frozen_btree<Key, BlockSize>::const_iterator frozen_btree<Key, BlockSize>::end() const noexcept {
+    return keys_ + size_;
+}
+
+template <typename Key, std::size_t BlockSize>
+typename frozen_btree<Key, BlockSize>::const_iterator frozen_btree<Key, BlockSize>::cbegin() const noexcept {
+    return begin();
+}
+
+template <typename Key, std::size_t BlockSize>
+typename frozen_btree<Key, BlockSize>::const_iterator frozen_btree<Key, BlockSize>::cend() const noexcept {
+    return end();
+}
+
+template <typename Key, std::size_t BlockSize>
+typename frozen_btree<Key, BlockSize>::const_reverse_iterator
+frozen_btree<Key, BlockSize>::rbegin() const noexcept {
+    return const_reverse_iterator{end()};
+}
+
+template <typename Key, std::size_t BlockSize>
+typename frozen_btree<Key, BlockSize>::const_reverse_iterator
+frozen_btree<Key, BlockSize>::rend() const noexcept {
+    return const_reverse_iterator{begin()};
+}
+
+template <typename Key, std::size_t BlockSize>
+typename frozen_btree<Key, BlockSize>::const_reverse_iterator
+frozen_btree<Key, BlockSize>::crbegin() const noexcept {
+    return rbegin();
+}
+
+template <typename Key, std::size_t BlockSize>
+typename frozen_btree<Key, BlockSize>::const_reverse_iterator
+frozen_btree<Key, BlockSize>::crend() const noexcept {
+    return rend();
+}
+
+template <typename Key, std::size_t BlockSize>
+void frozen_btree<Key, BlockSize>::swap(frozen_btree& other) noexcept {
+    std::swap(keys_, other.keys_);
+    std::swap(size_, other.size_);
+    std::swap(nodes_, other.nodes_);
+    std::swap(levels_, other.levels_);
+    std::swap(offsets_, other.offsets_);
+    std::swap(widths_, other.widths_);
+}
+
+template <typename Key, std::size_t BlockSize>
+void swap(frozen_btree<Key, BlockSize>& left, frozen_btree<Key, BlockSize>& right) noexcept {
+    left.swap(right);
+}
+
+template <typename Key, std::size_t BlockSize>
+Key constexpr frozen_btree<Key, BlockSize>::padding() noexcept {
+    if constexpr(std::numeric_limits<Key>::has_infinity)
+        return std::numeric_limits<Key>::infinity();
+    else
+        return std::numeric_limits<Key>::max();
+}
+
+template <typename Key, std::size_t BlockSize>
+void frozen_btree<Key, BlockSize>::allocate(size_type nodes) {
+    keys_ = static_cast<Key*>(::operator new(nodes * BlockSize * sizeof(Key), std::align_val_t{ALIGNMENT}));
+}
+
+template <typename Key, std::size_t BlockSize>
+void frozen_btree<Key, BlockSize>::deallocate() noexcept {
+    if(keys_)
+        ::operator delete(keys_, std::align_val_t{ALIGNMENT});
+    keys_ = nullptr;
+}
+
+/* Returns the index of the first key not less than (or, if Upper is set,
+ * greater than) value. The padding keys are never less than any value,
+ * so the search ends up beyond the last key if there is no such key */
+template <typename Key, std::size_t BlockSize>
+template <bool Upper>
+typename frozen_btree<Key, BlockSize>::size_type
+frozen_btree<Key, BlockSize>::search(value_type value) const noexcept {
+    if(!size_)
+        return 0u;
+
+    size_type node = 0u;
+    for(size_type l = levels_ - 1u; l > 0u; --l) {
+        Key const* separators = keys_ + (offsets_[l] + node) * BlockSize;
+        node = node * FANOUT + impl::count_preceding<Upper, BlockSize>(separators, value);
+
+        if(node >= widths_[l - 1u])
+            return size_;
+
+        impl::prefetch(keys_ + (offsets_[l - 1u] + node) * BlockSize);
+    }
+
+    size_type index = node * BlockSize + impl::count_preceding<Upper, BlockSize>(keys_ + node * BlockSize, value);
+    return index < size_ ? index : size_;
+}
+
+} /* namespace trbt */
+
+#endif
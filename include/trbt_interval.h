@@ -0,0 +1,152 @@
+#ifndef TRBT_INTERVAL_H
+#define TRBT_INTERVAL_H
+
+#pragma once
+#include "trbt.h"
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace trbt {
+
+/* Half-open interval [start, end). Intervals are ordered by start, then by end */
+template <typename T>
+struct interval {
+    T start{};
+    T end{};
+
+    bool contains(T const& point) const {
+        return !(point < start) && point < end;
+    }
+
+    bool empty() const {
+        return !(start < end);
+    }
+
+    /* Whether the intervals share a point, which empty ones never do */
+    bool overlaps(interval const& other) const {
+        return start < other.end && other.start < end && !empty() && !other.empty();
+    }
+
+    friend bool operator<(interval const& left, interval const& right) {
+        return left.start < right.start || (!(right.start < left.start) && left.end < right.end);
+    }
+
+    friend bool operator==(interval const& left, interval const& right) {
+        return !(left < right) && !(right < left);
+    }
+
+    friend bool operator!=(interval const& left, interval const& right) {
+        return !(left == right);
+    }
+};
+
+namespace impl {
+    /* Greatest end of the intervals in a subtree */
+    template <typename T>
+    struct interval_end_monoid {
+        static_assert(std::numeric_limits<T>::is_specialized, "Interval endpoints must have numeric limits");
+
+        using aggregate_type = T;
+
+        aggregate_type identity() const {
+            return std::numeric_limits<T>::lowest();
+        }
+
+        aggregate_type lift(interval<T> const& value) const {
+            return value.end;
+        }
+
+        aggregate_type combine(aggregate_type const& left, aggregate_type const& right) const {
+            return left < right ? right : left;
+        }
+    };
+} /* namespace impl */
+
+/* rbtree of intervals keyed by their start, where every node holds the
+ * greatest end in its subtree. Identical intervals are all kept, in insertion
+ * order. Searches skip subtrees ending at or before the range searched for as
+ * well as intervals starting after it, so reporting k overlapping intervals
+ * takes O((k + 1) log n) */
+template <typename T, typename Allocator = std::allocator<interval<T>>>
+class interval_tree : public rbtree<interval<T>, std::less<interval<T>>, Allocator,
+                                    augment<impl::interval_end_monoid<T>>, allow_duplicates> {
+    using base = rbtree<interval<T>, std::less<interval<T>>, Allocator, 
+                        augment<impl::interval_end_monoid<T>>, allow_duplicates>;
+
+    public:
+        using interval_type = interval<T>;
+        using point_type    = T;
+
+        using base::base;
+
+        /* Calls f with every interval containing point, in order, until f
+         * returns false if it returns bool. Returns f */
+        template <typename F>
+        F overlaps(point_type const& point, F f) const {
+            overlapping(point, point, true, f);
+            return f;
+        }
+
+        /* As above, with every interval overlapping range */
+        template <typename F>
+        F overlaps(interval_type const& range, F f) const {
+            overlapping(range.start, range.end, false, f);
+            return f;
+        }
+
+        std::vector<interval_type> overlaps(point_type const& point) const {
+            std::vector<interval_type> hits;
+            overlaps(point, [&hits](interval_type const& value) { hits.push_back(value); });
+            return hits;
+        }
+
+        std::vector<interval_type> overlaps(interval_type const& range) const {
+            std::vector<interval_type> hits;
+            overlaps(range, [&hits](interval_type const& value) { hits.push_back(value); });
+            return hits;
+        }
+
+        /* Whether any interval contains point or overlaps range, in O(log n) */
+        bool overlaps_any(point_type const& point) const {
+            auto stop = [](interval_type const&) { return false; };
+            return overlapping(point, point, true, stop);
+        }
+
+        bool overlaps_any(interval_type const& range) const {
+            auto stop = [](interval_type const&) { return false; };
+            return overlapping(range.start, range.end, false, stop);
+        }
+
+    private:
+        /* Passes the intervals ending after lo and starting before hi, or at
+         * hi if closed, to f until it returns false, which is then returned
+         * as true. f may also return void */
+        template <typename F>
+        bool overlapping(point_type const& lo, point_type const& hi, bool closed, F& f) const {
+            if(!closed && !(lo < hi))
+                return false;
+
+            bool stopped = false;
+            base::for_each_pruned([&lo](point_type const& max_end) { return lo < max_end; },
+                                  [&lo, &hi, closed, &f, &stopped](interval_type const& value) {
+                if(closed ? hi < value.start : !(value.start < hi))
+                    return false;
+                if(lo < value.end && (closed || !value.empty())) {
+                    if constexpr(std::is_void_v<decltype(f(value))>)
+                        f(value);
+                    else if(!f(value)) {
+                        stopped = true;
+                        return false;
+                    }
+                }
+                return true;
+            });
+            return stopped;
+        }
+};
+
+} /* namespace trbt */
+
+#endif
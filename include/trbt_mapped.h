@@ -0,0 +1,646 @@
+#ifndef TRBT_MAPPED_H
+#define TRBT_MAPPED_H
+
+#pragma once
+#include "trbt.h"
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace trbt {
+
+/* Thrown when a snapshot file cannot be written, is malformed or was
+ * written for a different value type or platform */
+struct snapshot_error : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+namespace impl {
+    /* Snapshot layout:
+     *
+     *   snapshot_header
+     *   padding up to header.nodes_offset
+     *   header.count snapshot_nodes, sorted by value
+     *
+     * The nodes form a perfectly balanced binary search tree rooted at
+     * header.root. Children are stored as offsets, in nodes, relative to
+     * the node itself, 0 meaning no child. As the nodes are sorted, in-order
+     * iteration is a linear scan. The checksum is the 64 bit FNV-1a hash of
+     * the node region. header.policies records the policies deciding how the
+     * values are searched, so that a snapshot is only opened by a tree that
+     * searches it the same way */
+    inline char constexpr SNAPSHOT_MAGIC[8]       = {'T', 'R', 'B', 'T', 'S', 'N', 'A', 'P'};
+    inline std::uint32_t constexpr SNAPSHOT_VERSION = 1u;
+    inline std::uint32_t constexpr SNAPSHOT_ENDIAN  = 0x01020304u;
+
+    /* Bits of snapshot_header::policies */
+    inline std::uint32_t constexpr SNAPSHOT_DUPLICATES = 0x1u;
+    inline std::uint32_t constexpr SNAPSHOT_PROJECTED  = 0x2u;
+
+    /* Aggregates are not written, so augmentation is not recorded */
+    template <typename Tree>
+    std::uint32_t constexpr snapshot_policies() noexcept {
+        return (allows_duplicates_v<Tree> ? SNAPSHOT_DUPLICATES : 0u) |
+               (has_key_projection_v<Tree> ? SNAPSHOT_PROJECTED : 0u);
+    }
+
+    struct snapshot_header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t endian;
+        std::uint32_t value_size;
+        std::uint32_t value_align;
+        std::uint32_t node_size;
+        std::uint32_t policies;
+        std::uint64_t count;
+        std::uint64_t root;
+        std::uint64_t nodes_offset;
+        std::uint64_t checksum;
+    };
+
+    template <typename Value>
+    struct snapshot_node {
+        std::int64_t left;
+        std::int64_t right;
+        Value value;
+    };
+
+    inline std::uint64_t fnv1a(void const* data, std::size_t size,
+                               std::uint64_t hash = 0xcbf29ce484222325ull) noexcept {
+        auto const* bytes = static_cast<unsigned char const*>(data);
+        for(std::size_t i = 0u; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    inline std::uint64_t snapshot_nodes_offset(std::size_t align) noexcept {
+        return (sizeof(snapshot_header) + align - 1u) / align * align;
+    }
+
+    /* Midpoint of [first, last), the root of the balanced subtree over that range */
+    inline std::uint64_t snapshot_midpoint(std::uint64_t first, std::uint64_t last) noexcept {
+        return first + (last - first) / 2u;
+    }
+
+    /* Calls f(index, left, right) with the relative child offsets of every node
+     * of the balanced tree over count nodes. Stops early if f returns false.
+     * Subtrees halve at every level, so the pending ranges fit in a fixed
+     * stack and the traversal never allocates */
+    template <typename F>
+    bool for_each_snapshot_node(std::uint64_t count, F f) noexcept(std::is_nothrow_invocable_v<F&, std::uint64_t, std::int64_t, std::int64_t>) {
+        struct range {
+            std::uint64_t first, last;
+        };
+
+        std::array<range, std::numeric_limits<std::uint64_t>::digits + 1u> stack;
+        std::size_t depth = 0u;
+        if(count)
+            stack[depth++] = {0u, count};
+
+        while(depth) {
+            auto [first, last] = stack[--depth];
+
+            std::uint64_t const mid = snapshot_midpoint(first, last);
+            std::int64_t left{}, right{};
+            if(first < mid) {
+                left = static_cast<std::int64_t>(snapshot_midpoint(first, mid)) - static_cast<std::int64_t>(mid);
+                stack[depth++] = {first, mid};
+            }
+            if(mid + 1u < last) {
+                right = static_cast<std::int64_t>(snapshot_midpoint(mid + 1u, last)) - static_cast<std::int64_t>(mid);
+                stack[depth++] = {mid + 1u, last};
+            }
+
+            if(!f(mid, left, right))
+                return false;
+        }
+
+        return true;
+    }
+
+    template <typename Container, typename ReverseTag>
+    class mapped_iterator_type {
+        using node_type = typename Container::node_type;
+
+        public:
+            using value_type        = typename Container::value_type;
+            using difference_type   = std::ptrdiff_t;
+            using iterator_category = std::bidirectional_iterator_tag;
+            using reference         = typename Container::const_reference;
+            using const_reference   = typename Container::const_reference;
+            using pointer           = typename Container::const_pointer;
+            using const_pointer     = typename Container::const_pointer;
+
+            explicit mapped_iterator_type(node_type const* node) : node_{node} { }
+
+            friend bool operator==(mapped_iterator_type const& left, mapped_iterator_type const& right) noexcept {
+                return left.node_ == right.node_;
+            }
+
+            friend bool operator!=(mapped_iterator_type const& left, mapped_iterator_type const& right) noexcept {
+                return !(left == right);
+            }
+
+            mapped_iterator_type& operator++() noexcept {
+                if constexpr(requests_reverse_v<ReverseTag>)
+                    --node_;
+                else
+                    ++node_;
+                return *this;
+            }
+
+            mapped_iterator_type operator++(int) noexcept {
+                auto prev = *this;
+                ++*this;
+                return prev;
+            }
+
+            mapped_iterator_type& operator--() noexcept {
+                if constexpr(requests_reverse_v<ReverseTag>)
+                    ++node_;
+                else
+                    --node_;
+                return *this;
+            }
+
+            mapped_iterator_type operator--(int) noexcept {
+                auto next = *this;
+                --*this;
+                return next;
+            }
+
+            /* Reverse iterators point one past the node they refer to */
+            reference operator*() const noexcept {
+                if constexpr(requests_reverse_v<ReverseTag>)
+                    return (node_ - 1)->value;
+                else
+                    return node_->value;
+            }
+
+            pointer operator->() const noexcept {
+                return std::addressof(**this);
+            }
+
+        private:
+            node_type const* node_;
+    };
+} /* namespace impl */
+
+/* Writes the values of tree to a snapshot file at path which can later be
+ * opened by mapped_rbtree without deserialization */
+template <typename Value, typename Compare, typename Allocator, typename... Policies>
+void write_snapshot(rbtree<Value, Compare, Allocator, Policies...> const& tree, std::string const& path) {
+    using tree_type  = rbtree<Value, Compare, Allocator, Policies...>;
+    using value_type = typename tree_type::value_type;
+    using node_type  = impl::snapshot_node<value_type>;
+    static_assert(std::is_trivially_copyable_v<value_type>, "Only trivially copyable values can be written to a snapshot");
+
+    std::uint64_t const count = tree.size();
+
+    impl::snapshot_header header{};
+    std::memcpy(header.magic, impl::SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version      = impl::SNAPSHOT_VERSION;
+    header.endian       = impl::SNAPSHOT_ENDIAN;
+    header.value_size   = sizeof(value_type);
+    header.value_align  = alignof(value_type);
+    header.node_size    = sizeof(node_type);
+    header.policies     = impl::snapshot_policies<tree_type>();
+    header.count        = count;
+    header.root         = impl::snapshot_midpoint(0u, count);
+    header.nodes_offset = impl::snapshot_nodes_offset(alignof(node_type));
+
+    /* Zeroed storage so that padding bytes are deterministic */
+    std::vector<unsigned char> nodes(count * sizeof(node_type));
+
+    impl::for_each_snapshot_node(count, [&nodes](std::uint64_t index, std::int64_t left, std::int64_t right) {
+        node_type node{};
+        node.left  = left;
+        node.right = right;
+        std::memcpy(nodes.data() + index * sizeof(node_type), &node, offsetof(node_type, value));
+        return true;
+    });
+
+    std::size_t index = 0u;
+    for(auto const& value : tree) {
+        std::memcpy(nodes.data() + index * sizeof(node_type) + offsetof(node_type, value),
+                    std::addressof(value), sizeof(value_type));
+        ++index;
+    }
+
+    header.checksum = impl::fnv1a(nodes.data(), nodes.size());
+
+    std::ofstream os{path, std::ios::binary | std::ios::trunc};
+    os.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    std::vector<char> padding(header.nodes_offset - sizeof(header), '\0');
+    os.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+    os.write(reinterpret_cast<char const*>(nodes.data()), static_cast<std::streamsize>(nodes.size()));
+    os.close();
+
+    if(!os)
+        throw snapshot_error{"Unable to write snapshot to " + path};
+}
+
+/* Read-only view of a snapshot written by write_snapshot. Opening maps the
+ * file into memory and validates the header only, the values are used in
+ * place. Call verify to check the checksum and the child offsets. Policies
+ * must match those of the tree written as far as they decide how values are
+ * searched, which is checked on opening */
+template <typename Value, typename Compare = std::less<Value>, typename... Policies>
+class mapped_rbtree {
+    template <typename, typename>
+    friend class impl::mapped_iterator_type;
+
+    using tree_type = rbtree<Value, Compare, std::allocator<impl::add_const_to_key_if_pair_t<impl::remove_cvref_t<Value>>>, 
+                             Policies...>;
+
+    public:
+        using key_type               = typename tree_type::key_type;
+        using mapped_type            = typename tree_type::mapped_type;
+        using value_type             = typename tree_type::value_type;
+        using size_type              = typename tree_type::size_type;
+        using difference_type        = typename tree_type::difference_type;
+        using key_compare            = typename tree_type::key_compare;
+        using value_compare          = typename tree_type::value_compare;
+        using reference              = value_type const&;
+        using const_reference        = value_type const&;
+        using pointer                = value_type const*;
+        using const_pointer          = value_type const*;
+        using node_type              = impl::snapshot_node<value_type>;
+        using iterator               = impl::mapped_iterator_type<mapped_rbtree, impl::non_reverse_tag>;
+        using const_iterator         = iterator;
+        using reverse_iterator       = impl::mapped_iterator_type<mapped_rbtree, impl::reverse_tag>;
+        using const_reverse_iterator = reverse_iterator;
+
+        static_assert(std::is_trivially_copyable_v<value_type>, "Only trivially copyable values can be mapped");
+
+        mapped_rbtree() = default;
+        explicit mapped_rbtree(std::string const& path);
+
+        mapped_rbtree(mapped_rbtree const&) = delete;
+        mapped_rbtree(mapped_rbtree&& other) noexcept;
+
+        ~mapped_rbtree();
+
+        mapped_rbtree& operator=(mapped_rbtree const&) = delete;
+        mapped_rbtree& operator=(mapped_rbtree&& other) & noexcept;
+
+        inline bool empty() const noexcept;
+        inline size_type size() const noexcept;
+
+        bool verify() const noexcept;
+
+        bool contains(value_type const& value) const;
+        size_type count(value_type const& value) const;
+        const_iterator find(value_type const& value) const;
+
+        /* Lookups by key alone in trees with a key projection */
+        template <typename T = tree_type, typename = impl::enable_if_keyed_t<T>>
+        bool contains(key_type const& key) const;
+        template <typename T = tree_type, typename = impl::enable_if_keyed_t<T>>
+        const_iterator find(key_type const& key) const;
+
+        const_iterator lower_bound(value_type const& value) const;
+        const_iterator upper_bound(value_type const& value) const;
+        std::pair<const_iterator, const_iterator> equal_range(value_type const& value) const;
+
+        const_iterator begin() const noexcept;
+        const_iterator end() const noexcept;
+        const_iterator cbegin() const noexcept;
+        const_iterator cend() const noexcept;
+
+        const_reverse_iterator rbegin() const noexcept;
+        const_reverse_iterator rend() const noexcept;
+        const_reverse_iterator crbegin() const noexcept;
+        const_reverse_iterator crend() const noexcept;
+
+        void swap(mapped_rbtree& other) noexcept;
+
+    private:
+        void* mapping_{nullptr};
+        std::size_t length_{};
+        node_type const* nodes_{nullptr};
+        size_type size_{};
+        size_type root_{};
+        key_compare compare_{};
+
+        impl::snapshot_header const& header() const noexcept;
+
+        template <bool Upper, typename T>
+        node_type const* bound(T const& value) const;
+
+        /* Node holding a value equal to value, which may also be a key, the
+         * first of them if there are several. nodes_ + size_ if there is none */
+        template <typename T>
+        node_type const* find_node(T const& value) const;
+
+        void unmap() noexcept;
+};
+
+template <typename Value, typename Compare, typename... Policies>
+mapped_rbtree<Value, Compare, Policies...>::mapped_rbtree(std::string const& path)
+    : mapping_{nullptr}, length_{}, nodes_{nullptr}, size_{}, root_{}, compare_{} {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd == -1)
+        throw std::system_error{errno, std::generic_category(), "Unable to open " + path};
+
+    struct stat st;
+    if(::fstat(fd, &st) == -1) {
+        int err = errno;
+        ::close(fd);
+        throw std::system_error{err, std::generic_category(), "Unable to stat " + path};
+    }
+
+    length_ = static_cast<std::size_t>(st.st_size);
+    if(length_ < sizeof(impl::snapshot_header)) {
+        ::close(fd);
+        throw snapshot_error{path + " is too small to be a snapshot"};
+    }
+
+    void* mapping = ::mmap(nullptr, length_, PROT_READ, MAP_PRIVATE, fd, 0);
+    int err = errno;
+    ::close(fd);
+    if(mapping == MAP_FAILED)
+        throw std::system_error{err, std::generic_category(), "Unable to map " + path};
+    mapping_ = mapping;
+
+    auto const& hdr = header();
+    std::string error;
+    if(std::memcmp(hdr.magic, impl::SNAPSHOT_MAGIC, sizeof(hdr.magic)))
+        error = " is not a snapshot";
+    else if(hdr.version != impl::SNAPSHOT_VERSION)
+        error = " has unsupported version " + std::to_string(hdr.version);
+    else if(hdr.endian != impl::SNAPSHOT_ENDIAN)
+        error = " was written on a platform with different byte order";
+    else if(hdr.value_size != sizeof(value_type) || hdr.value_align != alignof(value_type) ||
+            hdr.node_size != sizeof(node_type))
+        error = " was written for a different value type";
+    else if(hdr.policies != impl::snapshot_policies<tree_type>())
+        error = " was written for a tree with different policies";
+    else if(hdr.nodes_offset != impl::snapshot_nodes_offset(alignof(node_type)) ||
+            hdr.count > (length_ - hdr.nodes_offset) / sizeof(node_type) ||
+            hdr.nodes_offset + hdr.count * sizeof(node_type) != length_)
+        error = " is truncated or has trailing data";
+    else if(hdr.root != impl::snapshot_midpoint(0u, hdr.count))
+        error = " has an invalid root";
+
+    if(!error.empty()) {
+        unmap();
+        throw snapshot_error{path + error};
+    }
+
+    size_  = hdr.count;
+    root_  = hdr.root;
+    nodes_ = reinterpret_cast<node_type const*>(static_cast<char const*>(mapping_) + hdr.nodes_offset);
+}
+
+template <typename Value, typename Compare, typename... Policies>
+mapped_rbtree<Value, Compare, Policies...>::mapped_rbtree(mapped_rbtree&& other) noexcept
+    : mapping_{nullptr}, length_{}, nodes_{nullptr}, size_{}, root_{}, compare_{} {
+    swap(other);
+}
+
+template <typename Value, typename Compare, typename... Policies>
+mapped_rbtree<Value, Compare, Policies...>::~mapped_rbtree() {
+    unmap();
+}
+
+template <typename Value, typename Compare, typename... Policies>
+mapped_rbtree<Value, Compare, Policies...>& mapped_rbtree<Value, Compare, Policies...>::operator=(mapped_rbtree&& other) & noexcept {
+    swap(other);
+    return *this;
+}
+
+template <typename Value, typename Compare, typename... Policies>
+bool mapped_rbtree<Value, Compare, Policies...>::empty() const noexcept {
+    return !size_;
+}
+
+template <typename Value, typename Compare, typename... Policies>
+typename mapped_rbtree<Value, Compare, Policies...>::size_type mapped_rbtree<Value, Compare, Policies...>::size() const noexcept {
+    return size_;
+}
+
+/* O(n) check of the checksum and of every child offset. The offsets must
+ * describe the balanced tree written by write_snapshot, so a search can
+ * neither leave the node region nor loop */
+template <typename Value, typename Compare, typename... Policies>
+bool mapped_rbtree<Value, Compare, Policies...>::verify() const noexcept {
+    if(!mapping_)
+        return true;
+
+    if(impl::fnv1a(nodes_, size_ * sizeof(node_type)) != header().checksum)
+        return false;
+
+    return impl::for_each_snapshot_node(size_, [this](std::uint64_t index, std::int64_t left, std::int64_t right) noexcept {
+        return nodes_[index].left == left && nodes_[index].right == right;
+    });
+}
+
+template <typename Value, typename Compare, typename... Policies>
+bool mapped_rbtree<Value, Compare, Policies...>::contains(value_type const& value) const {
+    return find(value) != end();
+}
+
+template <typename Value, typename Compare, typename... Policies>
+typename mapped_rbtree<Value, Compare, Policies...>::size_type
+mapped_rbtree<Value, Compare, Policies...>::count(value_type const& value) const {
+    if constexpr(impl::allows_duplicates_v<tree_type>) {
+        /* Equal values are adjacent in the node region */
+        return static_cast<size_type>(bound<true>(value) - bound<false>(value));
+    }
+    else
+        return static_cast<size_type>(contains(value));
+}
+
+template <typename Value, typename Compare, typename... Policies>
+typename mapped_rbtree<Value, Compare, Policies...>::const_iterator
+mapped_rbtree<Value, Compare, Policies...>::find(value_type const& value) const {
+    return const_iterator{find_node(value)};
+}
+
+template <typename Value, typename Compare, typename... Policies>
+template <typename, typename>
+bool mapped_rbtree<Value, Compare, Policies...>::contains(key_type const& key) const {
+    return find_node(key) != nodes_ + size_;
+}
+
+template <typename Value, typename Compare, typename... Policies>
+template <typename, typename>
+typename mapped_rbtree<Value, Compare, Policies...>::const_iterator
+mapped_rbtree<Value, Compare, Policies...>::find(key_type const& key) const {
+    return const_iterator{find_node(key)};
+}
+
+template <typename Value, typename Compare, typename... Policies>
+typename mapped_rbtree<Value, Compare, Policies...>::const_iterator
+mapped_rbtree<Value, Compare, Policies...>::lower_bound(value_type const& value) const {
+    return const_iterator{bound<false>(value)};
+}
+
+template <typename Value, typename Compare, typename... Policies>
+typename mapped_rbtree<Value, Compare, Policies...>::const_iterator
+mapped_rbtree<Value, Compare, Policies...>::upper_bound(value_type const& value) const {
+    return const_iterator{bound<true>(value)};
+}
+
+template <typename Value, typename Compare, typename... Policies>
+std::pair<typename mapped_rbtree<Value, Compare, Policies...>::const_iterator, typename mapped_rbtree<Value, Compare, Policies...>::const_iterator>
+mapped_rbtree<Value, Compare, Policies...>::equal_range(value_type const& value) const {
+    return {lower_bound(value), upper_bound(value)};
+}
+
+template <typename Value, typename Compare, typename... Policies>
+typename mapped_rbtree<Value, Compare, Policies...>::const_iterator mapped_rbtree<Value, Compare, Policies...>::begin() const noexcept {
+    return const_iterator{nodes_};
+}
+
+template <typename Value, typename Compare, typename... Policies>
+typename mapped_rbtree<Value, Compare, Policies...>::const_iterator mapped_rbtree<Value, Compare, Policies...>::end() const noexcept {
+    return const_iterator{nodes_ + size_};
+}
+
+template <typename Value, typename Compare, typename... Policies>
+typename mapped_rbtree<Value, Compare, Policies...>::const_iterator mapped_rbtree<Value, Compare, Policies...>::cbegin() const noexcept {
+    return begin();
+}
+
+template <typename Value, typename Compare, typename... Policies>
+typename mapped_rbtree<Value, Compare, Policies...>::const_iterator mapped_rbtree<Value, Compare, Policies...>::cend() const noexcept {
+    return end();
+}
+
+template <typename Value, typename Compare, typename... Policies>
+typename mapped_rbtree<Value, Compare, Policies...>::const_reverse_iterator
+mapped_rbtree<Value, Compare, Policies...>::rbegin() const noexcept {
+    return const_reverse_iterator{nodes_ + size_};
+}
+
+template <typename Value, typename Compare, typename... Policies>
+typename mapped_rbtree<Value, Compare, Policies...>::const_reverse_iterator
+mapped_rbtree<Value, Compare, Policies...>::rend() const noexcept {
+    return const_reverse_iterator{nodes_};
+}
+
+template <typename Value, typename Compare, typename... Policies>
+typename mapped_rbtree<Value, Compare, Policies...>::const_reverse_iterator
+mapped_rbtree<Value, Compare, Policies...>::crbegin() const noexcept {
+    return rbegin();
+}
+
+template <typename Value, typename Compare, typename... Policies>
+typename mapped_rbtree<Value, Compare, Policies...>::const_reverse_iterator
+mapped_rbtree<Value, Compare, Policies...>::crend() const noexcept {
+    return rend();
+}
+
+template <typename Value, typename Compare, typename... Policies>
+void mapped_rbtree<Value, Compare, Policies...>::swap(mapped_rbtree& other) noexcept {
+    using std::swap;
+    swap(mapping_, other.mapping_);
+    swap(length_, other.length_);
+    swap(nodes_, other.nodes_);
+    swap(size_, other.size_);
+    swap(root_, other.root_);
+    swap(compare_, other.compare_);
+}
+
+template <typename Value, typename Compare, typename... Policies>
+void swap(mapped_rbtree<Value, Compare, Policies...>& left, mapped_rbtree<Value, Compare, Policies...>& right) noexcept {
+    left.swap(right);
+}
+
+template <typename Value, typename Compare, typename... Policies>
+impl::snapshot_header const& mapped_rbtree<Value, Compare, Policies...>::header() const noexcept {
+    return *static_cast<impl::snapshot_header const*>(mapping_);
+}
+
+/* First node not less than (or, if Upper is set, greater than) value */
+template <typename Value, typename Compare, typename... Policies>
+template <bool Upper, typename T>
+typename mapped_rbtree<Value, Compare, Policies...>::node_type const*
+mapped_rbtree<Value, Compare, Policies...>::bound(T const& value) const {
+    node_type const* candidate = nodes_ + size_;
+    if(!size_)
+        return candidate;
+
+    node_type const* current = nodes_ + root_;
+    while(true) {
+        bool const left = Upper ? compare_(value, current->value) : !compare_(current->value, value);
+        std::int64_t offset = left ? current->left : current->right;
+        if(left)
+            candidate = current;
+
+        if(!offset)
+            return candidate;
+        current += offset;
+    }
+}
+
+/* With duplicates, the first of the equal values is their lower bound, which
+ * takes a full descent. Otherwise the search stops at the first equal value */
+template <typename Value, typename Compare, typename... Policies>
+template <typename T>
+typename mapped_rbtree<Value, Compare, Policies...>::node_type const*
+mapped_rbtree<Value, Compare, Policies...>::find_node(T const& value) const {
+    node_type const* const none = nodes_ + size_;
+    if constexpr(impl::allows_duplicates_v<tree_type>) {
+        node_type const* candidate = bound<false>(value);
+        return candidate == none || compare_(value, candidate->value) ? none : candidate;
+    }
+    else {
+        if(!size_)
+            return none;
+
+        node_type const* current = nodes_ + root_;
+        while(true) {
+            std::int64_t offset;
+            switch(impl::relation(compare_, value, current->value)) {
+                case impl::ValueRelation::Equal:
+                    return current;
+                case impl::ValueRelation::Less:
+                    offset = current->left;
+                    break;
+                default:
+                    offset = current->right;
+                    break;
+            }
+
+            if(!offset)
+                return none;
+            current += offset;
+        }
+    }
+}
+
+template <typename Value, typename Compare, typename... Policies>
+void mapped_rbtree<Value, Compare, Policies...>::unmap() noexcept {
+    if(mapping_)
+        ::munmap(mapping_, length_);
+    mapping_ = nullptr;
+    nodes_ = nullptr;
+    size_ = 0u;
+    root_ = 0u;
+}
+
+} /* namespace trbt */
+
+#endif
@@ -0,0 +1,195 @@
+#ifndef TRBT_PARALLEL_H
+#define TRBT_PARALLEL_H
+
+#pragma once
+#include "trbt.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace trbt {
+
+/* Fixed set of worker threads running batches of indexed tasks. The calling
+ * thread takes part in every batch, so a pool of size n owns n - 1 threads */
+class thread_pool {
+    public:
+        explicit thread_pool(unsigned threads = std::max(1u, std::thread::hardware_concurrency())) {
+            threads = std::max(1u, threads);
+            workers_.reserve(threads - 1u);
+            for(unsigned i = 1u; i < threads; i++)
+                workers_.emplace_back([this]() { work(); });
+        }
+
+        thread_pool(thread_pool const&) = delete;
+        thread_pool& operator=(thread_pool const&) = delete;
+
+        ~thread_pool() {
+            {
+                std::lock_guard<std::mutex> lock{mutex_};
+                stop_ = true;
+            }
+            wake_.notify_all();
+            for(auto& worker : workers_)
+                worker.join();
+        }
+
+        unsigned size() const noexcept {
+            return static_cast<unsigned>(workers_.size()) + 1u;
+        }
+
+        /* Calls task(i) for every i in [0, count) and returns once all calls
+         * have finished. The first exception thrown by a call is rethrown, the
+         * remaining indices are then skipped. Batches are run one at a time.
+         * A batch started by a task of another batch on the same pool would
+         * wait for the batch it is part of, so it is run on the calling
+         * thread alone */
+        template <typename Task>
+        void run(std::size_t count, Task task) {
+            if(current() == this) {
+                for(std::size_t i = 0u; i < count; i++)
+                    task(i);
+                return;
+            }
+
+            std::lock_guard<std::mutex> batch_lock{batch_mutex_};
+            {
+                std::lock_guard<std::mutex> lock{mutex_};
+                task_ = std::ref(task);
+                count_ = count;
+                next_.store(0u);
+                error_ = nullptr;
+                busy_ = workers_.size();
+                ++generation_;
+            }
+            wake_.notify_all();
+
+            execute();
+
+            std::unique_lock<std::mutex> lock{mutex_};
+            done_.wait(lock, [this]() { return !busy_; });
+            task_ = nullptr;
+            if(error_)
+                std::rethrow_exception(error_);
+        }
+
+    private:
+        void work() {
+            std::size_t seen = 0u;
+            while(true) {
+                {
+                    std::unique_lock<std::mutex> lock{mutex_};
+                    wake_.wait(lock, [this, seen]() { return stop_ || generation_ != seen; });
+                    if(stop_)
+                        return;
+                    seen = generation_;
+                }
+                execute();
+                {
+                    std::lock_guard<std::mutex> lock{mutex_};
+                    --busy_;
+                }
+                done_.notify_one();
+            }
+        }
+
+        /* Pool whose batch the calling thread is running tasks of, if any */
+        static thread_pool*& current() noexcept {
+            static thread_local thread_pool* pool = nullptr;
+            return pool;
+        }
+
+        void execute() {
+            thread_pool* const outer = std::exchange(current(), this);
+            for(auto i = next_++; i < count_; i = next_++) {
+                try {
+                    task_(i);
+                }
+                catch(...) {
+                    std::lock_guard<std::mutex> lock{mutex_};
+                    if(!error_)
+                        error_ = std::current_exception();
+                    next_.store(count_);
+                }
+            }
+            current() = outer;
+        }
+
+        std::vector<std::thread> workers_{};
+        std::mutex batch_mutex_{};
+        std::mutex mutex_{};
+        std::condition_variable wake_{};
+        std::condition_variable done_{};
+        std::function<void(std::size_t)> task_{};
+        std::size_t count_{};
+        std::atomic<std::size_t> next_{};
+        std::size_t busy_{};
+        std::size_t generation_{};
+        std::exception_ptr error_{};
+        bool stop_{false};
+};
+
+/* Pool shared by the parallel algorithms unless another one is given */
+inline thread_pool& default_thread_pool() {
+    static thread_pool pool;
+    return pool;
+}
+
+namespace impl {
+    /* Number of ranges per thread, so that threads finishing early can take
+     * over work from ranges whose size has been underestimated */
+    inline std::size_t constexpr RANGES_PER_THREAD = 4u;
+}
+
+namespace execution {
+    /* Runs the ranges of a reduction on a thread pool, the default one unless
+     * given another through on */
+    class parallel_policy {
+        public:
+            constexpr parallel_policy() noexcept = default;
+            explicit constexpr parallel_policy(thread_pool& pool) noexcept : pool_{&pool} { }
+
+            parallel_policy on(thread_pool& pool) const noexcept {
+                return parallel_policy{pool};
+            }
+
+            std::size_t chunks() const {
+                return pool().size() * impl::RANGES_PER_THREAD;
+            }
+
+            template <typename Task>
+            void run(std::size_t count, Task&& task) const {
+                pool().run(count, std::forward<Task>(task));
+            }
+
+        private:
+            thread_pool& pool() const {
+                return pool_ ? *pool_ : default_thread_pool();
+            }
+
+            thread_pool* pool_{nullptr};
+    };
+
+    inline parallel_policy constexpr par{};
+} /* namespace execution */
+
+/* Calls f with every value of tree, from several threads at once. The order
+ * in which values are visited is unspecified, f must be safe to call
+ * concurrently */
+template <typename Tree, typename F>
+void parallel_for_each(Tree& tree, F f, thread_pool& pool = default_thread_pool()) {
+    auto const ranges = tree.split_ranges(pool.size() * impl::RANGES_PER_THREAD);
+    pool.run(ranges.size(), [&tree, &ranges, &f](std::size_t i) {
+        tree.for_each(ranges[i].first, ranges[i].second, std::ref(f));
+    });
+}
+
+} /* namespace trbt */
+
+#endif
@@ -0,0 +1,387 @@
+#ifndef TRBT_RECORD_H
+#define TRBT_RECORD_H
+
+#pragma once
+#include "trbt.h"
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace trbt {
+
+/* Operations stored in a workload log */
+enum class operation : std::uint8_t { Insert, Erase, Find, LowerBound, Iterate };
+
+/* A single entry of a workload log. timestamp is the number of nanoseconds
+ * since recording started. count is the number of steps taken when iterating
+ * from the first value not less than value, and 0 for all other operations */
+template <typename Value>
+struct record {
+    operation op{};
+    std::uint64_t timestamp{};
+    std::uint64_t count{};
+    Value value{};
+};
+
+namespace impl {
+    /* Log layout:
+     *
+     *   magic, version, value type tag
+     *   records
+     *
+     * Each record is the operation byte, the time since the previous record and,
+     * for iterations, the number of steps, both as LEB128 varints, followed by
+     * the value as encoded by the codec */
+    inline char constexpr RECORD_MAGIC[8]        = {'T', 'R', 'B', 'T', 'R', 'E', 'C', 'L'};
+    inline std::uint32_t constexpr RECORD_VERSION = 1u;
+
+    /* Identifies the value type so that replay tools can pick the right instantiation */
+    template <typename Value>
+    std::uint32_t constexpr record_type_tag() noexcept {
+        if constexpr(std::is_same_v<Value, std::int32_t>)
+            return 1u;
+        else if constexpr(std::is_same_v<Value, std::int64_t>)
+            return 2u;
+        else if constexpr(std::is_same_v<Value, double>)
+            return 3u;
+        else if constexpr(std::is_same_v<Value, std::string>)
+            return 4u;
+        else
+            return 0u;
+    }
+
+    inline void write_varint(std::ostream& os, std::uint64_t value) {
+        char buffer[10];
+        std::size_t size = 0u;
+        do {
+            unsigned char byte = value & 0x7fu;
+            value >>= 7u;
+            buffer[size++] = static_cast<char>(value ? byte | 0x80u : byte);
+        } while(value);
+        os.write(buffer, static_cast<std::streamsize>(size));
+    }
+
+    inline std::uint64_t read_varint(std::istream& is) {
+        std::uint64_t value = 0u;
+        for(unsigned shift = 0u; shift < 64u; shift += 7u) {
+            int byte = is.get();
+            if(byte == std::istream::traits_type::eof())
+                throw std::ios_base::failure{"Truncated varint in workload log"};
+            value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if(!(byte & 0x80))
+                return value;
+        }
+        throw std::ios_base::failure{"Malformed varint in workload log"};
+    }
+} /* namespace impl */
+
+/* Writes a workload log to a stream */
+template <typename Value, typename Codec = codec<Value>>
+class record_writer {
+    using clock = std::chrono::steady_clock;
+
+    public:
+        explicit record_writer(std::ostream& os, Codec cdc = Codec{})
+            : os_{&os}, codec_{std::move(cdc)}, start_{clock::now()}, last_{} {
+            std::uint32_t const version = impl::RECORD_VERSION;
+            std::uint32_t const tag = impl::record_type_tag<Value>();
+            os_->write(impl::RECORD_MAGIC, sizeof(impl::RECORD_MAGIC));
+            os_->write(reinterpret_cast<char const*>(&version), sizeof(version));
+            os_->write(reinterpret_cast<char const*>(&tag), sizeof(tag));
+        }
+
+        void write(operation op, Value const& value, std::uint64_t count = 0u) {
+            auto const now = static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start_).count());
+
+            os_->put(static_cast<char>(op));
+            impl::write_varint(*os_, now - last_);
+            if(op == operation::Iterate)
+                impl::write_varint(*os_, count);
+            codec_.encode(*os_, value);
+            last_ = now;
+        }
+
+    private:
+        std::ostream* os_;
+        Codec codec_;
+        clock::time_point start_;
+        std::uint64_t last_;
+};
+
+/* Reads a workload log written by record_writer */
+template <typename Value, typename Codec = codec<Value>>
+class record_reader {
+    public:
+        explicit record_reader(std::istream& is, Codec cdc = Codec{})
+            : is_{&is}, codec_{std::move(cdc)}, timestamp_{} {
+            char magic[sizeof(impl::RECORD_MAGIC)];
+            std::uint32_t version{}, tag{};
+            is_->read(magic, sizeof(magic));
+            is_->read(reinterpret_cast<char*>(&version), sizeof(version));
+            is_->read(reinterpret_cast<char*>(&tag), sizeof(tag));
+
+            if(!*is_ || std::memcmp(magic, impl::RECORD_MAGIC, sizeof(magic)))
+                throw std::runtime_error{"Not a workload log"};
+            if(version != impl::RECORD_VERSION)
+                throw std::runtime_error{"Unsupported workload log version " + std::to_string(version)};
+            if(tag != impl::record_type_tag<Value>())
+                throw std::runtime_error{"Workload log was recorded for a different value type"};
+        }
+
+        /* Reads the next record into rec, returns false at the end of the log */
+        bool next(record<Value>& rec) {
+            int op = is_->get();
+            if(op == std::istream::traits_type::eof())
+                return false;
+            if(op > static_cast<int>(operation::Iterate))
+                throw std::runtime_error{"Unknown operation in workload log"};
+
+            rec.op = static_cast<operation>(op);
+            timestamp_ += impl::read_varint(*is_);
+            rec.timestamp = timestamp_;
+            rec.count = rec.op == operation::Iterate ? impl::read_varint(*is_) : 0u;
+            rec.value = codec_.decode(*is_);
+
+            if(!*is_)
+                throw std::ios_base::failure{"Truncated record in workload log"};
+            return true;
+        }
+
+    private:
+        std::istream* is_;
+        Codec codec_;
+        std::uint64_t timestamp_;
+};
+
+/* Tree recording every insertion, erasure, search and iteration performed
+ * through it to a workload log, for later replay by bench/replay. Recording
+ * starts once record_to has been called. Every member changing the values
+ * of the tree is logged as the insertions and erasures it amounts to, so
+ * replaying a log reproduces the contents of the tree. Copies do not record */
+template <typename Tree, typename Codec = codec<typename Tree::value_type>>
+struct recording_type : public Tree {
+
+    using key_type = typename Tree::key_type;
+    using mapped_type = typename Tree::mapped_type;
+    using value_type = typename Tree::value_type;
+    using iterator = typename Tree::iterator;
+    using const_iterator = typename Tree::const_iterator;
+    using size_type = typename Tree::size_type;
+
+    using Tree::Tree;
+
+    recording_type() = default;
+
+    recording_type(recording_type const& other) : Tree(static_cast<Tree const&>(other)) { }
+
+    /* The moved-from tree is left empty, which is logged by its writer */
+    recording_type(recording_type&& other) : Tree{} {
+        other.record_all(operation::Erase);
+        Tree::swap(other);
+    }
+
+    recording_type& operator=(recording_type const& other) & {
+        record_all(operation::Erase);
+        Tree::operator=(other);
+        record_all(operation::Insert);
+        return *this;
+    }
+
+    recording_type& operator=(recording_type&& other) & {
+        swap(other);
+        return *this;
+    }
+
+    void swap(recording_type& other) {
+        record_all(operation::Erase);
+        other.record_all(operation::Erase);
+        Tree::swap(other);
+        record_all(operation::Insert);
+        other.record_all(operation::Insert);
+    }
+
+    friend void swap(recording_type& left, recording_type& right) {
+        left.swap(right);
+    }
+
+    void record_to(std::ostream& os, Codec cdc = Codec{}) {
+        writer_.emplace(os, std::move(cdc));
+    }
+
+    void stop_recording() {
+        writer_.reset();
+    }
+
+    template <typename T = value_type, typename = impl::enable_if_convertible_t<T, value_type>>
+    std::pair<iterator, bool> insert(T&& value) {
+        if(writer_)
+            writer_->write(operation::Insert, value);
+        return Tree::insert(std::forward<T>(value));
+    }
+
+    template <typename T = value_type, typename = impl::enable_if_convertible_t<T, value_type>>
+    iterator insert(const_iterator hint, T&& value) {
+        if(writer_)
+            writer_->write(operation::Insert, value);
+        return Tree::insert(hint, std::forward<T>(value));
+    }
+
+    template <typename InputIt, typename = impl::enable_if_iterator_t<InputIt>>
+    void insert(InputIt first, InputIt last) {
+        for(; first != last; ++first)
+            insert(*first);
+    }
+
+    /* Emplaced values are logged once constructed, or as the equal value
+     * already present if there is one */
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args) {
+        auto const result = Tree::emplace(std::forward<Args>(args)...);
+        if(writer_)
+            writer_->write(operation::Insert, *result.first);
+        return result;
+    }
+
+    template <typename... Args>
+    iterator emplace_hint(const_iterator hint, Args&&... args) {
+        auto const it = Tree::emplace_hint(hint, std::forward<Args>(args)...);
+        if(writer_)
+            writer_->write(operation::Insert, *it);
+        return it;
+    }
+
+    /* Logged as an insertion if the key was absent and as a search otherwise */
+    template <typename T = Tree, typename = impl::enable_if_mutable_map_t<T>>
+    mapped_type& operator[](key_type const& key) {
+        auto const size = Tree::size();
+        auto& mapped = Tree::operator[](key);
+        if(writer_)
+            writer_->write(Tree::size() == size ? operation::Find : operation::Insert, value_type{key, mapped});
+        return mapped;
+    }
+
+    template <typename T = Tree, typename = impl::enable_if_mutable_map_t<T>>
+    mapped_type& operator[](key_type&& key) {
+        /* The key is needed for the log after the value has been inserted */
+        if(writer_)
+            return (*this)[std::as_const(key)];
+        return Tree::operator[](std::move(key));
+    }
+
+    size_type erase(value_type const& value) {
+        if(writer_)
+            writer_->write(operation::Erase, value);
+        return Tree::erase(value);
+    }
+
+    std::optional<value_type> extract_value(value_type const& value) {
+        if(writer_)
+            writer_->write(operation::Erase, value);
+        return Tree::extract_value(value);
+    }
+
+    /* Only values actually removed are logged, as there is no value to log
+     * for absent keys or empty trees */
+    template <typename T = Tree, typename = impl::enable_if_keyed_t<T>>
+    std::optional<value_type> take(key_type const& key) {
+        auto value = Tree::take(key);
+        if(writer_ && value)
+            writer_->write(operation::Erase, *value);
+        return value;
+    }
+
+    std::optional<value_type> pop_min() {
+        auto value = Tree::pop_min();
+        if(writer_ && value)
+            writer_->write(operation::Erase, *value);
+        return value;
+    }
+
+    std::optional<value_type> pop_max() {
+        auto value = Tree::pop_max();
+        if(writer_ && value)
+            writer_->write(operation::Erase, *value);
+        return value;
+    }
+
+    std::vector<value_type> pop_min_n(size_type k) {
+        auto values = Tree::pop_min_n(k);
+        if(writer_) {
+            for(auto const& value : values)
+                writer_->write(operation::Erase, value);
+        }
+        return values;
+    }
+
+    void clear() {
+        record_all(operation::Erase);
+        Tree::clear();
+    }
+
+    /* Logged as the erasure of the previous values and the insertion of the
+     * loaded ones */
+    template <typename LoadCodec = codec<value_type>>
+    void load(std::istream& is, LoadCodec const& cdc = LoadCodec{}) {
+        record_all(operation::Erase);
+        Tree::load(is, cdc);
+        record_all(operation::Insert);
+    }
+
+    iterator find(value_type const& value) {
+        if(writer_)
+            writer_->write(operation::Find, value);
+        return Tree::find(value);
+    }
+
+    const_iterator find(value_type const& value) const {
+        if(writer_)
+            writer_->write(operation::Find, value);
+        return Tree::find(value);
+    }
+
+    iterator lower_bound(value_type const& value) {
+        if(writer_)
+            writer_->write(operation::LowerBound, value);
+        return Tree::lower_bound(value);
+    }
+
+    const_iterator lower_bound(value_type const& value) const {
+        if(writer_)
+            writer_->write(operation::LowerBound, value);
+        return Tree::lower_bound(value);
+    }
+
+    /* Calls f with at most count values, starting at the first value not less than value */
+    template <typename F>
+    size_type iterate(value_type const& value, size_type count, F f) const {
+        if(writer_)
+            writer_->write(operation::Iterate, value, count);
+
+        size_type steps = 0u;
+        for(auto it = Tree::lower_bound(value); steps < count && it != Tree::end(); ++it, ++steps)
+            f(*it);
+        return steps;
+    }
+
+    private:
+        void record_all(operation op) {
+            if(writer_) {
+                for(auto const& value : static_cast<Tree const&>(*this))
+                    writer_->write(op, value);
+            }
+        }
+
+        mutable std::optional<record_writer<value_type, Codec>> writer_{};
+};
+
+} /* namespace trbt */
+
+#endif
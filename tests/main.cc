@@ -1,25 +1,38 @@
 #include "trbt_test_config.h"
 #include "trbt_test_framework.h"
+#include "trbt_test_runner.h"
 #include "trbt_trace_type.h"
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
 #include <random>
 #include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
 #include <utility>
+#include <vector>
 
-int main() {
+namespace {
+
+/* Runs the share of every test family assigned to runner */
+void run_shard(trbt::test::shard& runner) {
     using namespace trbt;
-    std::mt19937 mt{std::random_device{}()};
+    auto& mt = runner.rng();
     #ifndef TRBT_LOCK_ITERS
     std::uniform_int_distribution<> iter_dis(0, 1000);
     #else
     std::uniform_int_distribution<> iter_dis(1,3);
     #endif
-    std::uniform_int_distribution<> test_size_dis(1, 1500);
+    std::uniform_int_distribution<> test_size_dis(1, runner.max_test_size());
     
     test::trbt_trace_type<rbtree<int>> int_tree;
     test::trbt_trace_type<rbtree<std::string>> str_tree;
     test::trbt_trace_type<rbtree<std::pair<int, double>>> pair_tree;
 
-    std::size_t total_iters = 0u;
     int iters;
     
     try {
@@ -28,9 +41,8 @@ int main() {
         /* ------------------ */
         if constexpr(test::test_int_copy_ctor) {
             impl::scoped_bool sb{int_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("COPY CTOR (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("COPY CTOR (int)", test_size, i, iters);
                 auto vec = test::generate_int_vec(test_size);
@@ -47,9 +59,8 @@ int main() {
         /* ------------------ */
         if constexpr(test::test_int_move_ctor) {
             impl::scoped_bool sb{int_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("MOVE CTOR (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("MOVE CTOR (int)", test_size, i ,iters);
                 auto vec = test::generate_int_vec(test_size);
@@ -66,10 +77,9 @@ int main() {
         /* ------------------------ */
         if constexpr(test::test_int_copy_assignment) {
             impl::scoped_bool sb{int_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
+            iters = runner.family("COPY ASSIGNMENT (int)", iter_dis);
 
-            for(int i = 0; i < iters; i++) {
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("COPY ASSIGNMENT (int)", test_size, i, iters);
                 auto vec = test::generate_int_vec(test_size);
@@ -86,10 +96,9 @@ int main() {
         /* ------------------------ */
         if constexpr(test::test_int_move_assignment) {
             impl::scoped_bool sb{int_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
+            iters = runner.family("MOVE ASSIGNMENT (int)", iter_dis);
 
-            for(int i = 0; i < iters; i++) {
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("MOVE ASSIGNMENT (int)", test_size, i, iters);
                 auto vec = test::generate_int_vec(test_size);
@@ -106,10 +115,9 @@ int main() {
         /* -------------- */
         if constexpr(test::test_int_empty) {
             impl::scoped_bool(int_tree.active);
-            iters = iter_dis(mt);
-            total_iters += iters;
+            iters = runner.family("EMPTY (int)", iter_dis);
             
-            for(int i = 0; i < iters; i++) {
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 test::print_heading("EMPTY (int)", 1, i, iters);
                 test::empty(int_tree);
             }
@@ -120,10 +128,9 @@ int main() {
         /* ------------- */
         if constexpr(test::test_int_size) {
             impl::scoped_bool(int_tree.active);
-            iters = iter_dis(mt);
-            total_iters += iters;
+            iters = runner.family("SIZE (int)", iter_dis);
             
-            for(int i = 0; i < iters; i++) {
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("SIZE (int)", test_size, i, iters);
                 auto vec = test::generate_int_vec(test_size);
@@ -136,10 +143,9 @@ int main() {
         /* -------------- */
         if constexpr(test::test_int_clear) {
             impl::scoped_bool(int_tree.active);
-            iters = iter_dis(mt);
-            total_iters += iters;
+            iters = runner.family("CLEAR (int)", iter_dis);
 
-            for(int i = 0; i < iters; i++) {
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 test::print_heading("CLEAR (int)", 1, i, iters);
                 test::clear(int_tree);
             }
@@ -150,9 +156,8 @@ int main() {
         /* ----------------- */
         if constexpr(test::test_int_contains) {
             impl::scoped_bool(int_tree.active);
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("CONTAINS (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 auto vec = test::generate_int_vec(test_size);
                 test::print_heading("CONTAINS (int)", test_size, i, iters);
@@ -168,10 +173,9 @@ int main() {
         /* -------------- */
         if constexpr(test::test_int_count) {
             impl::scoped_bool(int_tree.active);
-            iters = iter_dis(mt);
-            total_iters += iters;
+            iters = runner.family("COUNT (int)", iter_dis);
 
-            for(int i = 0; i < iters; i++) {
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 auto vec = test::generate_int_vec(test_size);
                 test::print_heading("COUNT (int)", test_size, i, iters);
@@ -187,9 +191,8 @@ int main() {
         /* ------------- */
         if constexpr(test::test_int_find) {
             impl::scoped_bool(int_tree.active);
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("FIND (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 auto vec = test::generate_int_vec(test_size);
                 test::print_heading("FIND (int)", test_size, i, iters);
@@ -204,9 +207,8 @@ int main() {
         /* ------------- */
         if constexpr(test::test_int_swap) {
             impl::scoped_bool(int_tree.active);
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("SWAP (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 auto vec = test::generate_int_vec(test_size);
                 test::print_heading("SWAP (int)", test_size, i, iters);
@@ -229,9 +231,8 @@ int main() {
         /* -------------------- */
         if constexpr(test::test_int_lower_bound) {
             impl::scoped_bool(int_tree.active);
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("LOWER BOUND (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 auto vec = test::generate_int_vec(test_size);
                 test::print_heading("LOWER BOUND (int)", test_size, i, iters);
@@ -246,9 +247,8 @@ int main() {
         /* -------------------- */
         if constexpr(test::test_int_upper_bound) {
             impl::scoped_bool(int_tree.active);
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("UPPER BOUND (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 auto vec = test::generate_int_vec(test_size);
                 test::print_heading("UPPER BOUND (int)", test_size, i, iters);
@@ -258,15 +258,30 @@ int main() {
             }
         }
 
+        /* -------------------- */
+        /* equal_range test int */
+        /* -------------------- */
+        if constexpr(test::test_int_equal_range) {
+            impl::scoped_bool(int_tree.active);
+            iters = runner.family("EQUAL RANGE (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
+                auto test_size = test_size_dis(mt);
+                auto vec = test::generate_int_vec(test_size);
+                test::print_heading("EQUAL RANGE (int)", test_size, i, iters);
+                int_tree.insert(std::begin(vec), std::end(vec));
+                vec = test::generate_int_vec(test_size);
+                test::equal_range(int_tree, vec);
+            }
+        }
+
         /* --------------- */
         /* Insert test int */
         /* --------------- */
         if constexpr(test::test_int_insert) {
             impl::scoped_bool sb{int_tree.active};
 
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("INSERT (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("INSERT (int)", test_size, i, iters); 
                 
@@ -287,9 +302,8 @@ int main() {
         if constexpr(test::test_int_hinted_insert) {
             impl::scoped_bool sb{int_tree.active};
 
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("HINTED INSERT (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("HINTED INSERT (int)", test_size, i, iters); 
                 
@@ -310,9 +324,8 @@ int main() {
         if constexpr(test::test_int_insert_range) {
             impl::scoped_bool sb{int_tree.active};
 
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("INSERT RANGE (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("INSERT RANGE (int)", test_size, i, iters); 
                 
@@ -333,9 +346,8 @@ int main() {
         if constexpr(test::test_int_emplace) {
             impl::scoped_bool sb{int_tree.active};
 
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("EMPLACE (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("EMPLACE (int)", test_size, i, iters); 
                 
@@ -356,9 +368,8 @@ int main() {
         if constexpr(test::test_int_hinted_emplace) {
             impl::scoped_bool sb{int_tree.active};
 
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("HINTED EMPLACE (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("HINTED EMPLACE (int)", test_size, i, iters); 
                 
@@ -379,9 +390,8 @@ int main() {
         if constexpr(test::test_int_erase) {
             impl::scoped_bool sb{int_tree.active};
 
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("ERASE (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("ERASE (int)", test_size, i, iters);
                 
@@ -397,14 +407,28 @@ int main() {
             }
         }
         
+        /* ---------------------- */
+        /* Extract value test int */
+        /* ---------------------- */
+        if constexpr(test::test_int_extract_value) {
+            iters = runner.family("EXTRACT VALUE (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
+                auto test_size = test_size_dis(mt);
+                test::print_heading("EXTRACT VALUE (int)", test_size, i, iters);
+                auto vec = test::generate_int_vec(test_size);
+                test::extract_value(vec, [](int i) {
+                    return std::to_string(i);
+                });
+            }
+        }
+
         /* ------------------- */
         /* operator== test int */
         /* ------------------- */
         if constexpr(test::test_int_eq) {
             impl::scoped_bool sb{int_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("OPERATOR== (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("OPERATOR== (int)", test_size, i, iters);
 
@@ -421,9 +445,8 @@ int main() {
         /* ------------------- */
         if constexpr(test::test_int_neq) {
             impl::scoped_bool sb{int_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("OPERATOR!= (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("OPERATOR!= (int)", test_size, i, iters);
 
@@ -440,10 +463,9 @@ int main() {
         /* ------------------ */
         if constexpr(test::test_int_less) {
             impl::scoped_bool sb{int_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
+            iters = runner.family("OPERATOR< (int)", iter_dis);
 
-            for(int i = 0; i < iters; i++) {
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("OPERATOR< (int)", test_size, i, iters);
 
@@ -459,10 +481,9 @@ int main() {
         /* ------------------ */
         if constexpr(test::test_int_greater) {
             impl::scoped_bool sb{int_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
+            iters = runner.family("OPERATOR> (int)", iter_dis);
 
-            for(int i = 0; i < iters; i++) {
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("OPERATOR> (int)", test_size, i, iters);
 
@@ -478,10 +499,9 @@ int main() {
         /* ------------------- */
         if constexpr(test::test_int_less_or_eq) {
             impl::scoped_bool sb{int_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
+            iters = runner.family("OPERATOR<= (int)", iter_dis);
 
-            for(int i = 0; i < iters; i++) {
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("OPERATOR<= (int)", test_size, i, iters);
 
@@ -497,10 +517,9 @@ int main() {
         /* ------------------- */
         if constexpr(test::test_int_greater_or_eq) {
             impl::scoped_bool sb{int_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
+            iters = runner.family("OPERATOR>= (int)", iter_dis);
 
-            for(int i = 0; i < iters; i++) {
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("OPERATOR>= (int)", test_size, i, iters);
 
@@ -516,9 +535,8 @@ int main() {
         /* ----------------- */
         if constexpr(test::test_int_iters) {
             impl::scoped_bool sb{int_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("ITERS (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("ITERS (int)", test_size, i, iters);
                 auto vec = test::generate_int_vec(test_size);
@@ -526,14 +544,255 @@ int main() {
             }
         }
 
+        /* ----------------- */
+        /* For each test int */
+        /* ----------------- */
+        if constexpr(test::test_int_for_each) {
+            impl::scoped_bool sb{int_tree.active};
+            iters = runner.family("FOR EACH (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
+                auto test_size = test_size_dis(mt);
+                test::print_heading("FOR EACH (int)", test_size, i, iters);
+                auto vec = test::generate_int_vec(test_size);
+                test::for_each(int_tree, vec);
+            }
+        }
+
+        /* ----------------------- */
+        /* Split ranges test int */
+        /* ----------------------- */
+        if constexpr(test::test_int_split_ranges) {
+            iters = runner.family("SPLIT RANGES (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
+                auto test_size = test_size_dis(mt);
+                test::print_heading("SPLIT RANGES (int)", test_size, i, iters);
+                auto vec = test::generate_int_vec(test_size);
+                test::split_ranges(vec);
+            }
+        }
+
+        /* ----------------- */
+        /* Reduce test int */
+        /* ----------------- */
+        if constexpr(test::test_int_reduce) {
+            iters = runner.family("REDUCE (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
+                auto test_size = test_size_dis(mt);
+                test::print_heading("REDUCE (int)", test_size, i, iters);
+                auto vec = test::generate_int_vec(test_size);
+                test::reduce(vec);
+            }
+        }
+
+        /* ------------------ */
+        /* Augment test int */
+        /* ------------------ */
+        if constexpr(test::test_int_augment) {
+            iters = runner.family("AUGMENT (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
+                auto test_size = test_size_dis(mt);
+                test::print_heading("AUGMENT (int)", test_size, i, iters);
+                auto vec = test::generate_int_vec(test_size);
+                test::augment(vec);
+            }
+        }
+
+        /* ----------------- */
+        /* Interval test int */
+        /* ----------------- */
+        if constexpr(test::test_int_interval) {
+            iters = runner.family("INTERVAL (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
+                auto test_size = test_size_dis(mt);
+                test::print_heading("INTERVAL (int)", test_size, i, iters);
+                auto vec = test::generate_int_vec(test_size);
+                test::interval(vec);
+            }
+        }
+
+        /* ------------------- */
+        /* Duplicates test int */
+        /* ------------------- */
+        if constexpr(test::test_int_duplicates) {
+            iters = runner.family("DUPLICATES (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
+                auto test_size = test_size_dis(mt);
+                test::print_heading("DUPLICATES (int)", test_size, i, iters);
+                auto vec = test::generate_int_vec(test_size);
+                test::duplicates(vec);
+            }
+        }
+
+        /* ----------------------- */
+        /* Priority queue test int */
+        /* ----------------------- */
+        if constexpr(test::test_int_priority_queue) {
+            iters = runner.family("PRIORITY QUEUE (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
+                auto test_size = test_size_dis(mt);
+                test::print_heading("PRIORITY QUEUE (int)", test_size, i, iters);
+                auto vec = test::generate_int_vec(test_size);
+                test::priority_queue(vec);
+            }
+        }
+
+        /* ------------------ */
+        /* Move-only test int */
+        /* ------------------ */
+        if constexpr(test::test_int_move_only) {
+            iters = runner.family("MOVE ONLY (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
+                auto test_size = test_size_dis(mt);
+                test::print_heading("MOVE ONLY (int)", test_size, i, iters);
+                auto vec = test::generate_int_vec(test_size);
+                test::move_only(vec);
+            }
+        }
+
+        /* ----------------------------- */
+        /* Three-way comparison test int */
+        /* ----------------------------- */
+        if constexpr(test::test_int_three_way) {
+            iters = runner.family("THREE WAY COMPARISON (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
+                auto test_size = test_size_dis(mt);
+                test::print_heading("THREE WAY COMPARISON (int)", test_size, i, iters);
+                auto vec = test::generate_int_vec(test_size);
+                test::three_way(vec);
+            }
+        }
+
+        /* --------------------------- */
+        /* Operation counters test int */
+        /* --------------------------- */
+        if constexpr(test::test_int_counters) {
+            iters = runner.family("OPERATION COUNTERS (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
+                auto test_size = test_size_dis(mt);
+                test::print_heading("OPERATION COUNTERS (int)", test_size, i, iters);
+                auto vec = test::generate_int_vec(test_size);
+                test::counters(vec);
+            }
+        }
+
+        /* -------------- */
+        /* Stats test int */
+        /* -------------- */
+        if constexpr(test::test_int_stats) {
+            impl::scoped_bool sb{int_tree.active};
+            iters = runner.family("STATS (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
+                auto test_size = test_size_dis(mt);
+                test::print_heading("STATS (int)", test_size, i, iters);
+                auto vec = test::generate_int_vec(test_size);
+                test::stats(int_tree, vec);
+            }
+        }
+
+        /* --------------- */
+        /* Record test int */
+        /* --------------- */
+        if constexpr(test::test_int_record) {
+            iters = runner.family("RECORD (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
+                auto test_size = test_size_dis(mt);
+                test::print_heading("RECORD (int)", test_size, i, iters);
+                auto vec = test::generate_int_vec(test_size);
+                test::record(vec);
+            }
+        }
+
+        /* --------------- */
+        /* Freeze test int */
+        /* --------------- */
+        if constexpr(test::test_int_freeze) {
+            impl::scoped_bool sb{int_tree.active};
+            iters = runner.family("FREEZE (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
+                auto test_size = test_size_dis(mt);
+                test::print_heading("FREEZE (int)", test_size, i, iters);
+                auto vec = test::generate_int_vec(test_size);
+                test::freeze(int_tree, vec, [](int i) {
+                    return std::to_string(i);
+                });
+            }
+        }
+
+        /* ------------------------ */
+        /* Freeze policies test int */
+        /* ------------------------ */
+        if constexpr(test::test_int_freeze_policies) {
+            iters = runner.family("FREEZE POLICIES (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
+                auto test_size = test_size_dis(mt);
+                test::print_heading("FREEZE POLICIES (int)", test_size, i, iters);
+                auto vec = test::generate_int_vec(test_size);
+                test::freeze_policies(vec);
+            }
+        }
+
+        /* ---------------------- */
+        /* Save and load test int */
+        /* ---------------------- */
+        if constexpr(test::test_int_save_load) {
+            impl::scoped_bool sb{int_tree.active};
+            iters = runner.family("SAVE AND LOAD (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
+                auto test_size = test_size_dis(mt);
+                test::print_heading("SAVE AND LOAD (int)", test_size, i, iters);
+                auto vec = test::generate_int_vec(test_size);
+                test::save_load(int_tree, vec, [](int i) {
+                    return std::to_string(i);
+                });
+            }
+        }
+
+        /* ---------------------- */
+        /* Freeze B-tree test int */
+        /* ---------------------- */
+        if constexpr(test::test_int_freeze_btree) {
+            iters = runner.family("FREEZE B-TREE (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
+                auto test_size = test_size_dis(mt);
+                test::print_heading("FREEZE B-TREE (int)", test_size, i, iters);
+                auto vec = test::generate_int_vec(test_size);
+                test::freeze_btree(vec);
+            }
+        }
+
+        /* ----------------- */
+        /* Snapshot test int */
+        /* ----------------- */
+        if constexpr(test::test_int_snapshot) {
+            iters = runner.family("SNAPSHOT (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
+                auto test_size = test_size_dis(mt);
+                test::print_heading("SNAPSHOT (int)", test_size, i, iters);
+                auto vec = test::generate_int_vec(test_size);
+                test::snapshot(vec);
+            }
+        }
+
+        /* -------------------------- */
+        /* Snapshot policies test int */
+        /* -------------------------- */
+        if constexpr(test::test_int_snapshot_policies) {
+            iters = runner.family("SNAPSHOT POLICIES (int)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
+                auto test_size = test_size_dis(mt);
+                test::print_heading("SNAPSHOT POLICIES (int)", test_size, i, iters);
+                auto vec = test::generate_int_vec(test_size);
+                test::snapshot_policies(vec);
+            }
+        }
+
         /* -------------------------- */
         /* Copy ctor test std::string */
         /* -------------------------- */
         if constexpr(test::test_string_copy_ctor) {
             impl::scoped_bool sb{str_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("COPY CTOR (std::string)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("COPY CTOR (std::string)", test_size, i, iters);
                 auto vec = test::generate_string_vec(test_size);
@@ -550,9 +809,8 @@ int main() {
         /* -------------------------- */
         if constexpr(test::test_string_move_ctor) {
             impl::scoped_bool sb{str_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("MOVE CTOR (std::string)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("MOVE CTOR (std::string)", test_size, i, iters);
                 auto vec = test::generate_string_vec(test_size);
@@ -569,9 +827,8 @@ int main() {
         /* -------------------------------- */
         if constexpr(test::test_string_copy_assignment) {
             impl::scoped_bool sb{str_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("COPY ASSIGNMENT (std::string)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("COPY ASSIGNMENT (std::string)", test_size, i, iters);
                 auto vec = test::generate_string_vec(test_size);
@@ -588,9 +845,8 @@ int main() {
         /* -------------------------- */
         if constexpr(test::test_string_move_assignment) {
             impl::scoped_bool sb{str_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("MOVE ASSIGNMENT (std::string)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("MOVE ASSIGNMENT (std::string)", test_size, i, iters);
                 auto vec = test::generate_string_vec(test_size);
@@ -607,9 +863,8 @@ int main() {
         /* ---------------------- */
         if constexpr(test::test_string_empty) {
             impl::scoped_bool(str_tree.active);
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("EMPTY (std::string)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 test::print_heading("EMPTY (std::string)", 1, i, iters);
                 test::empty(str_tree);
             }
@@ -620,9 +875,8 @@ int main() {
         /* --------------------- */
         if constexpr(test::test_string_size) {
             impl::scoped_bool(str_tree.active);
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("SIZE (std::string)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 auto vec = test::generate_string_vec(test_size);
                 test::print_heading("SIZE (std::string)", test_size, i, iters);
@@ -635,9 +889,8 @@ int main() {
         /* ---------------------- */
         if constexpr(test::test_string_clear) {
             impl::scoped_bool(str_tree.active);
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("CLEAR (std::string)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 test::print_heading("CLEAR (std::string)", 1, i, iters);
                 test::clear(str_tree);
             }
@@ -648,9 +901,8 @@ int main() {
         /* ------------------------- */
         if constexpr(test::test_string_contains) {
             impl::scoped_bool(str_tree.active);
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("CONTAINS (std::string)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 auto vec = test::generate_string_vec(test_size);
                 test::print_heading("CONTAINS (std::string)", test_size, i, iters);
@@ -666,9 +918,8 @@ int main() {
         /* ---------------------- */
         if constexpr(test::test_string_count) {
             impl::scoped_bool(str_tree.active);
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("COUNT (std::string)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 auto vec = test::generate_string_vec(test_size);
                 test::print_heading("COUNT (std::string)", test_size, i, iters);
@@ -684,10 +935,9 @@ int main() {
         /* --------------------- */
         if constexpr(test::test_string_find) {
             impl::scoped_bool(str_tree.active);
-            iters = iter_dis(mt);
-            total_iters += iters;
+            iters = runner.family("FIND (std::string)", iter_dis);
             
-            for(int i = 0; i < iters; i++) {
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 auto vec = test::generate_string_vec(test_size);
                 test::print_heading("FIND (std::string)", test_size, i, iters);
@@ -702,9 +952,8 @@ int main() {
         /* --------------------- */
         if constexpr(test::test_string_swap) {
             impl::scoped_bool(str_tree.active);
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("SWAP (std::string)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 auto vec = test::generate_string_vec(test_size);
                 test::print_heading("SWAP (std::string)", test_size, i, iters);
@@ -727,9 +976,8 @@ int main() {
         /* ---------------------------- */
         if constexpr(test::test_string_lower_bound) {
             impl::scoped_bool(str_tree.active);
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("LOWER BOUND (std::string)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 auto vec = test::generate_string_vec(test_size);
                 test::print_heading("LOWER BOUND (std::string)", test_size, i, iters);
@@ -744,9 +992,8 @@ int main() {
         /* ---------------------------- */
         if constexpr(test::test_string_upper_bound) {
             impl::scoped_bool(str_tree.active);
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("UPPER BOUND (std::string)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 auto vec = test::generate_string_vec(test_size);
                 test::print_heading("UPPER BOUND (std::string)", test_size, i, iters);
@@ -756,15 +1003,30 @@ int main() {
             }
         }
 
+        /* ---------------------------- */
+        /* equal_range test std::string */
+        /* ---------------------------- */
+        if constexpr(test::test_string_equal_range) {
+            impl::scoped_bool(str_tree.active);
+            iters = runner.family("EQUAL RANGE (std::string)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
+                auto test_size = test_size_dis(mt);
+                auto vec = test::generate_string_vec(test_size);
+                test::print_heading("EQUAL RANGE (std::string)", test_size, i, iters);
+                str_tree.insert(std::begin(vec), std::end(vec));
+                vec = test::generate_string_vec(test_size);
+                test::equal_range(str_tree, vec);
+            }
+        }
+
         /* ----------------------- */
         /* Insert test std::string */
         /* ----------------------- */
         if constexpr(test::test_string_insert) {
             impl::scoped_bool sb{str_tree.active};
 
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("INSERT (std::string)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("INSERT (std::string)", test_size, i, iters); 
                 
@@ -786,9 +1048,8 @@ int main() {
         if constexpr(test::test_string_hinted_insert) {
             impl::scoped_bool sb{str_tree.active};
 
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("HINTED INSERT (std::string)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("HINTED INSERT (std::string)", test_size, i, iters); 
                 
@@ -809,9 +1070,8 @@ int main() {
         if constexpr(test::test_string_insert_range) {
             impl::scoped_bool sb{str_tree.active};
 
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("INSERT RANGE (std::string)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("INSERT RANGE (std::string)", test_size, i, iters); 
                 
@@ -832,9 +1092,8 @@ int main() {
         if constexpr(test::test_string_emplace) {
             impl::scoped_bool sb{str_tree.active};
 
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("EMPLACE (std::string)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("EMPLACE (std::string)", test_size, i, iters); 
                 
@@ -855,9 +1114,8 @@ int main() {
         if constexpr(test::test_string_hinted_emplace) {
             impl::scoped_bool sb{str_tree.active};
 
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("HINTED EMPLACE (std::string)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("HINTED EMPLACE (std::string)", test_size, i, iters); 
                 
@@ -878,9 +1136,8 @@ int main() {
         if constexpr(test::test_string_erase) {
             impl::scoped_bool sb{str_tree.active};
 
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("ERASE (std::string)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("ERASE (std::string)", test_size, i, iters);
                 
@@ -895,14 +1152,28 @@ int main() {
             }
         }
 
+        /* ------------------------------ */
+        /* Extract value test std::string */
+        /* ------------------------------ */
+        if constexpr(test::test_string_extract_value) {
+            iters = runner.family("EXTRACT VALUE (std::string)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
+                auto test_size = test_size_dis(mt);
+                test::print_heading("EXTRACT VALUE (std::string)", test_size, i, iters);
+                auto vec = test::generate_string_vec(test_size);
+                test::extract_value(vec, [](auto const& str) {
+                    return str;
+                });
+            }
+        }
+
         /* --------------------------- */
         /* operator== test std::string */
         /* --------------------------- */
         if constexpr(test::test_string_eq) {
             impl::scoped_bool sb{str_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("OPERATOR== (std::string)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("OPERATOR== (std::string)", test_size, i, iters);
 
@@ -919,9 +1190,8 @@ int main() {
         /* --------------------------- */
         if constexpr(test::test_string_neq) {
             impl::scoped_bool sb{str_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("OPERATOR!= (std::string)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("OPERATOR!= (std::string)", test_size, i, iters);
 
@@ -938,10 +1208,9 @@ int main() {
         /* -------------------------- */
         if constexpr(test::test_string_less) {
             impl::scoped_bool sb{str_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
+            iters = runner.family("OPERATOR< (std::string)", iter_dis);
 
-            for(int i = 0; i < iters; i++) {
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("OPERATOR< (std::string)", test_size, i, iters);
 
@@ -957,10 +1226,9 @@ int main() {
         /* -------------------------- */
         if constexpr(test::test_string_greater) {
             impl::scoped_bool sb{str_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
+            iters = runner.family("OPERATOR> (std::string)", iter_dis);
 
-            for(int i = 0; i < iters; i++) {
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("OPERATOR> (std::string)", test_size, i, iters);
 
@@ -976,10 +1244,9 @@ int main() {
         /* --------------------------- */
         if constexpr(test::test_string_less_or_eq) {
             impl::scoped_bool sb{str_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
+            iters = runner.family("OPERATOR<= (std::string)", iter_dis);
 
-            for(int i = 0; i < iters; i++) {
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("OPERATOR<= (std::string)", test_size, i, iters);
 
@@ -995,10 +1262,9 @@ int main() {
         /* --------------------------- */
         if constexpr(test::test_string_greater_or_eq) {
             impl::scoped_bool sb{str_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
+            iters = runner.family("OPERATOR>= (std::string)", iter_dis);
 
-            for(int i = 0; i < iters; i++) {
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("OPERATOR>= (std::string)", test_size, i, iters);
 
@@ -1014,9 +1280,8 @@ int main() {
         /* ------------------------- */
         if constexpr(test::test_string_iters) {
             impl::scoped_bool sb{str_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("ITERS (std::string)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("ITERS (std::string)", test_size, i, iters);
                 auto vec = test::generate_string_vec(test_size);
@@ -1024,14 +1289,73 @@ int main() {
             }
         }
 
+        /* ------------------------- */
+        /* For each test std::string */
+        /* ------------------------- */
+        if constexpr(test::test_string_for_each) {
+            impl::scoped_bool sb{str_tree.active};
+            iters = runner.family("FOR EACH (std::string)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
+                auto test_size = test_size_dis(mt);
+                test::print_heading("FOR EACH (std::string)", test_size, i, iters);
+                auto vec = test::generate_string_vec(test_size);
+                test::for_each(str_tree, vec);
+            }
+        }
+
+        /* ---------------------- */
+        /* Stats test std::string */
+        /* ---------------------- */
+        if constexpr(test::test_string_stats) {
+            impl::scoped_bool sb{str_tree.active};
+            iters = runner.family("STATS (std::string)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
+                auto test_size = test_size_dis(mt);
+                test::print_heading("STATS (std::string)", test_size, i, iters);
+                auto vec = test::generate_string_vec(test_size);
+                test::stats(str_tree, vec);
+            }
+        }
+
+        /* ----------------------- */
+        /* Freeze test std::string */
+        /* ----------------------- */
+        if constexpr(test::test_string_freeze) {
+            impl::scoped_bool sb{str_tree.active};
+            iters = runner.family("FREEZE (std::string)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
+                auto test_size = test_size_dis(mt);
+                test::print_heading("FREEZE (std::string)", test_size, i, iters);
+                auto vec = test::generate_string_vec(test_size);
+                test::freeze(str_tree, vec, [](auto const& str) {
+                    return str;
+                });
+            }
+        }
+
+        /* ------------------------------ */
+        /* Save and load test std::string */
+        /* ------------------------------ */
+        if constexpr(test::test_string_save_load) {
+            impl::scoped_bool sb{str_tree.active};
+            iters = runner.family("SAVE AND LOAD (std::string)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
+                auto test_size = test_size_dis(mt);
+                test::print_heading("SAVE AND LOAD (std::string)", test_size, i, iters);
+                auto vec = test::generate_string_vec(test_size);
+                test::save_load(str_tree, vec, [](auto const& str) {
+                    return str;
+                });
+            }
+        }
+
         /* -------------------------------- */
         /* Copy ctor test pair<int, double> */
         /* -------------------------------- */
         if constexpr(test::test_pair_copy_ctor) {
             impl::scoped_bool sb{pair_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("COPY CTOR (std::pair<int, double>)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 auto vec = test::generate_pair_vec(test_size);
                 test::print_heading("COPY CTOR (std::pair<int, double>)", test_size, i, iters);
@@ -1050,9 +1374,8 @@ int main() {
         /* -------------------------------- */
         if constexpr(test::test_pair_move_ctor) {
             impl::scoped_bool sb{pair_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("MOVE CTOR (std::pair<int, double>)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("MOVE CTOR (std::pair<int, double>)", test_size, i, iters);
                 auto vec = test::generate_pair_vec(test_size);
@@ -1071,9 +1394,8 @@ int main() {
         /* -------------------------------------- */
         if constexpr(test::test_pair_copy_assignment) {
             impl::scoped_bool sb{pair_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("COPY ASSIGNMENT (std::pair<int, double>)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("COPY ASSIGNMENT (std::pair<int, double>)", test_size, i, iters);
                 auto vec = test::generate_pair_vec(test_size);
@@ -1092,9 +1414,8 @@ int main() {
         /* -------------------------------------- */
         if constexpr(test::test_pair_move_assignment) {
             impl::scoped_bool sb{pair_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("MOVE ASSIGNMENT (std::pair<int, double>)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("MOVE ASSIGNMENT (std::pair<int, double>)", test_size, i, iters);
                 auto vec = test::generate_pair_vec(test_size);
@@ -1113,9 +1434,8 @@ int main() {
         /* ---------------------------- */
         if constexpr(test::test_pair_empty) {
             impl::scoped_bool(pair_tree.active);
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("EMPTY (std::pair<int, double>)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 test::print_heading("EMPTY (std::pair<int, double>)", 1, i, iters);
                 test::empty(pair_tree);
             }
@@ -1126,9 +1446,8 @@ int main() {
         /* --------------------------- */
         if constexpr(test::test_pair_size) {
             impl::scoped_bool(pair_tree.active);
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("SIZE (std::pair<int, double>)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("SIZE (std::pair<int, double>)", 1, i, iters);
                 auto vec = test::generate_pair_vec(test_size);
@@ -1141,9 +1460,8 @@ int main() {
         /* --------------------------------- */
         if constexpr(test::test_pair_clear) {
             impl::scoped_bool(pair_tree.active);
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("CLEAR (std::pair<int, double>)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 test::print_heading("CLEAR (std::pair<int, double>)", 1, i, iters);
                 test::clear(pair_tree);
             }
@@ -1154,9 +1472,8 @@ int main() {
         /* ------------------------------------ */
         if constexpr(test::test_pair_contains) {
             impl::scoped_bool(pair_tree.active);
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("CONTAINS (std::pair<int, double>)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("CONTAINS (std::pair<int, double>)", test_size, i, iters);
                 auto vec = test::generate_pair_vec(test_size);
@@ -1174,9 +1491,8 @@ int main() {
         /* --------------------------------- */
         if constexpr(test::test_pair_count) {
             impl::scoped_bool(pair_tree.active);
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("COUNT (std::pair<int, double>)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("COUNT (std::pair<int, double>)", test_size, i, iters);
                 auto vec = test::generate_pair_vec(test_size);
@@ -1194,9 +1510,8 @@ int main() {
         /* -------------------------------- */
         if constexpr(test::test_pair_find) {
             impl::scoped_bool(pair_tree.active);
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("FIND (std::pair<int, double>)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("FIND (std::pair<int, double>)", test_size, i, iters);
                 auto vec = test::generate_pair_vec(test_size);
@@ -1213,9 +1528,8 @@ int main() {
         /* ------------------------------- */
         if constexpr(test::test_pair_swap) {
             impl::scoped_bool(pair_tree.active);
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("SWAP (std::pair<int, double>)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 auto vec = test::generate_pair_vec(test_size);
                 test::print_heading("SWAP (std::pair<int, double>)", test_size, i, iters);
@@ -1240,9 +1554,8 @@ int main() {
         /* --------------------------------------- */
         if constexpr(test::test_pair_lower_bound) {
             impl::scoped_bool(pair_tree.active);
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("LOWER BOUND (std::pair<int, double>)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 auto vec = test::generate_pair_vec(test_size);
                 test::print_heading("LOWER BOUND (std::pair<int, double>)", test_size, i, iters);
@@ -1257,9 +1570,8 @@ int main() {
         /* --------------------------------------- */
         if constexpr(test::test_pair_upper_bound) {
             impl::scoped_bool(pair_tree.active);
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("UPPER BOUND (std::pair<int, double>)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 auto vec = test::generate_pair_vec(test_size);
                 test::print_heading("UPPER BOUND (std::pair<int, double>)", test_size, i, iters);
@@ -1275,9 +1587,8 @@ int main() {
         if constexpr(test::test_pair_insert) {
             impl::scoped_bool sb{pair_tree.active};
 
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("INSERT (std::pair<int, double>)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("INSERT (std::pair<int, double>)", test_size, i, iters); 
                 
@@ -1302,9 +1613,8 @@ int main() {
         if constexpr(test::test_pair_hinted_insert) {
             impl::scoped_bool sb{pair_tree.active};
 
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("HINTED INSERT (std::pair<int, double>)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("HINTED INSERT (std::pair<int, double>)", test_size, i, iters); 
                 auto vec = test::generate_pair_vec(test_size);
@@ -1328,9 +1638,8 @@ int main() {
         if constexpr(test::test_pair_insert_range) {
             impl::scoped_bool sb{pair_tree.active};
 
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("INSERT RANGE (std::pair<int, double>)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("INSERT RANGE (std::pair<int, double>)", test_size, i, iters); 
                 auto vec = test::generate_pair_vec(test_size);
@@ -1354,9 +1663,8 @@ int main() {
         if constexpr(test::test_pair_emplace) {
             impl::scoped_bool sb{pair_tree.active};
 
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("EMPLACE (std::pair<int, double>)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("EMPLACE (std::pair<int, double>)", test_size, i, iters); 
                 auto vec = test::generate_pair_vec(test_size);
@@ -1380,9 +1688,8 @@ int main() {
         if constexpr(test::test_pair_hinted_emplace) {
             impl::scoped_bool sb{pair_tree.active};
 
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("HINTED EMPLACE (std::pair<int, double>)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("HINTED EMPLACE (std::pair<int, double>)", test_size, i, iters); 
                 auto vec = test::generate_pair_vec(test_size);
@@ -1406,9 +1713,8 @@ int main() {
         if constexpr(test::test_pair_erase) {
             impl::scoped_bool sb{pair_tree.active};
 
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("ERASE (std::pair<int, double>)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("ERASE (std::pair<int, double>)", test_size, i, iters);
 
@@ -1430,9 +1736,8 @@ int main() {
         /* -------------------------------------- */
         if constexpr(test::test_pair_eq) {
             impl::scoped_bool sb{pair_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("OPERATOR== (std::pair<int, double>)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("OPERATOR== (std::pair<int, double>)", test_size, i, iters);
 
@@ -1447,9 +1752,8 @@ int main() {
         /* -------------------------------------- */
         if constexpr(test::test_pair_neq) {
             impl::scoped_bool sb{pair_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("OPERATOR!= (std::pair<int, double>)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("OPERATOR!= (std::pair<int, double>)", test_size, i, iters);
 
@@ -1464,10 +1768,9 @@ int main() {
         /* ------------------------------------- */
         if constexpr(test::test_pair_less) {
             impl::scoped_bool sb{pair_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
+            iters = runner.family("OPERATOR< (std::pair<int, double>)", iter_dis);
 
-            for(int i = 0; i < iters; i++) {
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("OPERATOR< (std::pair<int, double>)", test_size, i, iters);
 
@@ -1483,10 +1786,9 @@ int main() {
         /* ------------------------------------- */
         if constexpr(test::test_pair_greater) {
             impl::scoped_bool sb{pair_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
+            iters = runner.family("OPERATOR> (std::pair<int, double>)", iter_dis);
 
-            for(int i = 0; i < iters; i++) {
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("OPERATOR> (std::pair<int, double>)", test_size, i, iters);
 
@@ -1502,10 +1804,9 @@ int main() {
         /* -------------------------------------- */
         if constexpr(test::test_pair_less_or_eq) {
             impl::scoped_bool sb{pair_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
+            iters = runner.family("OPERATOR<= (std::pair<int, double>)", iter_dis);
 
-            for(int i = 0; i < iters; i++) {
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("OPERATOR<= (std::pair<int, double>)", test_size, i, iters);
 
@@ -1521,10 +1822,9 @@ int main() {
         /* -------------------------------------- */
         if constexpr(test::test_pair_greater_or_eq) {
             impl::scoped_bool sb{pair_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
+            iters = runner.family("OPERATOR>= (std::pair<int, double>)", iter_dis);
 
-            for(int i = 0; i < iters; i++) {
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("OPERATOR>= (std::pair<int, double>)", test_size, i, iters);
 
@@ -1540,9 +1840,8 @@ int main() {
         /* ------------------------------------ */
         if constexpr(test::test_pair_iters) {
             impl::scoped_bool sb{pair_tree.active};
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("ITERS (std::pair<int, double>)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("ITERS (std::pair<int, double>)", test_size, i, iters);
                 auto vec = test::generate_pair_vec(test_size);
@@ -1551,15 +1850,50 @@ int main() {
         }
                     
 
+        /* ---------------------------------- */
+        /* Freeze test std::pair<int, double> */
+        /* ---------------------------------- */
+        if constexpr(test::test_pair_freeze) {
+            impl::scoped_bool sb{pair_tree.active};
+            iters = runner.family("FREEZE (std::pair<int, double>)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
+                auto test_size = test_size_dis(mt);
+                test::print_heading("FREEZE (std::pair<int, double>)", test_size, i, iters);
+                auto vec = test::generate_pair_vec(test_size);
+                test::freeze(pair_tree, vec, [](auto const& pair) {
+                    std::ostringstream ss;
+                    ss << "{" << pair.first << ", " << pair.second << "}";
+                    return ss.str();
+                });
+            }
+        }
+
+        /* ----------------------------------------- */
+        /* Save and load test std::pair<int, double> */
+        /* ----------------------------------------- */
+        if constexpr(test::test_pair_save_load) {
+            impl::scoped_bool sb{pair_tree.active};
+            iters = runner.family("SAVE AND LOAD (std::pair<int, double>)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
+                auto test_size = test_size_dis(mt);
+                test::print_heading("SAVE AND LOAD (std::pair<int, double>)", test_size, i, iters);
+                auto vec = test::generate_pair_vec(test_size);
+                test::save_load(pair_tree, vec, [](auto const& pair) {
+                    std::ostringstream ss;
+                    ss << "{" << pair.first << ", " << pair.second << "}";
+                    return ss.str();
+                });
+            }
+        }
+
         /* ---------------------------------------------- */
         /* Emplace test std::pair<int, double>, piecewise */
         /* ---------------------------------------------- */
         if constexpr(test::test_pair_piecewise_emplace) {
             impl::scoped_bool sb{pair_tree.active};
 
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("EMPLACE (std::pair<int, double>, piecewise)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("EMPLACE (std::pair<int, double>, piecewise)", test_size, i, iters); 
                 auto vec = test::generate_int_vec(test_size);
@@ -1588,9 +1922,8 @@ int main() {
         if constexpr(test::test_pair_piecewise_hinted_emplace) {
             impl::scoped_bool sb{pair_tree.active};
 
-            iters = iter_dis(mt);
-            total_iters += iters;
-            for(int i = 0; i < iters; i++) {
+            iters = runner.family("HINTED EMPLACE (std::pair<int, double>, piecewise)", iter_dis);
+            for(int i = runner.first(); runner.proceed(i, iters); i += runner.stride()) {
                 auto test_size = test_size_dis(mt);
                 test::print_heading("HINTED EMPLACE (std::pair<int, double>, piecewise)", test_size, i, iters); 
                 auto vec = test::generate_int_vec(test_size);
@@ -1613,19 +1946,81 @@ int main() {
             }
         }
 
-        std::cout << "Finished " << total_iters << " tests successfully\n";
+        runner.finish_family();
     }
     catch(std::runtime_error& err) {
+        std::ostringstream os;
         if(int_tree.active)
-            int_tree.print_trace(test::trbt_trace_stream);
+            int_tree.print_trace(os);
         else if(str_tree.active)
-            str_tree.print_trace(test::trbt_trace_stream);
+            str_tree.print_trace(os);
         else
-            pair_tree.print_trace(test::trbt_trace_stream);
+            pair_tree.print_trace(os);
+
+        os << err.what() << "\n";
+        runner.fail(os.str());
+    }
+}
+
+} /* namespace */
 
-        test::trbt_trace_stream << err.what() << "\n";
+int main(int argc, char** argv) {
+    using namespace trbt;
+    test::runner_options opts;
+    try {
+        opts = test::parse_options(argc, argv);
+    }
+    catch(std::exception const& err) {
+        std::cerr << err.what() << "\nUsage: " << argv[0] << " [--seed <n>] [--threads <n>] [--scale <n>] [--max-size <n>]\n";
+        return 2;
+    }
+    std::cout << "Seed " << opts.seed << ", " << opts.threads << " thread(s), scale " << opts.scale 
+              << ", at most " << opts.max_size << " values per test\n";
+    test::set_print_headings(opts.threads == 1u);
+
+    std::atomic<bool> failed{false};
+    std::vector<std::unique_ptr<test::shard>> shards(opts.threads);
+    std::vector<std::thread> threads;
+    auto const start = std::chrono::steady_clock::now();
+    for(auto i = 0u; i < opts.threads; i++) {
+        threads.emplace_back([&opts, &failed, &shards, i]() {
+            shards[i] = std::make_unique<test::shard>(opts, i, failed);
+            run_shard(*shards[i]);
+        });
+    }
+    for(auto& thread : threads)
+        thread.join();
+    auto const wall = std::chrono::steady_clock::now() - start;
+
+    if(failed) {
+        for(auto const& sh : shards)
+            if(!sh->failure().empty())
+                test::trbt_trace_stream << sh->failure();
+        test::trbt_trace_stream << "Reproduce with --seed " << opts.seed << " --threads " << opts.threads
+                                << " --scale " << opts.scale << " --max-size " << opts.max_size << "\n";
         return 1;
     }
 
+    /* Per family totals, in order of execution */
+    std::vector<std::string> order;
+    std::map<std::string, std::pair<std::size_t, std::chrono::steady_clock::duration>> totals;
+    std::size_t total_iters = 0u;
+    for(auto const& sh : shards) {
+        for(auto const& res : sh->results()) {
+            auto [it, inserted] = totals.try_emplace(res.name, 0u, std::chrono::steady_clock::duration::zero());
+            if(inserted)
+                order.push_back(res.name);
+            it->second.first += res.iterations;
+            it->second.second += res.time;
+            total_iters += res.iterations;
+        }
+    }
+    for(auto const& name : order) {
+        auto const& [iterations, time] = totals[name];
+        std::cout << std::left << std::setw(56) << name << std::right << std::setw(6) << iterations
+                  << std::setw(12) << std::chrono::duration<double, std::milli>(time).count() << " ms\n";
+    }
+    std::cout << "Finished " << total_iters << " tests successfully in "
+              << std::chrono::duration<double>(wall).count() << " s\n";
     return 0;
 }
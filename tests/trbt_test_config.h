@@ -11,6 +11,11 @@ namespace trbt {
 namespace test {
 
 inline std::size_t constexpr trbt_trace_size      = 1u;
+/* Minimum number of logged operations between two checkpoints of a traced tree */
+inline std::size_t constexpr trbt_trace_checkpoint_interval = 1024u;
+/* Default upper bound for the number of values used per test, overridden
+ * by --max-size. Kept small so that a full run stays short */
+inline std::size_t constexpr trbt_max_test_size   = 1500u;
 inline std::ostream& trbt_trace_stream            = std::cout;
 
 /* int */
@@ -27,6 +32,7 @@ TRBT_TEST_FLAG test_int_find                      = true;
 TRBT_TEST_FLAG test_int_swap                      = true;
 TRBT_TEST_FLAG test_int_lower_bound               = true;
 TRBT_TEST_FLAG test_int_upper_bound               = true;
+TRBT_TEST_FLAG test_int_equal_range               = true;
 TRBT_TEST_FLAG test_int_insert                    = true;
 TRBT_TEST_FLAG test_int_insert_range              = true;
 TRBT_TEST_FLAG test_int_hinted_insert             = true;
@@ -40,6 +46,25 @@ TRBT_TEST_FLAG test_int_greater                   = true;
 TRBT_TEST_FLAG test_int_less_or_eq                = true;
 TRBT_TEST_FLAG test_int_greater_or_eq             = true;
 TRBT_TEST_FLAG test_int_iters                     = true;
+TRBT_TEST_FLAG test_int_for_each                  = true;
+TRBT_TEST_FLAG test_int_split_ranges              = true;
+TRBT_TEST_FLAG test_int_reduce                    = true;
+TRBT_TEST_FLAG test_int_augment                   = true;
+TRBT_TEST_FLAG test_int_interval                  = true;
+TRBT_TEST_FLAG test_int_duplicates                = true;
+TRBT_TEST_FLAG test_int_extract_value             = true;
+TRBT_TEST_FLAG test_int_priority_queue            = true;
+TRBT_TEST_FLAG test_int_move_only                 = true;
+TRBT_TEST_FLAG test_int_three_way                 = true;
+TRBT_TEST_FLAG test_int_counters                  = true;
+TRBT_TEST_FLAG test_int_stats                     = true;
+TRBT_TEST_FLAG test_int_record                    = true;
+TRBT_TEST_FLAG test_int_freeze                    = true;
+TRBT_TEST_FLAG test_int_freeze_policies           = true;
+TRBT_TEST_FLAG test_int_save_load                 = true;
+TRBT_TEST_FLAG test_int_freeze_btree              = true;
+TRBT_TEST_FLAG test_int_snapshot                  = true;
+TRBT_TEST_FLAG test_int_snapshot_policies         = true;
 
 /* std::string */
 TRBT_TEST_FLAG test_string_copy_ctor              = true;
@@ -55,6 +80,8 @@ TRBT_TEST_FLAG test_string_find                   = true;
 TRBT_TEST_FLAG test_string_swap                   = true;
 TRBT_TEST_FLAG test_string_lower_bound            = true;
 TRBT_TEST_FLAG test_string_upper_bound            = true;
+TRBT_TEST_FLAG test_string_equal_range            = true;
+TRBT_TEST_FLAG test_string_extract_value          = true;
 TRBT_TEST_FLAG test_string_insert                 = true;
 TRBT_TEST_FLAG test_string_insert_range           = true;
 TRBT_TEST_FLAG test_string_hinted_insert          = true;
@@ -68,6 +95,10 @@ TRBT_TEST_FLAG test_string_less                   = true;
 TRBT_TEST_FLAG test_string_greater_or_eq          = true;
 TRBT_TEST_FLAG test_string_less_or_eq             = true;
 TRBT_TEST_FLAG test_string_iters                  = true;
+TRBT_TEST_FLAG test_string_for_each               = true;
+TRBT_TEST_FLAG test_string_freeze                 = true;
+TRBT_TEST_FLAG test_string_save_load              = true;
+TRBT_TEST_FLAG test_string_stats                  = true;
 
 /* std::pair<int, double> */
 TRBT_TEST_FLAG test_pair_copy_ctor                = true;
@@ -96,6 +127,8 @@ TRBT_TEST_FLAG test_pair_less                     = true;
 TRBT_TEST_FLAG test_pair_greater_or_eq            = true;
 TRBT_TEST_FLAG test_pair_less_or_eq               = true;
 TRBT_TEST_FLAG test_pair_iters                    = true;
+TRBT_TEST_FLAG test_pair_freeze                   = true;
+TRBT_TEST_FLAG test_pair_save_load                = true;
 
 /* std::pair<int, double>, piecewise */
 TRBT_TEST_FLAG test_pair_piecewise_emplace        = true;
@@ -1,12 +1,26 @@
 #include "trbt_test_framework.h"
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 
 
 namespace trbt {
 namespace test {
+    namespace {
+        thread_local std::mt19937 engine{std::random_device{}()};
+        std::atomic<bool> headings{true};
+    }
+
+    std::mt19937& rng() {
+        return engine;
+    }
+
+    void seed_rng(std::uint64_t seed) {
+        engine.seed(static_cast<std::mt19937::result_type>(seed));
+    }
+
     std::vector<int> generate_int_vec(std::size_t size) {
-        std::mt19937 mt{std::random_device{}()};
+        auto& mt = rng();
         std::vector<int> vals(size);
         std::uniform_int_distribution<> dis(-10 * size, 10 * size);
         std::generate(std::begin(vals), std::end(vals), [&dis, &mt]() {
@@ -19,7 +33,7 @@ namespace test {
     }
     
     std::vector<std::string> generate_string_vec(std::size_t size) {
-        std::mt19937 mt{std::random_device{}()};
+        auto& mt = rng();
         std::uniform_real_distribution<> dis(0.0, 1.0);
         auto int_vec = generate_int_vec(size);
         std::vector<std::string> vals(int_vec.size());
@@ -57,6 +71,8 @@ namespace test {
     }
 
     void print_heading(std::string const& method, std::size_t test_size, std::size_t current_iter, std::size_t iterations) {
+        if(!headings.load(std::memory_order_relaxed))
+            return;
         std::string first_line = "Running " + method + " test";
         std::cout << std::setfill('=') << std::setw(first_line.size()) << "" << "\n"
                   << first_line << "\nTest size: " << test_size 
@@ -65,5 +81,15 @@ namespace test {
                   << std::setfill(' ');
     }
     
+    void set_print_headings(bool enabled) {
+        headings.store(enabled);
+    }
+
+    bool check_due(std::size_t step, std::size_t size) noexcept {
+        if(size <= trbt_max_test_size)
+            return true;
+        return step % (size * size / (trbt_max_test_size * trbt_max_test_size)) == 0u;
+    }
+
 } /* namespace test */
 } /* namespace tree */
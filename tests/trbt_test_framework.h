@@ -4,12 +4,28 @@
 #define TRBT_DEBUG
 #pragma once
 #include "trbt.h"
+#include "trbt_btree.h"
+#include "trbt_interval.h"
+#include "trbt_mapped.h"
+#include "trbt_parallel.h"
+#include "trbt_record.h"
 #include "trbt_trace_type.h"
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <numeric>
 #include <random>
+#include <set>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -58,6 +74,18 @@ namespace impl {
     struct ordering_exception : std::runtime_error {
         using std::runtime_error::runtime_error;
     };
+
+    struct comparison_exception : std::runtime_error {
+        using std::runtime_error::runtime_error;
+    };
+
+    struct aggregate_exception : std::runtime_error {
+        using std::runtime_error::runtime_error;
+    };
+
+    struct duplicate_exception : std::runtime_error {
+        using std::runtime_error::runtime_error;
+    };
 }
 
 namespace test {
@@ -100,6 +128,9 @@ namespace test {
     template <typename Tree, typename Vec>
     void upper_bound(Tree& tree, Vec& vals);
 
+    template <typename Tree, typename Vec>
+    void equal_range(Tree& tree, Vec& vals);
+
     template <typename Tree>
     void leftmost(Tree const& tree);
 
@@ -151,12 +182,121 @@ namespace test {
     template <typename Tree, typename Vec>
     void iters(Tree& tree, Vec& vals);
 
+    template <typename Tree, typename Vec>
+    void for_each(Tree& tree, Vec& vals);
+
+    template <typename Vec>
+    void split_ranges(Vec& vals);
+
+    template <typename Vec>
+    void reduce(Vec& vals);
+
+    template <typename Vec>
+    void augment(Vec& vals);
+
+    template <typename Vec>
+    void interval(Vec const& vals);
+
+    template <typename Vec>
+    void duplicates(Vec const& vals);
+
+    template <typename Vec, typename StringConverter>
+    void extract_value(Vec& vals, StringConverter sc);
+
+    template <typename Vec>
+    void priority_queue(Vec const& vals);
+
+    template <typename Vec>
+    void move_only(Vec const& vals);
+
+    template <typename Vec>
+    void three_way(Vec const& vals);
+
+    template <typename Tree, typename Vec, typename StringConverter>
+    void freeze(Tree& tree, Vec& vals, StringConverter sc);
+
+    template <typename Vec>
+    void freeze_policies(Vec const& vals);
+
+    template <typename Vec>
+    void freeze_btree(Vec const& vals);
+
+    template <typename Vec>
+    void snapshot(Vec const& vals);
+
+    template <typename Vec>
+    void snapshot_policies(Vec const& vals);
+
+    template <typename Tree, typename Vec, typename StringConverter>
+    void save_load(Tree& tree, Vec& vals, StringConverter sc);
+
+    template <typename Vec>
+    void counters(Vec& vals);
+
+    template <typename Tree, typename Vec>
+    void stats(Tree& tree, Vec& vals);
+
+    template <typename Vec>
+    void record(Vec const& vals);
+
+    /* Comparator counting calls to its two-way and three-way comparison functions */
+    struct three_way_int_compare {
+        bool operator()(int left, int right) const {
+            ++two_way_calls;
+            return left < right;
+        }
+
+        int three_way(int left, int right) const {
+            ++three_way_calls;
+            return (left > right) - (left < right);
+        }
+
+        static inline thread_local std::size_t two_way_calls{};
+        static inline thread_local std::size_t three_way_calls{};
+    };
+
+    /* Move-only value keyed by id, owning a payload that may be replaced in place */
+    struct handle {
+        int id{};
+        std::unique_ptr<int> payload{};
+    };
+
+    struct handle_id {
+        int const& operator()(handle const& h) const noexcept {
+            return h.id;
+        }
+    };
+
+    /* As above, with a key that cannot be written through iterators */
+    struct const_handle {
+        int const id{};
+        std::unique_ptr<int> payload{};
+    };
+
+    struct const_handle_id {
+        int const& operator()(const_handle const& h) const noexcept {
+            return h.id;
+        }
+    };
+
+    /* Random engine used by the tests, one per thread */
+    std::mt19937& rng();
+    void seed_rng(std::uint64_t seed);
+
     std::vector<int> generate_int_vec(std::size_t size);
     std::vector<std::string> generate_string_vec(std::size_t size);
     std::vector<std::pair<int, double>> generate_pair_vec(std::size_t size);
 
     void print_heading(std::string const& method, std::size_t test_size = 1u, 
             std::size_t current_iter = 0u, std::size_t total_iters = 1u);
+    /* Headings are disabled when tests run on several threads */
+    void set_print_headings(bool enabled);
+
+    /* Whether the linear checks following step of a test on size values are
+     * run. Up to trbt_max_test_size values every step is checked. Larger tests
+     * (see --max-size) check evenly spaced steps, few enough that the checks
+     * take no longer than those of a test on trbt_max_test_size values */
+    bool check_due(std::size_t step, std::size_t size) noexcept;
 
     /* Definitions */
 
@@ -321,7 +461,7 @@ namespace test {
     template <typename Tree, typename Vec, typename StringConverter>
     void find(Tree& tree, Vec& vals, StringConverter sc) {
         using namespace trbt::impl;
-        std::mt19937 mt{std::random_device{}()};
+        auto& mt = rng();
         tree.clear();
         tree.insert(std::begin(vals), std::end(vals));
 
@@ -368,7 +508,11 @@ namespace test {
     void lower_bound(Tree& tree, Vec& vals) {
         using namespace trbt::impl;
         using compare = typename Tree::key_compare;
-        for(auto const& v : vals) {
+        for(std::size_t i = 0u; i < vals.size(); i++) {
+            if(!check_due(i, vals.size()))
+                continue;
+
+            auto const& v = vals[i];
             auto it = tree.lower_bound(v);
 
             for(auto tree_it = std::begin(tree); tree_it != std::end(tree); ++tree_it) {
@@ -385,7 +529,11 @@ namespace test {
     void upper_bound(Tree& tree, Vec& vals) {
         using namespace trbt::impl;
         using compare = typename Tree::key_compare;
-        for(auto const& v : vals) {
+        for(std::size_t i = 0u; i < vals.size(); i++) {
+            if(!check_due(i, vals.size()))
+                continue;
+
+            auto const& v = vals[i];
             auto it = tree.upper_bound(v);
 
             for(auto tree_it = std::begin(tree); tree_it != std::end(tree); ++tree_it) {
@@ -397,6 +545,22 @@ namespace test {
             }
         }
     }
+
+    template <typename Tree, typename Vec>
+    void equal_range(Tree& tree, Vec& vals) {
+        using namespace trbt::impl;
+        auto const check = [&tree](auto const& v) {
+            auto [first, last] = tree.equal_range(v);
+            if(first != tree.lower_bound(v) || last != tree.upper_bound(v))
+                throw value_retention_exception{"Equal range doesn't match lower and upper bound"};
+        };
+
+        /* Both values absent from the tree and values in it */
+        for(auto const& v : vals)
+            check(v);
+        for(auto const& v : tree)
+            check(v);
+    }
         
 
     template <typename Tree>
@@ -446,9 +610,11 @@ namespace test {
         using namespace trbt::impl;
         tree.clear();
 
-        for(auto const& v : vals) {
+        for(std::size_t i = 0u; i < vals.size(); i++) {
+            auto const& v = vals[i];
             trace_insert_if_available(tree, v, TRACE_CALL_RESOLVER);
-            tree.assert_properties_ok(sc);
+            if(check_due(i, vals.size()))
+                tree.assert_properties_ok(sc);
             leftmost(tree);
             rightmost(tree);
         }
@@ -478,15 +644,31 @@ namespace test {
     template <typename Tree, typename T, typename StringConverter>
     void hinted_insert(Tree& tree, std::vector<T> const& vals, StringConverter sc) {
         using namespace trbt::impl;
+        auto& mt = rng();
         tree.clear();
 
-        for(auto const& v : vals) {
+        /* Insert in random order so that hints land on nodes of any color and shape */
+        std::vector<T> shuffled(vals);
+        std::shuffle(std::begin(shuffled), std::end(shuffled), mt);
+
+        for(std::size_t i = 0u; i < shuffled.size(); i++) {
+            auto const& v = shuffled[i];
             auto it = tree.upper_bound(v);
-            trace_insert_if_available(tree, it, v, TRACE_CALL_RESOLVER);
-            tree.assert_properties_ok(sc);
+            auto ins = trace_insert_if_available(tree, it, v, TRACE_CALL_RESOLVER);
+            if(ins == std::end(tree) || !equals<typename Tree::key_compare>(*ins, v))
+                throw value_retention_exception{"Hinted insert returned wrong iterator\n"};
+            if(check_due(i, vals.size()))
+                tree.assert_properties_ok(sc);
             leftmost(tree);
             rightmost(tree);
         }
+        
+        /* Incorrect hints must still result in a valid tree */
+        for(std::size_t i = 0u; i < vals.size(); i++) {
+            trace_insert_if_available(tree, std::begin(tree), vals[i], TRACE_CALL_RESOLVER);
+            if(check_due(i, vals.size()))
+                tree.assert_properties_ok(sc);
+        }
         if(tree.size() != vals.size()) {
             throw value_retention_exception{"Sizes differ. Tree: " + 
                     std::to_string(tree.size()) + " Vec: " + std::to_string(vals.size()) +
@@ -499,9 +681,11 @@ namespace test {
         using namespace trbt::impl;
         tree.clear();
 
-        for(auto const& v : vals) {
+        for(std::size_t i = 0u; i < vals.size(); i++) {
+            auto const& v = vals[i];
             trace_emplace_if_available(tree, TRACE_CALL_RESOLVER, v);
-            tree.assert_properties_ok(sc);
+            if(check_due(i, vals.size()))
+                tree.assert_properties_ok(sc);
             leftmost(tree);
             rightmost(tree);
         }
@@ -517,10 +701,12 @@ namespace test {
         using namespace trbt::impl;
         tree.clear();
 
-        for(auto const& v : vals) {
+        for(std::size_t i = 0u; i < vals.size(); i++) {
+            auto const& v = vals[i];
             auto it = tree.upper_bound(v);
             trace_emplace_hint_if_available(tree, TRACE_CALL_RESOLVER, it, v);
-            tree.assert_properties_ok(sc);
+            if(check_due(i, vals.size()))
+                tree.assert_properties_ok(sc);
             leftmost(tree);
             rightmost(tree);
         }
@@ -536,9 +722,11 @@ namespace test {
         using namespace trbt::impl;
         tree.clear();
 
-        for(auto const& v : vals) {
+        for(std::size_t i = 0u; i < vals.size(); i++) {
+            auto const& v = vals[i];
             trace_emplace_if_available(tree, TRACE_CALL_RESOLVER, v, double{});
-            tree.assert_properties_ok(sc);
+            if(check_due(i, vals.size()))
+                tree.assert_properties_ok(sc);
             leftmost(tree);
             rightmost(tree);
         }
@@ -554,11 +742,13 @@ namespace test {
         using namespace trbt::impl;
         tree.clear();
 
-        for(auto const& v : vals) {
+        for(std::size_t i = 0u; i < vals.size(); i++) {
+            auto const& v = vals[i];
             std::pair<int, double> p{v, double{}};
             auto it = tree.upper_bound(p);
             trace_emplace_hint_if_available(tree, TRACE_CALL_RESOLVER, it, v, double{});
-            tree.assert_properties_ok(sc);
+            if(check_due(i, vals.size()))
+                tree.assert_properties_ok(sc);
             leftmost(tree);
             rightmost(tree);
         }
@@ -572,8 +762,9 @@ namespace test {
     template <typename Tree, typename Vec, typename StringConverter>
     void erase(Tree& tree, Vec& vals, StringConverter sc) {
         using namespace trbt::impl;
-        std::mt19937 mt{std::random_device{}()};
+        auto& mt = rng();
         std::shuffle(std::begin(vals), std::end(vals), mt);
+        auto const size = vals.size();
         
         for(int i = vals.size() - 1; i >= 0; --i) {
             if(!trace_erase_if_available(tree, vals[i], TRACE_CALL_RESOLVER))
@@ -582,12 +773,13 @@ namespace test {
                 throw value_retention_exception{"Value still in tree after erasure\n"};
             vals.erase(std::end(vals) - 1, std::end(vals));
             
-            tree.assert_properties_ok(sc);
             leftmost(tree);
             rightmost(tree);
 
-
-            contains(tree, vals, sc);
+            if(check_due(static_cast<std::size_t>(i), size)) {
+                tree.assert_properties_ok(sc);
+                contains(tree, vals, sc);
+            }
         }
 
     }
@@ -908,6 +1100,8 @@ namespace test {
         }
         static_assert(!is_assignable_v<decltype(*std::declval<c_iter>())>);
         static_assert(!is_assignable_v<decltype(*std::declval<cr_iter>())>);
+        static_assert(sizeof(iter) == sizeof(void*) && sizeof(cr_iter) == sizeof(void*),
+                      "Iterators should only hold a node pointer");
 
         auto not_equal = [](auto const& left, auto const& right) {
             if constexpr(is_pair) 
@@ -974,6 +1168,28 @@ namespace test {
             if(vec_it != std::crend(vals))
                 throw iterator_exception{"Vec reverse iterator is not end\n"};
         }
+        {
+            /* Walk backward from end and forward from rend */
+            auto tree_it = std::end(tree);
+            auto vec_it  = std::end(vals);
+            while(vec_it != std::begin(vals)) {
+                if(tree_it == std::begin(tree))
+                    throw iterator_exception{"Decrementing iterator reached begin early\n"};
+                if(not_equal(*--tree_it, *--vec_it))
+                    throw iterator_exception{"Decrementing iterator yields different values\n"};
+            }
+            if(tree_it != std::begin(tree))
+                throw iterator_exception{"Decrementing iterator did not reach begin\n"};
+
+            auto rtree_it = std::crend(tree);
+            auto rvec_it  = std::crend(vals);
+            while(rvec_it != std::crbegin(vals)) {
+                if(not_equal(*--rtree_it, *--rvec_it))
+                    throw iterator_exception{"Decrementing reverse iterator yields different values\n"};
+            }
+            if(rtree_it != std::crbegin(tree))
+                throw iterator_exception{"Decrementing reverse iterator did not reach rbegin\n"};
+        }
         auto it = std::begin(vals);
         for(auto const& v : tree) {
             if(not_equal(v, *it++))
@@ -1012,6 +1228,1466 @@ namespace test {
         if(std::crbegin(tree) != std::crend(tree))
             throw iterator_exception{"crbegin doesn't equal crend after erasing all values\n"};
     }
+
+    template <typename Tree, typename Vec, typename StringConverter>
+    void freeze(Tree& tree, Vec& vals, StringConverter sc) {
+        using namespace trbt::impl;
+        using compare = typename Tree::key_compare;
+        auto& mt = rng();
+
+        tree.clear();
+        tree.insert(std::begin(vals), std::end(vals));
+
+        auto frozen = tree.freeze();
+
+        if(frozen.size() != tree.size())
+            throw value_retention_exception{"Frozen tree size differs from original\n"};
+        if(!std::equal(std::begin(frozen), std::end(frozen), std::begin(tree), std::end(tree), 
+                       equals<compare, typename Tree::value_type, typename Tree::value_type>))
+            throw iterator_exception{"Frozen tree iteration yields different values\n"};
+        if(!std::equal(std::rbegin(frozen), std::rend(frozen), std::rbegin(tree), std::rend(tree), 
+                       equals<compare, typename Tree::value_type, typename Tree::value_type>))
+            throw iterator_exception{"Frozen tree reverse iteration yields different values\n"};
+
+        auto same_position = [&](auto frozen_it, auto tree_it) {
+            if(frozen_it == std::end(frozen) || tree_it == std::end(tree))
+                return frozen_it == std::end(frozen) && tree_it == std::end(tree);
+            return equals<compare>(*frozen_it, *tree_it);
+        };
+
+        for(auto const& v : vals) {
+            auto it = frozen.find(v);
+            if(it == std::end(frozen) || !equals<compare>(*it, v))
+                throw value_retention_exception{sc(v) + " not found in frozen tree\n"};
+            if(!frozen.contains(v) || frozen.count(v) != 1u)
+                throw value_retention_exception{sc(v) + " not contained in frozen tree\n"};
+        }
+
+        std::shuffle(std::begin(vals), std::end(vals), mt);
+        
+        /* Frozen tree is a snapshot and must not be affected by changes to the original */
+        for(auto i = 0u; i < vals.size() / 2; i++)
+            tree.erase(vals[i]);
+
+        for(auto i = 0u; i < vals.size(); i++) {
+            if(!frozen.contains(vals[i]))
+                throw value_retention_exception{sc(vals[i]) + " missing from frozen tree after erasure from original\n"};
+        }
+
+        frozen = tree.freeze();
+
+        for(auto i = 0u; i < vals.size(); i++) {
+            if(!same_position(frozen.find(vals[i]), tree.find(vals[i])))
+                throw value_retention_exception{"Find yields different results for " + sc(vals[i]) + "\n"};
+            if(!same_position(frozen.lower_bound(vals[i]), tree.lower_bound(vals[i])))
+                throw value_retention_exception{"Lower bound yields different results for " + sc(vals[i]) + "\n"};
+            if(!same_position(frozen.upper_bound(vals[i]), tree.upper_bound(vals[i])))
+                throw value_retention_exception{"Upper bound yields different results for " + sc(vals[i]) + "\n"};
+            auto const [first, last] = frozen.equal_range(vals[i]);
+            auto const [tree_first, tree_last] = tree.equal_range(vals[i]);
+            if(!same_position(first, tree_first) || !same_position(last, tree_last))
+                throw value_retention_exception{"Equal range yields different results for " + sc(vals[i]) + "\n"};
+        }
+    }
+
+    template <typename Vec>
+    void freeze_policies(Vec const& vals) {
+        using namespace trbt::impl;
+        auto& mt = rng();
+
+        /* Equal values keep their count and order */
+        rbtree<int, std::less<int>, std::allocator<int>, trbt::allow_duplicates> multi;
+        std::multiset<int> oracle;
+        std::uniform_int_distribution<int> copies_dis(1, 3);
+        for(auto v : vals) {
+            for(int copies = copies_dis(mt); copies; copies--) {
+                multi.insert(v);
+                oracle.insert(v);
+            }
+        }
+
+        auto const frozen_multi = multi.freeze();
+        if(!std::equal(std::begin(frozen_multi), std::end(frozen_multi), std::begin(oracle), std::end(oracle)))
+            throw iterator_exception{"Frozen tree with duplicates yields different values\n"};
+        for(auto v : vals) {
+            auto const [first, last] = frozen_multi.equal_range(v);
+            auto const [oracle_first, oracle_last] = oracle.equal_range(v);
+            if(!std::equal(first, last, oracle_first, oracle_last) || frozen_multi.find(v) != first)
+                throw value_retention_exception{"Equal range of " + std::to_string(v) + " in frozen tree is wrong\n"};
+            if(frozen_multi.count(v) != oracle.count(v))
+                throw value_retention_exception{"Count of " + std::to_string(v) + " in frozen tree is wrong\n"};
+        }
+
+        /* Projected keys are looked up on their own */
+        struct record {
+            int id;
+            int payload;
+        };
+        struct record_id {
+            int operator()(record const& r) const noexcept {
+                return r.id;
+            }
+        };
+        rbtree<record, std::less<int>, std::allocator<record>, trbt::key_projection<record_id>> projected;
+        for(auto v : vals)
+            projected.insert(record{v, -v});
+
+        auto const frozen_projected = projected.freeze();
+        for(auto v : vals) {
+            auto it = frozen_projected.find(v);
+            if(it == std::end(frozen_projected) || it->id != v || it->payload != -v || !frozen_projected.contains(v))
+                throw value_retention_exception{std::to_string(v) + " not found by key in frozen tree\n"};
+        }
+
+        /* Mapped values need not be default constructible to be looked up */
+        struct no_default {
+            explicit no_default(int v) : value{v} { }
+            int value;
+        };
+        rbtree<std::pair<int, no_default>> map;
+        for(auto v : vals)
+            map.insert(std::pair{v, no_default{-v}});
+
+        auto const frozen_map = map.freeze();
+        for(auto v : vals) {
+            if(frozen_map.at(v).value != -v || !frozen_map.contains(v))
+                throw value_retention_exception{std::to_string(v) + " not mapped correctly in frozen map\n"};
+        }
+    }
+
+    template <typename Key, typename Vec>
+    void freeze_btree_as(Vec const& vals) {
+        using namespace trbt::impl;
+        rbtree<Key> tree;
+        for(auto v : vals)
+            tree.insert(static_cast<Key>(v));
+
+        auto frozen = trbt::freeze_btree(tree);
+
+        if(frozen.size() != tree.size())
+            throw value_retention_exception{"Frozen B-tree size differs from original\n"};
+        if(!std::equal(std::begin(frozen), std::end(frozen), std::begin(tree), std::end(tree)))
+            throw iterator_exception{"Frozen B-tree iteration yields different values\n"};
+        if(!std::equal(std::rbegin(frozen), std::rend(frozen), std::rbegin(tree), std::rend(tree)))
+            throw iterator_exception{"Frozen B-tree reverse iteration yields different values\n"};
+
+        auto same_position = [&](auto frozen_it, auto tree_it) {
+            if(frozen_it == std::end(frozen) || tree_it == std::end(tree))
+                return frozen_it == std::end(frozen) && tree_it == std::end(tree);
+            return *frozen_it == *tree_it;
+        };
+
+        std::vector<Key> queries{std::numeric_limits<Key>::lowest(), std::numeric_limits<Key>::max()};
+        for(auto v : vals) {
+            queries.push_back(static_cast<Key>(v) - 1);
+            queries.push_back(static_cast<Key>(v));
+            queries.push_back(static_cast<Key>(v) + 1);
+        }
+        if constexpr(std::is_floating_point_v<Key>) {
+            queries.push_back(std::numeric_limits<Key>::infinity());
+            queries.push_back(-std::numeric_limits<Key>::infinity());
+            for(auto v : vals)
+                queries.push_back(static_cast<Key>(v) + Key{0.5});
+        }
+
+        for(auto q : queries) {
+            if(!same_position(frozen.find(q), tree.find(q)))
+                throw value_retention_exception{"B-tree find yields different results for " + std::to_string(q) + "\n"};
+            if(!same_position(frozen.lower_bound(q), tree.lower_bound(q)))
+                throw value_retention_exception{"B-tree lower bound yields different results for " + std::to_string(q) + "\n"};
+            if(!same_position(frozen.upper_bound(q), tree.upper_bound(q)))
+                throw value_retention_exception{"B-tree upper bound yields different results for " + std::to_string(q) + "\n"};
+            if(frozen.contains(q) != tree.contains(q))
+                throw value_retention_exception{"B-tree contains yields different results for " + std::to_string(q) + "\n"};
+        }
+
+        auto cpy{frozen};
+        if(!std::equal(std::begin(cpy), std::end(cpy), std::begin(tree), std::end(tree)))
+            throw iterator_exception{"Copy of frozen B-tree yields different values\n"};
+
+        /* Runs of equal keys are counted in full */
+        rbtree<Key, std::less<Key>, std::allocator<Key>, trbt::allow_duplicates> multi;
+        for(auto v : vals) {
+            for(int copies = 1 + (v & 3); copies; copies--)
+                multi.insert(static_cast<Key>(v));
+        }
+
+        auto const frozen_multi = trbt::freeze_btree(multi);
+        if(!std::equal(std::begin(frozen_multi), std::end(frozen_multi), std::begin(multi), std::end(multi)))
+            throw iterator_exception{"Frozen B-tree with duplicates yields different values\n"};
+        for(auto q : queries) {
+            auto const [first, last] = frozen_multi.equal_range(q);
+            if(frozen_multi.count(q) != multi.count(q) || static_cast<std::size_t>(last - first) != multi.count(q) ||
+               std::any_of(first, last, [q](Key k) { return k != q; }))
+                throw value_retention_exception{"B-tree equal range yields different results for " + std::to_string(q) + "\n"};
+        }
+    }
+
+    template <typename Vec>
+    void freeze_btree(Vec const& vals) {
+        freeze_btree_as<std::int32_t>(vals);
+        freeze_btree_as<std::int64_t>(vals);
+        freeze_btree_as<double>(vals);
+    }
+
+    template <typename Vec>
+    void snapshot(Vec const& vals) {
+        using namespace trbt::impl;
+        /* Verification walks the node layout without allocating */
+        auto const visit = [](std::uint64_t, std::int64_t, std::int64_t) noexcept { return true; };
+        static_assert(noexcept(for_each_snapshot_node(std::uint64_t{}, visit)));
+
+        auto const path = (std::filesystem::temp_directory_path() / 
+                           ("trbt_snapshot_" + std::to_string(std::random_device{}()))).string();
+
+        auto corrupt = [&path](std::streamoff offset) {
+            std::fstream fs{path, std::ios::binary | std::ios::in | std::ios::out};
+            fs.seekg(offset);
+            char c = static_cast<char>(fs.get());
+            fs.seekp(offset);
+            fs.put(static_cast<char>(c ^ 0x5a));
+        };
+
+        rbtree<int> tree(std::begin(vals), std::end(vals));
+        write_snapshot(tree, path);
+
+        {
+            mapped_rbtree<int> mapped{path};
+
+            if(mapped.size() != tree.size())
+                throw value_retention_exception{"Mapped tree size differs from original\n"};
+            if(!mapped.verify())
+                throw value_retention_exception{"Freshly written snapshot fails verification\n"};
+            if(!std::equal(std::begin(mapped), std::end(mapped), std::begin(tree), std::end(tree)))
+                throw iterator_exception{"Mapped tree iteration yields different values\n"};
+            if(!std::equal(std::rbegin(mapped), std::rend(mapped), std::rbegin(tree), std::rend(tree)))
+                throw iterator_exception{"Mapped tree reverse iteration yields different values\n"};
+
+            auto same_position = [&](auto mapped_it, auto tree_it) {
+                if(mapped_it == std::end(mapped) || tree_it == std::end(tree))
+                    return mapped_it == std::end(mapped) && tree_it == std::end(tree);
+                return *mapped_it == *tree_it;
+            };
+
+            for(auto v : vals) {
+                for(auto q : {v - 1, v, v + 1}) {
+                    if(!same_position(mapped.find(q), tree.find(q)))
+                        throw value_retention_exception{"Mapped find yields different results for " + std::to_string(q) + "\n"};
+                    if(!same_position(mapped.lower_bound(q), tree.lower_bound(q)))
+                        throw value_retention_exception{"Mapped lower bound yields different results for " + std::to_string(q) + "\n"};
+                    if(!same_position(mapped.upper_bound(q), tree.upper_bound(q)))
+                        throw value_retention_exception{"Mapped upper bound yields different results for " + std::to_string(q) + "\n"};
+                }
+            }
+
+            bool thrown = false;
+            try {
+                mapped_rbtree<long long> wrong_type{path};
+            }
+            catch(snapshot_error const&) {
+                thrown = true;
+            }
+            if(!thrown)
+                throw value_retention_exception{"Snapshot opened with a different value type\n"};
+        }
+
+        /* Corrupt a byte in the last value */
+        corrupt(static_cast<std::streamoff>(std::filesystem::file_size(path)) - 1);
+        if(mapped_rbtree<int>{path}.verify())
+            throw value_retention_exception{"Corrupted snapshot passes verification\n"};
+
+        corrupt(0);
+        bool thrown = false;
+        try {
+            mapped_rbtree<int> mapped{path};
+        }
+        catch(snapshot_error const&) {
+            thrown = true;
+        }
+        if(!thrown)
+            throw value_retention_exception{"Snapshot with invalid magic number opened\n"};
+
+        std::filesystem::remove(path);
+    }
+
+    template <typename Vec>
+    void snapshot_policies(Vec const& vals) {
+        using namespace trbt::impl;
+        auto const path = (std::filesystem::temp_directory_path() / 
+                           ("trbt_snapshot_policies_" + std::to_string(std::random_device{}()))).string();
+
+        auto opens = [&path](auto type_tag) {
+            try {
+                typename decltype(type_tag)::type mapped{path};
+            }
+            catch(snapshot_error const&) {
+                return false;
+            }
+            return true;
+        };
+
+        /* Runs of equal values are counted in full and found from their first value */
+        using multi_type = rbtree<int, std::less<int>, std::allocator<int>, trbt::allow_duplicates>;
+        using mapped_multi_type = mapped_rbtree<int, std::less<int>, trbt::allow_duplicates>;
+        multi_type multi;
+        for(auto v : vals) {
+            for(int copies = 1 + (v & 3); copies; copies--)
+                multi.insert(v);
+        }
+        write_snapshot(multi, path);
+
+        {
+            mapped_multi_type mapped{path};
+            if(mapped.size() != multi.size() || !mapped.verify() ||
+               !std::equal(std::begin(mapped), std::end(mapped), std::begin(multi), std::end(multi)))
+                throw value_retention_exception{"Mapped tree with duplicates differs from original\n"};
+
+            for(auto v : vals) {
+                for(auto q : {v - 1, v, v + 1}) {
+                    auto const [first, last] = mapped.equal_range(q);
+                    auto const expected = multi.count(q);
+                    if(mapped.count(q) != expected || static_cast<std::size_t>(std::distance(first, last)) != expected)
+                        throw value_retention_exception{"Mapped tree counts " + std::to_string(q) + " wrongly\n"};
+                    if(mapped.find(q) != (expected ? first : std::end(mapped)) || mapped.contains(q) != (expected != 0u))
+                        throw value_retention_exception{"Mapped find does not return the first " + std::to_string(q) + "\n"};
+                }
+            }
+        }
+
+        /* The policies are recorded in the snapshot */
+        if(opens(type_is<mapped_rbtree<int>>{}))
+            throw value_retention_exception{"Snapshot with duplicates opened without the policy\n"};
+        write_snapshot(rbtree<int>(std::begin(vals), std::end(vals)), path);
+        if(opens(type_is<mapped_multi_type>{}))
+            throw value_retention_exception{"Snapshot without duplicates opened with the policy\n"};
+
+        /* Projected keys are looked up on their own */
+        struct record {
+            int id;
+            int payload;
+        };
+        struct record_id {
+            int operator()(record const& r) const noexcept {
+                return r.id;
+            }
+        };
+        struct record_less {
+            bool operator()(record const& l, record const& r) const noexcept {
+                return l.id < r.id;
+            }
+        };
+        using mapped_projected_type = mapped_rbtree<record, std::less<int>, trbt::key_projection<record_id>>;
+        rbtree<record, std::less<int>, std::allocator<record>, trbt::key_projection<record_id>> projected;
+        for(auto v : vals)
+            projected.insert(record{v, -v});
+        write_snapshot(projected, path);
+
+        {
+            mapped_projected_type mapped{path};
+            for(auto v : vals) {
+                auto it = mapped.find(v);
+                if(it == std::end(mapped) || it->id != v || it->payload != -v || !mapped.contains(v) || mapped.count(record{v, 0}) != 1u)
+                    throw value_retention_exception{std::to_string(v) + " not found by key in mapped tree\n"};
+                if(mapped.contains(v + 1) != projected.contains(v + 1))
+                    throw value_retention_exception{std::to_string(v + 1) + " found by key in mapped tree\n"};
+            }
+        }
+        if(opens(type_is<mapped_rbtree<record, record_less>>{}))
+            throw value_retention_exception{"Snapshot with projected keys opened without the policy\n"};
+
+        std::filesystem::remove(path);
+    }
+
+    template <typename Tree, typename Vec, typename StringConverter>
+    void save_load(Tree& tree, Vec& vals, StringConverter sc) {
+        using namespace trbt::impl;
+        using compare = typename Tree::key_compare;
+        auto& mt = rng();
+
+        std::shuffle(std::begin(vals), std::end(vals), mt);
+        tree.clear();
+        tree.insert(std::begin(vals), std::end(vals));
+
+        std::stringstream ss;
+        tree.save(ss);
+        std::string const bytes = ss.str();
+
+        /* Loading replaces any previous contents */
+        Tree loaded;
+        loaded.insert(vals[0]);
+        loaded.load(ss);
+
+        loaded.assert_properties_ok(sc);
+        leftmost(loaded);
+        rightmost(loaded);
+
+        if(loaded.size() != tree.size())
+            throw value_retention_exception{"Loaded tree size differs from original\n"};
+        if(!std::equal(std::begin(loaded), std::end(loaded), std::begin(tree), std::end(tree), 
+                       equals<compare, typename Tree::value_type, typename Tree::value_type>))
+            throw iterator_exception{"Loaded tree iteration yields different values\n"};
+        if(!std::equal(std::rbegin(loaded), std::rend(loaded), std::rbegin(tree), std::rend(tree), 
+                       equals<compare, typename Tree::value_type, typename Tree::value_type>))
+            throw iterator_exception{"Loaded tree reverse iteration yields different values\n"};
+
+        /* Loaded tree must remain balanced under modification */
+        for(auto i = 0u; i < vals.size() / 2; i++) {
+            if(loaded.erase(vals[i]) != 1u)
+                throw value_retention_exception{sc(vals[i]) + " could not be erased from loaded tree\n"};
+            if(check_due(i, vals.size()))
+                loaded.assert_properties_ok(sc);
+        }
+        for(auto i = 0u; i < vals.size() / 2; i++) {
+            loaded.insert(vals[i]);
+            if(check_due(i, vals.size()))
+                loaded.assert_properties_ok(sc);
+        }
+        if(loaded.size() != tree.size())
+            throw value_retention_exception{"Loaded tree size differs from original after reinsertion\n"};
+
+        std::stringstream truncated{bytes.substr(0u, bytes.size() / 2)};
+        bool thrown = false;
+        try {
+            loaded.load(truncated);
+        }
+        catch(std::ios_base::failure const&) {
+            thrown = true;
+        }
+        if(!thrown)
+            throw value_retention_exception{"Loading truncated stream did not fail\n"};
+        if(!loaded.empty() || loaded.size())
+            throw value_retention_exception{"Tree not empty after failed load\n"};
+    }
+
+    template <typename Tree, typename Vec>
+    void stats(Tree& tree, Vec& vals) {
+        using namespace trbt::impl;
+        auto& mt = rng();
+
+        tree.clear();
+        auto st = tree.stats();
+        if(st.size || st.height || st.black_height || !st.depth_histogram.empty() || st.node_bytes)
+            throw value_retention_exception{"Statistics of empty tree not empty\n"};
+
+        std::shuffle(std::begin(vals), std::end(vals), mt);
+        tree.insert(std::begin(vals), std::end(vals));
+        st = tree.stats();
+
+        auto const n = vals.size();
+        if(st.size != n)
+            throw value_retention_exception{"Statistics report wrong size\n"};
+        if(st.red_nodes + st.black_nodes != n)
+            throw value_retention_exception{"Node count per color doesn't add up to size\n"};
+        if(std::accumulate(std::begin(st.depth_histogram), std::end(st.depth_histogram), std::size_t{0}) != n)
+            throw value_retention_exception{"Depth histogram doesn't add up to size\n"};
+        if(st.depth_histogram.size() != st.height || st.depth_histogram[0] != 1u)
+            throw value_retention_exception{"Depth histogram doesn't match height\n"};
+
+        auto const min_height = static_cast<std::size_t>(std::ceil(std::log2(n + 1.0)));
+        auto const max_height = static_cast<std::size_t>(2.0 * std::log2(n + 1.0));
+        if(st.height < min_height || st.height > max_height)
+            throw value_retention_exception{"Height " + std::to_string(st.height) + " out of bounds\n"};
+        if(st.black_height > st.height || 2u * st.black_height < st.height)
+            throw value_retention_exception{"Black height " + std::to_string(st.black_height) + " inconsistent with height\n"};
+
+        /* The external path length exceeds the internal path length by twice the size */
+        double const successful = st.average_successful_depth * n;
+        double const unsuccessful = st.average_unsuccessful_depth * (n + 1u);
+        if(std::abs(unsuccessful - successful - n) > 1e-6 * (unsuccessful + 1.0))
+            throw value_retention_exception{"Average search depths are inconsistent\n"};
+        if(st.average_successful_depth < 1.0 || st.average_successful_depth > st.height)
+            throw value_retention_exception{"Average successful search depth out of bounds\n"};
+
+        if(st.node_bytes != st.sentinel_bytes * n)
+            throw value_retention_exception{"Node bytes don't match size\n"};
+        if(st.value_bytes + st.padding_bytes > st.node_bytes)
+            throw value_retention_exception{"Value and padding bytes exceed node bytes\n"};
+    }
+
+    template <typename Vec>
+    void record(Vec const& vals) {
+        using namespace trbt::impl;
+        auto& mt = rng();
+        std::uniform_int_distribution<int> op_dis(0, 4);
+
+        std::stringstream ss;
+        recording_type<rbtree<std::int32_t>> tree;
+
+        /* Operations before recording starts are not logged */
+        tree.insert(vals[0]);
+        tree.record_to(ss);
+
+        std::vector<trbt::record<std::int32_t>> expected;
+        for(auto v : vals) {
+            auto const op = static_cast<operation>(op_dis(mt));
+            std::uint64_t count = 0u;
+            switch(op) {
+                case operation::Insert:
+                    tree.insert(v);
+                    break;
+                case operation::Erase:
+                    tree.erase(v);
+                    break;
+                case operation::Find:
+                    tree.find(v);
+                    break;
+                case operation::LowerBound:
+                    tree.lower_bound(v);
+                    break;
+                default:
+                    count = v & 0xf;
+                    tree.iterate(v, count, [](int) { });
+                    break;
+            }
+            expected.push_back({op, 0u, count, v});
+        }
+
+        /* Other members changing the tree are logged as the insertions and
+         * erasures they amount to */
+        auto expect_all = [&tree, &expected](operation op) {
+            for(auto v : tree)
+                expected.push_back({op, 0u, 0u, v});
+        };
+
+        std::uniform_int_distribution<int> mutation_dis(0, 5);
+        for(auto v : vals) {
+            switch(mutation_dis(mt)) {
+                case 0:
+                    expected.push_back({operation::Insert, 0u, 0u, *tree.emplace(v).first});
+                    break;
+                case 1:
+                    expected.push_back({operation::Insert, 0u, 0u, *tree.emplace_hint(tree.cend(), v)});
+                    break;
+                case 2:
+                    tree.extract_value(v);
+                    expected.push_back({operation::Erase, 0u, 0u, v});
+                    break;
+                case 3:
+                    if(auto const min = tree.pop_min())
+                        expected.push_back({operation::Erase, 0u, 0u, *min});
+                    break;
+                case 4:
+                    if(auto const max = tree.pop_max())
+                        expected.push_back({operation::Erase, 0u, 0u, *max});
+                    break;
+                default:
+                    for(auto w : tree.pop_min_n(static_cast<std::size_t>(v & 3)))
+                        expected.push_back({operation::Erase, 0u, 0u, w});
+                    break;
+            }
+        }
+
+        std::stringstream saved;
+        rbtree<std::int32_t>(std::begin(vals), std::begin(vals) + vals.size() / 2u).save(saved);
+        expect_all(operation::Erase);
+        tree.load(saved);
+        expect_all(operation::Insert);
+
+        /* Copies do not record, assigning or swapping replaces the values */
+        recording_type<rbtree<std::int32_t>> other{tree};
+        other.insert(vals.back());
+        other.erase(vals.front());
+        expect_all(operation::Erase);
+        tree = other;
+        expect_all(operation::Insert);
+
+        other.clear();
+        expect_all(operation::Erase);
+        swap(tree, other);
+        expect_all(operation::Insert);
+
+        expect_all(operation::Erase);
+        tree.clear();
+
+        tree.stop_recording();
+        tree.find(vals[0]);
+
+        record_reader<std::int32_t> reader{ss};
+        trbt::record<std::int32_t> rec;
+        std::uint64_t timestamp = 0u;
+        for(auto const& exp : expected) {
+            if(!reader.next(rec))
+                throw value_retention_exception{"Workload log ended early\n"};
+            if(rec.op != exp.op || rec.value != exp.value || rec.count != exp.count)
+                throw value_retention_exception{"Record of " + std::to_string(exp.value) + " differs from operation performed\n"};
+            if(rec.timestamp < timestamp)
+                throw value_retention_exception{"Timestamps in workload log decrease\n"};
+            timestamp = rec.timestamp;
+        }
+        if(reader.next(rec))
+            throw value_retention_exception{"Workload log contains operations performed after recording stopped\n"};
+
+        bool thrown = false;
+        try {
+            std::stringstream copy{ss.str()};
+            record_reader<std::int64_t> wrong_type{copy};
+        }
+        catch(std::runtime_error const&) {
+            thrown = true;
+        }
+        if(!thrown)
+            throw value_retention_exception{"Workload log read with a different value type\n"};
+
+        /* Keyed members of maps */
+        using entry = std::pair<std::int32_t, std::int32_t>;
+        std::stringstream map_ss;
+        recording_type<rbtree<entry>> map;
+        map.record_to(map_ss);
+
+        std::vector<trbt::record<entry>> map_expected;
+        for(auto v : vals) {
+            auto const present = map.contains(v);
+            entry const before{v, present ? map.at(v) : 0};
+            auto const op = present ? operation::Find : operation::Insert;
+            switch(v & 3) {
+                case 0:
+                    map[v] += 1;
+                    map_expected.push_back({op, 0u, 0u, before});
+                    break;
+                case 1:
+                    map[std::int32_t{v}] += 2;
+                    map_expected.push_back({op, 0u, 0u, before});
+                    break;
+                default:
+                    if(auto const taken = map.take(v))
+                        map_expected.push_back({operation::Erase, 0u, 0u, *taken});
+                    break;
+            }
+        }
+
+        record_reader<entry> map_reader{map_ss};
+        trbt::record<entry> map_rec;
+        for(auto const& exp : map_expected) {
+            if(!map_reader.next(map_rec))
+                throw value_retention_exception{"Map workload log ended early\n"};
+            if(map_rec.op != exp.op || map_rec.value != exp.value)
+                throw value_retention_exception{"Record of key " + std::to_string(exp.value.first) + " differs from operation performed\n"};
+        }
+        if(map_reader.next(map_rec))
+            throw value_retention_exception{"Map workload log contains operations that were not performed\n"};
+    }
+
+    template <typename Vec>
+    void counters(Vec& vals) {
+        using namespace trbt::impl;
+        using compare = three_way_int_compare;
+        auto& mt = rng();
+
+        std::shuffle(std::begin(vals), std::end(vals), mt);
+
+        /* Trees without the policy hold no counters */
+        using tree_type = rbtree<int, compare, std::allocator<int>, trbt::statistics>;
+        static_assert(sizeof(tree_type) >= sizeof(rbtree<int, compare>) + sizeof(trbt::operation_counters));
+
+        tree_type tree;
+        auto total_calls = []() {
+            return compare::two_way_calls + compare::three_way_calls;
+        };
+
+        compare::two_way_calls = 0u;
+        compare::three_way_calls = 0u;
+
+        for(auto v : vals)
+            tree.insert(v);
+
+        auto c = tree.counters();
+        if(c.comparisons != total_calls())
+            throw value_retention_exception{"Counted " + std::to_string(c.comparisons) + " comparisons, comparator was called " + 
+                                            std::to_string(total_calls()) + " times\n"};
+        /* Sentinel is allocated as well */
+        if(c.allocations - c.deallocations != vals.size() + 1u)
+            throw value_retention_exception{"Allocation count doesn't match number of nodes\n"};
+        if(c.descents != vals.size() - 1u)
+            throw value_retention_exception{"Expected one descent per insertion into non-empty tree\n"};
+        if(vals.size() > 2u && !(c.left_rotations + c.right_rotations))
+            throw value_retention_exception{"No rotations counted\n"};
+
+        /* Height of a red-black tree is at most 2 log2(n + 1) */
+        auto const max_height = static_cast<std::uint64_t>(2.0 * std::log2(vals.size() + 1.0));
+        if(c.max_descent_depth > max_height)
+            throw value_retention_exception{"Descent depth " + std::to_string(c.max_descent_depth) + " exceeds height bound\n"};
+
+        tree.reset_counters();
+        c = tree.counters();
+        if(c.comparisons || c.allocations || c.left_rotations || c.right_rotations || c.descents)
+            throw value_retention_exception{"Counters not reset\n"};
+
+        for(auto v : vals) {
+            tree.find(v);
+            if(tree.counters().last_descent_depth > max_height)
+                throw value_retention_exception{"Descent depth exceeds height bound\n"};
+        }
+        if(tree.counters().descents != vals.size())
+            throw value_retention_exception{"Expected one descent per search\n"};
+
+        tree.reset_counters();
+        for(auto v : vals)
+            tree.erase(v);
+
+        c = tree.counters();
+        if(c.deallocations != vals.size() || c.allocations)
+            throw value_retention_exception{"Deallocation count doesn't match number of erased nodes\n"};
+        if(vals.size() > 2u && !c.remove_recolors)
+            throw value_retention_exception{"No recolors counted during erasure\n"};
+        if(c.comparisons > vals.size() * max_height)
+            throw value_retention_exception{"Erasure used more than one comparison per level\n"};
+
+        /* Correct hints are checked with one three-way comparison against
+         * each neighbour, after which no descent is needed */
+        std::sort(std::begin(vals), std::end(vals));
+        vals.erase(std::unique(std::begin(vals), std::end(vals)), std::end(vals));
+        tree.reset_counters();
+        for(std::size_t i = 0u; i < vals.size(); i += 2u)
+            tree.insert(std::cend(tree), vals[i]);
+
+        c = tree.counters();
+        if(c.descents || c.comparisons > (vals.size() + 1u) / 2u)
+            throw value_retention_exception{"Appending with a hint at the end took " + std::to_string(c.comparisons) + " comparisons\n"};
+
+        for(std::size_t i = 1u; i < vals.size(); i += 2u) {
+            auto hint = i + 1u < vals.size() ? tree.find(vals[i + 1u]) : std::end(tree);
+            auto const before = tree.counters();
+            auto it = tree.insert(hint, vals[i]);
+            c = tree.counters();
+            if(*it != vals[i] || std::next(it) != hint)
+                throw value_retention_exception{"Hinted insertion of " + std::to_string(vals[i]) + " misplaced\n"};
+            if(c.descents != before.descents || c.comparisons - before.comparisons > 2u)
+                throw value_retention_exception{"Hinted insertion with a correct hint took " + 
+                                                std::to_string(c.comparisons - before.comparisons) + " comparisons\n"};
+        }
+        if(tree.size() != vals.size())
+            throw value_retention_exception{"Hinted insertions lost values\n"};
+        tree.assert_properties_ok([](int i) { return std::to_string(i); });
+
+        /* All values equal to one are erased after a single descent */
+        std::size_t constexpr copies = 3u;
+        rbtree<int, compare, std::allocator<int>, trbt::allow_duplicates, trbt::statistics> multi;
+        for(std::size_t i = 0u; i < copies; i++)
+            multi.insert(std::begin(vals), std::end(vals));
+
+        auto const multi_height = static_cast<std::uint64_t>(2.0 * std::log2(multi.size() + 1.0));
+        for(auto v : vals) {
+            auto const before = multi.counters();
+            if(multi.erase(v) != copies)
+                throw value_retention_exception{"Erasure of " + std::to_string(v) + " missed equal values\n"};
+            c = multi.counters();
+            if(c.descents - before.descents != 1u)
+                throw value_retention_exception{"Erasure of equal values took " + std::to_string(c.descents - before.descents) + " descents\n"};
+            if(c.comparisons - before.comparisons > 2u * multi_height)
+                throw value_retention_exception{"Erasure of equal values took " + std::to_string(c.comparisons - before.comparisons) + " comparisons\n"};
+            if(c.deallocations - before.deallocations != copies)
+                throw value_retention_exception{"Erasure of equal values freed the wrong number of nodes\n"};
+        }
+        if(!multi.empty())
+            throw value_retention_exception{"Values left after erasing all of them\n"};
+    }
+
+    template <typename Tree, typename Vec>
+    void for_each(Tree& tree, Vec& vals) {
+        using namespace trbt::impl;
+        using value_type = typename Tree::value_type;
+        auto& mt = rng();
+
+        tree.clear();
+        tree.insert(std::begin(vals), std::end(vals));
+        std::sort(std::begin(vals), std::end(vals));
+
+        std::vector<value_type> seen;
+        auto collect = [&seen](value_type const& v) {
+            seen.push_back(v);
+        };
+        auto const& ctree = tree;
+
+        tree.for_each(collect);
+        if(!std::equal(std::begin(seen), std::end(seen), std::begin(vals), std::end(vals)))
+            throw iterator_exception{"for_each yields different values\n"};
+        seen.clear();
+        ctree.for_each_reverse(collect);
+        if(!std::equal(std::begin(seen), std::end(seen), std::rbegin(vals), std::rend(vals)))
+            throw iterator_exception{"for_each_reverse yields different values\n"};
+
+        std::uniform_int_distribution<std::size_t> idx_dis(0u, vals.size() - 1u);
+        for(int i = 0; i < 32; i++) {
+            auto lo = vals[idx_dis(mt)], hi = vals[idx_dis(mt)];
+            auto first = std::lower_bound(std::begin(vals), std::end(vals), lo);
+            auto last  = std::upper_bound(std::begin(vals), std::end(vals), hi);
+            if(last < first)
+                last = first;
+
+            seen.clear();
+            tree.for_each_in_range(lo, hi, collect);
+            if(!std::equal(std::begin(seen), std::end(seen), first, last))
+                throw iterator_exception{"for_each_in_range yields different values\n"};
+
+            seen.clear();
+            ctree.for_each_in_range_reverse(lo, hi, collect);
+            if(!std::equal(std::begin(seen), std::end(seen), std::make_reverse_iterator(last), std::make_reverse_iterator(first)))
+                throw iterator_exception{"for_each_in_range_reverse yields different values\n"};
+        }
+
+        /* Ranges holding a single value */
+        seen.clear();
+        tree.for_each_in_range(vals.front(), vals.front(), collect);
+        tree.for_each_in_range_reverse(vals.back(), vals.back(), collect);
+        if(seen.size() != 2u || !(seen.front() == vals.front()) || !(seen.back() == vals.back()))
+            throw iterator_exception{"for_each_in_range misses bounds\n"};
+
+        tree.clear();
+        seen.clear();
+        tree.for_each(collect);
+        tree.for_each_reverse(collect);
+        tree.for_each_in_range(vals.front(), vals.back(), collect);
+        tree.for_each_in_range_reverse(vals.front(), vals.back(), collect);
+        if(!seen.empty())
+            throw iterator_exception{"Traversal of empty tree yields values\n"};
+    }
+
+    template <typename Vec>
+    void split_ranges(Vec& vals) {
+        using namespace trbt::impl;
+        auto& mt = rng();
+        std::shuffle(std::begin(vals), std::end(vals), mt);
+        rbtree<int> tree(std::begin(vals), std::end(vals));
+        std::sort(std::begin(vals), std::end(vals));
+
+        std::uniform_int_distribution<std::size_t> k_dis(1u, 128u);
+        for(int i = 0; i < 8; i++) {
+            auto const k = k_dis(mt);
+            auto const ranges = tree.split_ranges(k);
+
+            if(ranges.size() > k || ranges.empty())
+                throw iterator_exception{"Split into " + std::to_string(ranges.size()) + " ranges, requested " + std::to_string(k) + "\n"};
+            if(ranges.size() < k && ranges.size() < vals.size())
+                throw iterator_exception{"Split into fewer ranges than possible\n"};
+            if(ranges.front().first != tree.cbegin() || ranges.back().second != tree.cend())
+                throw iterator_exception{"Ranges do not cover the tree\n"};
+
+            std::vector<int> seen;
+            for(std::size_t j = 0u; j < ranges.size(); j++) {
+                if(ranges[j].first == ranges[j].second)
+                    throw iterator_exception{"Empty range\n"};
+                if(j && ranges[j - 1u].second != ranges[j].first)
+                    throw iterator_exception{"Ranges are not contiguous\n"};
+                tree.for_each(ranges[j].first, ranges[j].second, [&seen](int v) {
+                    seen.push_back(v);
+                });
+            }
+            if(seen != vals)
+                throw iterator_exception{"Ranges yield different values\n"};
+        }
+
+        std::uniform_int_distribution<int> bound_dis(vals.empty() ? 0 : vals.front() - 1, vals.empty() ? 0 : vals.back() + 1);
+        for(int i = 0; i < 8; i++) {
+            auto lo = bound_dis(mt), hi = bound_dis(mt);
+            if(lo > hi)
+                std::swap(lo, hi);
+            auto const k = k_dis(mt);
+            auto const ranges = tree.split_ranges(lo, hi, k);
+            auto const first = std::lower_bound(std::begin(vals), std::end(vals), lo);
+            auto const last = std::upper_bound(std::begin(vals), std::end(vals), hi);
+
+            if(first == last) {
+                if(!ranges.empty())
+                    throw iterator_exception{"Empty bounds split into non-empty ranges\n"};
+                continue;
+            }
+            if(ranges.size() > k || (ranges.size() < k && ranges.size() < static_cast<std::size_t>(last - first)))
+                throw iterator_exception{"Split bounds into " + std::to_string(ranges.size()) + " ranges, requested " + std::to_string(k) + "\n"};
+            if(ranges.front().first != tree.lower_bound(lo) || ranges.back().second != tree.upper_bound(hi))
+                throw iterator_exception{"Ranges do not cover [" + std::to_string(lo) + ", " + std::to_string(hi) + "]\n"};
+            for(std::size_t j = 0u; j < ranges.size(); j++) {
+                if(ranges[j].first == ranges[j].second)
+                    throw iterator_exception{"Empty range\n"};
+                if(j && ranges[j - 1u].second != ranges[j].first)
+                    throw iterator_exception{"Ranges are not contiguous\n"};
+            }
+        }
+
+        if(!rbtree<int>{}.split_ranges(4u).empty())
+            throw iterator_exception{"Empty tree split into non-empty ranges\n"};
+
+        trbt::thread_pool pool{3u};
+        std::atomic<long long> sum{0};
+        std::atomic<std::size_t> count{0u};
+        trbt::parallel_for_each(tree, [&sum, &count](int v) {
+            sum += v;
+            ++count;
+        }, pool);
+        if(count != vals.size() || sum != std::accumulate(std::begin(vals), std::end(vals), 0ll))
+            throw iterator_exception{"parallel_for_each visits different values\n"};
+
+        bool thrown = false;
+        try {
+            trbt::parallel_for_each(tree, [](int) { throw std::logic_error{"expected"}; }, pool);
+        }
+        catch(std::logic_error const&) {
+            thrown = true;
+        }
+        if(!thrown)
+            throw iterator_exception{"Exception thrown in parallel_for_each not propagated\n"};
+    }
+
+    template <typename Vec>
+    void reduce(Vec& vals) {
+        using namespace trbt::impl;
+        auto& mt = rng();
+        rbtree<int> tree(std::begin(vals), std::end(vals));
+        std::sort(std::begin(vals), std::end(vals));
+        vals.erase(std::unique(std::begin(vals), std::end(vals)), std::end(vals));
+
+        trbt::thread_pool pool{3u};
+        auto const par = trbt::execution::par.on(pool);
+        auto const& seq = trbt::execution::seq;
+        auto const concat = [](std::vector<int> lhs, std::vector<int> const& rhs) {
+            lhs.insert(std::end(lhs), std::begin(rhs), std::end(rhs));
+            return lhs;
+        };
+        auto const single = [](int v) { return std::vector<int>{v}; };
+        auto const even = [](int v) { return v % 2 == 0; };
+
+        std::uniform_int_distribution<int> bound_dis(vals.empty() ? 0 : vals.front() - 1, vals.empty() ? 0 : vals.back() + 1);
+        for(int i = 0; i < 16; i++) {
+            auto lo = bound_dis(mt), hi = bound_dis(mt);
+            if(i % 4 && lo > hi)
+                std::swap(lo, hi);
+            auto const first = std::lower_bound(std::begin(vals), std::end(vals), lo);
+            auto const last = lo > hi ? first : std::upper_bound(std::begin(vals), std::end(vals), hi);
+            auto const bounds = "[" + std::to_string(lo) + ", " + std::to_string(hi) + "]";
+
+            auto const sum = std::accumulate(first, last, 1ll);
+            if(tree.reduce(seq, lo, hi, 1ll, std::plus<>{}) != sum || tree.reduce(par, lo, hi, 1ll, std::plus<>{}) != sum)
+                throw iterator_exception{"reduce over " + bounds + " yields wrong sum\n"};
+
+            auto const evens = static_cast<std::size_t>(std::count_if(first, last, even));
+            if(tree.count_if(seq, lo, hi, even) != evens || tree.count_if(par, lo, hi, even) != evens)
+                throw iterator_exception{"count_if over " + bounds + " yields wrong count\n"};
+
+            /* Concatenation is associative but not commutative, so this fails
+             * unless the partial results are combined in order */
+            std::vector<int> const expected(first, last);
+            if(tree.transform_reduce(seq, lo, hi, std::vector<int>{}, concat, single) != expected ||
+               tree.transform_reduce(par, lo, hi, std::vector<int>{}, concat, single) != expected)
+                throw iterator_exception{"transform_reduce over " + bounds + " combines values out of order\n"};
+        }
+
+        /* Reductions on the pool running the traversal they are nested in */
+        std::atomic<std::size_t> found{0u};
+        trbt::parallel_for_each(tree, [&tree, &found, &par](int v) {
+            found += tree.count_if(par, v, v, [](int) { return true; });
+        }, pool);
+        if(found != vals.size())
+            throw iterator_exception{"Reductions nested in parallel_for_each yield wrong counts\n"};
+    }
+
+    /* Aggregates the first and last value, the number of values and whether
+     * they were combined in order, which a commutative monoid would not catch */
+    struct ordered_monoid {
+        struct aggregate_type {
+            int first, last;
+            std::size_t count;
+            bool sorted;
+
+            bool operator==(aggregate_type const& other) const {
+                return count == other.count && sorted == other.sorted &&
+                       (!count || (first == other.first && last == other.last));
+            }
+        };
+
+        aggregate_type identity() const {
+            return {0, 0, 0u, true};
+        }
+
+        aggregate_type lift(int value) const {
+            return {value, value, 1u, true};
+        }
+
+        aggregate_type combine(aggregate_type const& left, aggregate_type const& right) const {
+            if(!left.count)
+                return right;
+            if(!right.count)
+                return left;
+            return {left.first, right.last, left.count + right.count, left.sorted && right.sorted && left.last < right.first};
+        }
+    };
+
+    struct mapped_projection {
+        template <typename Pair>
+        long long operator()(Pair const& value) const {
+            return value.second;
+        }
+    };
+
+    template <typename Vec>
+    void augment(Vec& vals) {
+        using namespace trbt::impl;
+        using tree_type = rbtree<int, std::less<int>, std::allocator<int>, trbt::augment<ordered_monoid>>;
+        auto& mt = rng();
+        std::shuffle(std::begin(vals), std::end(vals), mt);
+
+        std::set<int> oracle;
+        tree_type tree;
+        auto const expected = [&oracle](int lo, int hi) {
+            ordered_monoid const monoid{};
+            auto aggregate = monoid.identity();
+            if(lo <= hi) {
+                for(auto it = oracle.lower_bound(lo); it != std::end(oracle) && *it <= hi; ++it)
+                    aggregate = monoid.combine(aggregate, monoid.lift(*it));
+            }
+            return aggregate;
+        };
+
+        std::uniform_int_distribution<int> op_dis(0, 3);
+        std::uniform_int_distribution<int> bound_dis(vals.empty() ? 0 : -10 * static_cast<int>(vals.size()),
+                                                     vals.empty() ? 0 : 10 * static_cast<int>(vals.size()));
+        auto const check = [&](tree_type const& t, std::string const& what) {
+            if(!(t.aggregate() == expected(std::numeric_limits<int>::min(), std::numeric_limits<int>::max())))
+                throw aggregate_exception{"Aggregate of whole tree is wrong after " + what + "\n"};
+            for(int i = 0; i < 4; i++) {
+                int const lo = bound_dis(mt), hi = bound_dis(mt);
+                if(!(t.aggregate(lo, hi) == expected(lo, hi)))
+                    throw aggregate_exception{"Aggregate of [" + std::to_string(lo) + ", " + std::to_string(hi) + "] is wrong after " + what + "\n"};
+            }
+        };
+
+        for(std::size_t i = 0u; i < vals.size(); i++) {
+            auto v = vals[i];
+            switch(op_dis(mt)) {
+                case 0:
+                    tree.insert(v);
+                    break;
+                case 1:
+                    tree.emplace(v);
+                    break;
+                case 2:
+                    tree.insert(tree.lower_bound(v), v);
+                    break;
+                default:
+                    tree.insert(v);
+                    oracle.insert(v);
+                    v = vals[std::uniform_int_distribution<std::size_t>(0u, vals.size() - 1u)(mt)];
+                    tree.erase(v);
+                    oracle.erase(v);
+                    if(check_due(i, vals.size()))
+                        check(tree, "erasing " + std::to_string(v));
+                    continue;
+            }
+            oracle.insert(v);
+            if(check_due(i, vals.size()))
+                check(tree, "inserting " + std::to_string(v));
+        }
+        tree.assert_properties_ok([](int i) { return std::to_string(i); });
+
+        tree_type const copy{tree};
+        check(copy, "copying");
+
+        std::stringstream ss;
+        tree.save(ss);
+        tree_type loaded;
+        loaded.load(ss);
+        check(loaded, "loading");
+
+        for(auto v : vals) {
+            tree.erase(v);
+            oracle.erase(v);
+        }
+        check(tree, "erasing all values");
+
+        /* Sums of mapped values, which may only be changed through modify */
+        using map_type = rbtree<std::pair<int, int>, std::less<std::pair<int, int>>, std::allocator<std::pair<int const, int>>,
+                                trbt::augment<trbt::sum_monoid<long long, mapped_projection>>>;
+        static_assert(std::is_const_v<std::remove_reference_t<decltype(*std::declval<map_type::iterator>())>>);
+
+        map_type map;
+        std::map<int, int> map_oracle;
+        std::uniform_int_distribution<int> mapped_dis(-100, 100);
+        for(auto v : vals) {
+            auto mapped = mapped_dis(mt);
+            map.insert(map_type::value_type{v, mapped});
+            map_oracle.emplace(v, mapped);
+        }
+        for(auto const& [key, mapped] : map_oracle) {
+            auto const delta = mapped_dis(mt);
+            map.modify(map.find(map_type::value_type{key, 0}), [delta](int& m) { m += delta; });
+            map_oracle[key] += delta;
+        }
+        for(int i = 0; i < 16; i++) {
+            int const lo = bound_dis(mt), hi = bound_dis(mt);
+            long long sum = 0;
+            for(auto it = map_oracle.lower_bound(lo); it != std::end(map_oracle) && it->first <= hi; ++it)
+                sum += it->second;
+            if(map.aggregate(map_type::value_type{lo, 0}, map_type::value_type{hi, 0}) != sum)
+                throw aggregate_exception{"Sum of mapped values in [" + std::to_string(lo) + ", " + std::to_string(hi) + "] is wrong\n"};
+        }
+    }
+
+    template <typename Vec>
+    void interval(Vec const& vals) {
+        using namespace trbt::impl;
+        using interval_type = trbt::interval<int>;
+        auto& mt = rng();
+
+        /* Endpoints drawn from a narrow range so that intervals overlap often */
+        int const span = 4 * static_cast<int>(vals.size()) + 1;
+        std::uniform_int_distribution<int> start_dis(-span, span);
+        std::uniform_int_distribution<int> length_dis(0, std::max(1, span / 8));
+
+        auto const interval_string = [](interval_type const& i) {
+            return "[" + std::to_string(i.start) + ", " + std::to_string(i.end) + ")";
+        };
+
+        /* Identical intervals are all kept */
+        trbt::interval_tree<int> tree;
+        tree.insert(interval_type{1, 3});
+        tree.insert(interval_type{1, 3});
+        if(tree.overlaps(2) != std::vector<interval_type>{{1, 3}, {1, 3}} || tree.overlaps(interval_type{0, 2}).size() != 2u)
+            throw aggregate_exception{"Interval inserted twice is not reported twice\n"};
+        if(tree.erase(interval_type{1, 3}) != 2u || tree.overlaps_any(2))
+            throw aggregate_exception{"Interval inserted twice is not erased twice\n"};
+
+        /* Copies of intervals are erased one at a time or all at once, so
+         * that aggregates are updated by either kind of removal */
+        std::multiset<interval_type> oracle;
+        for(std::size_t i = 0u; i < vals.size(); i++) {
+            int const start = start_dis(mt);
+            interval_type const value{start, start + length_dis(mt)};
+            tree.insert(value);
+            oracle.insert(value);
+            if(i % 3u == 1u) {
+                tree.insert(tree.lower_bound(value), value);
+                oracle.insert(value);
+            }
+            if(i % 4u == 3u) {
+                auto const victim = *std::next(std::begin(oracle), std::uniform_int_distribution<std::size_t>(0u, oracle.size() - 1u)(mt));
+                if(i % 8u == 3u) {
+                    if(!tree.extract_value(victim))
+                        throw aggregate_exception{"Interval " + interval_string(victim) + " not extracted\n"};
+                    oracle.erase(oracle.find(victim));
+                }
+                else if(tree.erase(victim) != oracle.erase(victim))
+                    throw aggregate_exception{"Copies of interval " + interval_string(victim) + " not all erased\n"};
+            }
+        }
+        tree.assert_properties_ok(interval_string);
+        auto max_end = std::numeric_limits<int>::lowest();
+        for(auto const& value : oracle)
+            max_end = std::max(max_end, value.end);
+        if(tree.aggregate() != max_end)
+            throw aggregate_exception{"Greatest end of the intervals is wrong\n"};
+
+        for(int i = 0; i < 32; i++) {
+            int const point = start_dis(mt);
+            std::vector<interval_type> expected;
+            std::copy_if(std::begin(oracle), std::end(oracle), std::back_inserter(expected),
+                         [point](interval_type const& value) { return value.contains(point); });
+            if(tree.overlaps(point) != expected)
+                throw aggregate_exception{"Intervals containing " + std::to_string(point) + " are wrong\n"};
+            if(tree.overlaps_any(point) != !expected.empty())
+                throw aggregate_exception{"overlaps_any(" + std::to_string(point) + ") is wrong\n"};
+
+            int const start = start_dis(mt);
+            interval_type const range{start, start + length_dis(mt)};
+            expected.clear();
+            std::copy_if(std::begin(oracle), std::end(oracle), std::back_inserter(expected),
+                         [&range](interval_type const& value) { return value.overlaps(range); });
+            if(tree.overlaps(range) != expected)
+                throw aggregate_exception{"Intervals overlapping " + interval_string(range) + " are wrong\n"};
+            if(tree.overlaps_any(range) != !expected.empty())
+                throw aggregate_exception{"overlaps_any(" + interval_string(range) + ") is wrong\n"};
+
+            /* Stopping after the first hit */
+            std::size_t calls = 0u;
+            tree.overlaps(range, [&calls](interval_type const&) { return ++calls == 0u; });
+            if(calls != std::min<std::size_t>(1u, expected.size()))
+                throw aggregate_exception{"Search for intervals overlapping " + interval_string(range) + " did not stop\n"};
+        }
+    }
+
+    template <typename Vec>
+    void duplicates(Vec const& vals) {
+        using namespace trbt::impl;
+        using tree_type = rbtree<std::pair<int, int>, std::less<std::pair<int, int>>, std::allocator<std::pair<int const, int>>,
+                                 trbt::allow_duplicates>;
+        using value_type = tree_type::value_type;
+        auto& mt = rng();
+
+        /* Keys from a narrow range so that most of them occur several times,
+         * mapped values numbering the insertions to check their order */
+        int const keys = static_cast<int>(vals.size()) / 4 + 1;
+        auto const key_of = [keys](int v) {
+            return (v % keys + keys) % keys;
+        };
+
+        tree_type tree;
+        std::multimap<int, int> oracle;
+        std::uniform_int_distribution<int> op_dis(0, 7);
+        int seq = 0;
+        for(auto v : vals) {
+            int const key = key_of(v);
+            switch(op_dis(mt)) {
+                case 0:
+                    tree.emplace(key, seq);
+                    break;
+                case 1:
+                    /* Equal values go after those in the tree whatever the hint */
+                    tree.insert(tree.lower_bound(value_type{key, 0}), value_type{key, seq});
+                    break;
+                case 2:
+                    tree.insert(tree.upper_bound(value_type{key_of(v / 2), 0}), value_type{key, seq});
+                    break;
+                case 3:
+                    if(tree.erase(value_type{key, 0}) != oracle.erase(key))
+                        throw duplicate_exception{"Wrong number of values with key " + std::to_string(key) + " erased\n"};
+                    continue;
+                default:
+                    if(!tree.insert(value_type{key, seq}).second)
+                        throw duplicate_exception{"Insertion of key " + std::to_string(key) + " rejected\n"};
+                    break;
+            }
+            oracle.emplace(key, seq++);
+        }
+        tree.assert_properties_ok([](value_type const& value) { return std::to_string(value.first); });
+
+        if(tree.size() != oracle.size() || !std::equal(std::begin(tree), std::end(tree), std::begin(oracle), std::end(oracle)))
+            throw duplicate_exception{"Values differ from oracle or are out of insertion order\n"};
+
+        for(int key = -1; key <= keys; key++) {
+            auto const [first, last] = tree.equal_range(value_type{key, 0});
+            auto const [oracle_first, oracle_last] = oracle.equal_range(key);
+            if(!std::equal(first, last, oracle_first, oracle_last))
+                throw duplicate_exception{"equal_range(" + std::to_string(key) + ") is wrong\n"};
+            if(tree.count(value_type{key, 0}) != oracle.count(key))
+                throw duplicate_exception{"count(" + std::to_string(key) + ") is wrong\n"};
+            if(tree.find(value_type{key, 0}) != (first == last ? std::end(tree) : first) || (first == last) == tree.contains(value_type{key, 0}))
+                throw duplicate_exception{"find(" + std::to_string(key) + ") is not the first value with the key\n"};
+        }
+
+        tree_type const copy{tree};
+        if(!std::equal(std::begin(copy), std::end(copy), std::begin(oracle), std::end(oracle)))
+            throw duplicate_exception{"Copy differs from oracle\n"};
+
+        /* Runs of equal values are unlinked bottom-up, which must leave a valid tree */
+        for(int key = 0; key < keys; key++) {
+            if(tree.erase(value_type{key, 0}) != oracle.erase(key))
+                throw duplicate_exception{"Wrong number of values with key " + std::to_string(key) + " erased\n"};
+            tree.assert_properties_ok([](value_type const& value) { return std::to_string(value.first); });
+            if(tree.assert_leftmost_ok() || tree.assert_rightmost_ok())
+                throw duplicate_exception{"Leftmost or rightmost node broken by erasing key " + std::to_string(key) + "\n"};
+            if(!std::equal(std::begin(tree), std::end(tree), std::begin(oracle), std::end(oracle)))
+                throw duplicate_exception{"Values differ from oracle after erasing key " + std::to_string(key) + "\n"};
+        }
+        if(!tree.empty())
+            throw duplicate_exception{"Tree not empty after erasing all keys\n"};
+    }
+
+    template <typename Vec, typename StringConverter>
+    void extract_value(Vec& vals, StringConverter sc) {
+        using namespace trbt::impl;
+        auto& mt = rng();
+
+        rbtree<typename Vec::value_type> tree(std::begin(vals), std::end(vals));
+        std::shuffle(std::begin(vals), std::end(vals), mt);
+
+        for(std::size_t i = 0u; i < vals.size(); i++) {
+            auto const& v = vals[i];
+            auto extracted = tree.extract_value(v);
+            if(!extracted || *extracted != v)
+                throw value_retention_exception{"Extracting " + sc(v) + " did not return it\n"};
+            if(tree.contains(v))
+                throw value_retention_exception{sc(v) + " still in tree after extraction\n"};
+            if(tree.extract_value(v))
+                throw value_retention_exception{sc(v) + " extracted twice\n"};
+            if(check_due(i, vals.size()))
+                tree.assert_properties_ok(sc);
+        }
+
+        if(!tree.empty())
+            throw value_retention_exception{"Tree not empty after extracting all values\n"};
+    }
+
+    template <typename Vec>
+    void priority_queue(Vec const& vals) {
+        using namespace trbt::impl;
+        using tree_type = rbtree<std::pair<int, int>, std::less<std::pair<int, int>>, std::allocator<std::pair<int const, int>>,
+                                 trbt::allow_duplicates>;
+        using value_type = tree_type::value_type;
+        auto& mt = rng();
+
+        /* Few distinct priorities, mapped values numbering the insertions so
+         * that equal priorities must be popped first in, first out */
+        int const priorities = static_cast<int>(vals.size()) / 8 + 1;
+        std::multimap<int, int> oracle;
+        tree_type tree;
+
+        auto const check_extremes = [&tree, &oracle]() {
+            if(tree.size() != oracle.size())
+                throw value_retention_exception{"Size differs from oracle\n"};
+            if(!oracle.empty() && (tree.min() != *std::begin(oracle) || tree.max() != *std::prev(std::end(oracle))))
+                throw value_retention_exception{"min or max differs from oracle\n"};
+        };
+
+        std::uniform_int_distribution<int> op_dis(0, 5);
+        int seq = 0;
+        for(auto v : vals) {
+            switch(op_dis(mt)) {
+                case 0: {
+                    auto popped = tree.pop_min();
+                    if(oracle.empty() != !popped || (popped && *popped != *std::begin(oracle)))
+                        throw value_retention_exception{"pop_min differs from oracle\n"};
+                    if(popped)
+                        oracle.erase(std::begin(oracle));
+                    break;
+                }
+                case 1: {
+                    auto popped = tree.pop_max();
+                    if(oracle.empty() != !popped || (popped && *popped != *std::prev(std::end(oracle))))
+                        throw value_retention_exception{"pop_max differs from oracle\n"};
+                    if(popped)
+                        oracle.erase(std::prev(std::end(oracle)));
+                    break;
+                }
+                default: {
+                    int const priority = (v % priorities + priorities) % priorities;
+                    tree.insert(value_type{priority, seq});
+                    oracle.emplace(priority, seq++);
+                    break;
+                }
+            }
+            check_extremes();
+        }
+        tree.assert_properties_ok([](value_type const& value) { return std::to_string(value.first); });
+
+        while(!oracle.empty()) {
+            auto const k = std::uniform_int_distribution<std::size_t>(0u, oracle.size() / 2u + 1u)(mt);
+            auto const popped = tree.pop_min_n(k);
+            auto last = std::begin(oracle);
+            std::advance(last, std::min(k, oracle.size()));
+            if(!std::equal(std::begin(popped), std::end(popped), std::begin(oracle), last))
+                throw value_retention_exception{"pop_min_n(" + std::to_string(k) + ") differs from oracle\n"};
+            oracle.erase(std::begin(oracle), last);
+            check_extremes();
+            tree.assert_properties_ok([](value_type const& value) { return std::to_string(value.first); });
+        }
+
+        if(!tree.empty() || tree.pop_min() || tree.pop_max() || !tree.pop_min_n(1u).empty())
+            throw value_retention_exception{"Popping from empty tree returned values\n"};
+    }
+
+    template <typename Vec>
+    void move_only(Vec const& vals) {
+        using namespace trbt::impl;
+        using set_type = rbtree<handle, std::less<int>, std::allocator<handle>, trbt::key_projection<handle_id>>;
+        using map_type = rbtree<std::pair<int, std::unique_ptr<int>>>;
+        auto& mt = rng();
+
+        static_assert(std::is_same_v<set_type::key_type, int>);
+        static_assert(std::is_assignable_v<decltype((std::declval<set_type::iterator>()->payload)), std::unique_ptr<int>>);
+        static_assert(!std::is_assignable_v<decltype((std::declval<set_type::const_iterator>()->id)), int>);
+
+        /* Keys are only protected from writes through mutable iterators when
+         * the value declares them const */
+        using const_set_type = rbtree<const_handle, std::less<int>, std::allocator<const_handle>, trbt::key_projection<const_handle_id>>;
+        static_assert(!std::is_assignable_v<decltype((std::declval<const_set_type::iterator>()->id)), int>);
+        static_assert(std::is_assignable_v<decltype((std::declval<const_set_type::iterator>()->payload)), std::unique_ptr<int>>);
+
+        std::set<int> oracle;
+        set_type set;
+        map_type map;
+        for(auto v : vals) {
+            bool const inserted = oracle.insert(v).second;
+            if(set.insert(handle{v, std::make_unique<int>(v)}).second != inserted ||
+               map.insert(std::pair{v, std::make_unique<int>(v)}).second != inserted)
+                throw value_retention_exception{"Insertion of " + std::to_string(v) + " disagrees with oracle\n"};
+        }
+        set.assert_properties_ok([](handle const& h) { return std::to_string(h.id); });
+
+        /* Payloads are replaced through iterators found by key alone */
+        for(auto v : oracle) {
+            auto set_it = set.find(v);
+            auto map_it = map.find(v);
+            if(set_it == std::end(set) || map_it == std::end(map) || !set.contains(v) || !map.contains(v))
+                throw value_retention_exception{std::to_string(v) + " not found by key\n"};
+            set_it->payload = std::make_unique<int>(-v);
+            *map_it->second = -v;
+        }
+
+        std::vector<int> keys(std::begin(oracle), std::end(oracle));
+        std::shuffle(std::begin(keys), std::end(keys), mt);
+        for(std::size_t i = 0u; i < keys.size(); i++) {
+            auto const v = keys[i];
+            auto from_set = set.take(v);
+            auto from_map = map.take(v);
+            if(!from_set || from_set->id != v || !from_set->payload || *from_set->payload != -v)
+                throw value_retention_exception{"Taking " + std::to_string(v) + " from set did not return its payload\n"};
+            if(!from_map || from_map->first != v || !from_map->second || *from_map->second != -v)
+                throw value_retention_exception{"Taking " + std::to_string(v) + " from map did not return its payload\n"};
+            if(set.contains(v) || map.contains(v) || set.take(v) || map.take(v))
+                throw value_retention_exception{std::to_string(v) + " still in tree after being taken\n"};
+            if(check_due(i, keys.size()))
+                set.assert_properties_ok([](handle const& h) { return std::to_string(h.id); });
+        }
+
+        if(!set.empty() || !map.empty())
+            throw value_retention_exception{"Tree not empty after taking all values\n"};
+
+        const_set_type const_set;
+        for(auto v : oracle)
+            const_set.insert(const_handle{v, std::make_unique<int>(v)});
+        for(auto v : keys) {
+            auto it = const_set.find(v);
+            if(it == std::end(const_set))
+                throw value_retention_exception{std::to_string(v) + " not found by key in set with const keys\n"};
+            it->payload = std::make_unique<int>(-v);
+        }
+        for(auto v : oracle) {
+            auto const taken = const_set.take(v);
+            if(!taken || taken->id != v || !taken->payload || *taken->payload != -v)
+                throw value_retention_exception{"Taking " + std::to_string(v) + " from set with const keys did not return its payload\n"};
+        }
+        const_set.assert_properties_ok([](const_handle const& h) { return std::to_string(h.id); });
+        if(!const_set.empty())
+            throw value_retention_exception{"Set with const keys not empty after taking all values\n"};
+    }
+
+    template <typename Vec>
+    void three_way(Vec const& vals) {
+        using namespace trbt::impl;
+        using compare = three_way_int_compare;
+
+        rbtree<int, compare> tree(std::begin(vals), std::end(vals));
+        
+        compare::two_way_calls = 0u;
+        compare::three_way_calls = 0u;
+
+        for(auto const& v : vals) {
+            if(tree.find(v) == std::end(tree))
+                throw value_retention_exception{std::to_string(v) + " not in tree\n"};
+            if(!tree.contains(v))
+                throw value_retention_exception{std::to_string(v) + " not in tree\n"};
+        }
+
+        if(compare::two_way_calls)
+            throw comparison_exception{"Lookups used two-way comparisons despite three_way being available\n"};
+
+        if(compare::three_way_calls > 2u * vals.size() * (2u * std::log2(vals.size() + 1u) + 1u))
+            throw comparison_exception{"Lookups used more than one comparison per level\n"};
+
+        compare::two_way_calls = 0u;
+        compare::three_way_calls = 0u;
+
+        for(auto const& v : vals) {
+            if(!tree.erase(v))
+                throw value_retention_exception{std::to_string(v) + " not erased\n"};
+        }
+
+        if(!tree.empty())
+            throw value_retention_exception{"Tree not empty after erasing all values\n"};
+
+        if(compare::two_way_calls)
+            throw comparison_exception{"Erasures used two-way comparisons despite three_way being available\n"};
+
+        if(compare::three_way_calls > vals.size() * (2u * std::log2(vals.size() + 1u) + 1u))
+            throw comparison_exception{"Erasures used more than one comparison per level\n"};
+    }
     
 } /* namespace test */
 } /* namespace trbt */
@@ -0,0 +1,158 @@
+#ifndef TRBT_TEST_RUNNER_H
+#define TRBT_TEST_RUNNER_H
+
+#pragma once
+#include "trbt_test_config.h"
+#include "trbt_test_framework.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace trbt {
+namespace test {
+
+struct runner_options {
+    std::uint64_t seed{std::random_device{}()};
+    unsigned threads{std::max(1u, std::thread::hardware_concurrency())};
+    unsigned scale{1u};
+    std::size_t max_size{trbt_max_test_size};
+};
+
+/* Parses --seed <n>, --threads <n>, --scale <n> and --max-size <n> */
+inline runner_options parse_options(int argc, char** argv) {
+    runner_options opts{};
+    for(int i = 1; i < argc; i++) {
+        std::string const arg{argv[i]};
+        if(i + 1 == argc)
+            throw std::invalid_argument{"Missing value for " + arg};
+
+        auto const value = std::stoull(argv[++i]);
+        if(arg == "--seed")
+            opts.seed = value;
+        else if(arg == "--threads")
+            opts.threads = std::max(1u, static_cast<unsigned>(value));
+        else if(arg == "--scale")
+            opts.scale = std::max(1u, static_cast<unsigned>(value));
+        else if(arg == "--max-size") /* Values are drawn from [-10 n, 10 n] */
+            opts.max_size = std::clamp<unsigned long long>(value, 1u, std::numeric_limits<int>::max() / 10);
+        else
+            throw std::invalid_argument{"Unknown option " + arg};
+    }
+    return opts;
+}
+
+/* Mixes seed and salt (splitmix64 finalizer) */
+inline std::uint64_t mix_seed(std::uint64_t seed, std::uint64_t salt) noexcept {
+    std::uint64_t z = seed + 0x9e3779b97f4a7c15ull * (salt + 1u);
+    z = (z ^ (z >> 30u)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27u)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31u);
+}
+
+/* State of one thread of the randomized suite. Every shard draws the same
+ * number of iterations per test family, from a generator seeded with the
+ * suite seed alone, and runs the iterations whose index is congruent to its
+ * own index modulo the number of shards. Everything else is drawn from
+ * per-shard generators, so a run is reproducible given the seed and the
+ * number of threads. Must be constructed on the thread it is used on */
+class shard {
+    using clock = std::chrono::steady_clock;
+
+    public:
+        struct family_result {
+            std::string name;
+            std::size_t iterations;
+            clock::duration time;
+        };
+
+        shard(runner_options const& opts, unsigned index, std::atomic<bool>& failed)
+            : index_{index}, stride_{opts.threads}, scale_{opts.scale}, max_size_{opts.max_size}, failed_{&failed},
+              suite_mt_{static_cast<std::mt19937::result_type>(mix_seed(opts.seed, 0u))},
+              mt_{static_cast<std::mt19937::result_type>(mix_seed(opts.seed, 2u * index + 1u))} {
+            seed_rng(mix_seed(opts.seed, 2u * index + 2u));
+        }
+
+        shard(shard const&) = delete;
+        shard& operator=(shard const&) = delete;
+
+        /* Starts the test family name, returns its total number of iterations */
+        template <typename Dist>
+        int family(std::string name, Dist& iter_dis) {
+            finish_family();
+            results_.push_back({std::move(name), 0u, clock::duration::zero()});
+            start_ = clock::now();
+            return iter_dis(suite_mt_) * static_cast<int>(scale_);
+        }
+
+        int first() const noexcept {
+            return static_cast<int>(index_);
+        }
+
+        int stride() const noexcept {
+            return static_cast<int>(stride_);
+        }
+
+        /* Upper bound for the number of values used per test */
+        int max_test_size() const noexcept {
+            return static_cast<int>(max_size_);
+        }
+
+        /* Whether iteration i should run, counts it if so */
+        bool proceed(int i, int iters) {
+            if(i >= iters || failed_->load(std::memory_order_relaxed))
+                return false;
+            ++results_.back().iterations;
+            return true;
+        }
+
+        std::mt19937& rng() noexcept {
+            return mt_;
+        }
+
+        void fail(std::string report) {
+            finish_family();
+            failure_ = std::move(report);
+            failed_->store(true);
+        }
+
+        void finish_family() {
+            if(!results_.empty() && start_ != clock::time_point{})
+                results_.back().time += clock::now() - start_;
+            start_ = clock::time_point{};
+        }
+
+        std::vector<family_result> const& results() const noexcept {
+            return results_;
+        }
+
+        std::string const& failure() const noexcept {
+            return failure_;
+        }
+
+    private:
+        unsigned index_;
+        unsigned stride_;
+        unsigned scale_;
+        std::size_t max_size_;
+        std::atomic<bool>* failed_;
+        std::mt19937 suite_mt_;
+        std::mt19937 mt_;
+        clock::time_point start_{};
+        std::vector<family_result> results_{};
+        std::string failure_{};
+};
+
+} /* namespace test */
+} /* namespace trbt */
+
+#endif
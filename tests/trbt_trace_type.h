@@ -4,14 +4,32 @@
 #pragma once
 #include "trbt.h"
 #include "trbt_test_config.h"
+#include <algorithm>
+#include <cstddef>
+#include <deque>
 #include <iomanip>
 #include <iostream>
-#include <deque>
+#include <iterator>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace trbt {
 
 namespace test {
 
+/* Operations recorded by trbt_trace_type */
+enum class trace_operation { Insert, HintedInsert, InsertRange, Erase, Clear };
+
+/* Rather than copying the whole tree before every traced operation, the
+ * trbt_trace_type keeps a log of every operation altering it along with
+ * checkpoints, i.e. copies of the tree taken every so often. Previous states
+ * are reconstructed on demand by replaying the log from a checkpoint. A new
+ * checkpoint is taken once the number of operations since the last one
+ * reaches the size of the tree, so that copying costs amortized O(1) per
+ * operation. Replacing the contents as a whole (assignment, swap, load)
+ * discards the log */
 template <typename Tree>
 struct trbt_trace_type : public Tree {
 
@@ -22,60 +40,129 @@ struct trbt_trace_type : public Tree {
 
     using Tree::Tree;
 
+    trbt_trace_type() = default;
+
+    trbt_trace_type(trbt_trace_type const& other) : Tree(static_cast<Tree const&>(other)), active{other.active} { }
+
+    trbt_trace_type(trbt_trace_type&& other) : Tree(static_cast<Tree&&>(other)), active{other.active} {
+        other.reset_log();
+    }
+
+    trbt_trace_type& operator=(trbt_trace_type const& other) & {
+        Tree::operator=(static_cast<Tree const&>(other));
+        reset_log();
+        return *this;
+    }
+
+    trbt_trace_type& operator=(trbt_trace_type&& other) & {
+        Tree::operator=(static_cast<Tree&&>(other));
+        reset_log();
+        other.reset_log();
+        return *this;
+    }
+
+    /* Untraced operations, logged so that replaying stays accurate */
+
+    template <typename T = value_type, typename = impl::enable_if_convertible_t<T, value_type>>
+    std::pair<iterator, bool> insert(T&& value) {
+        return logged_insert(false, std::forward<T>(value));
+    }
+
+    template <typename InputIt, typename = impl::enable_if_iterator_t<InputIt>>
+    void insert(InputIt first, InputIt last) {
+        logged_insert(false, first, last);
+    }
+
+    template <typename T = value_type, typename = impl::enable_if_convertible_t<T, value_type>>
+    iterator insert(const_iterator hint, T&& value) {
+        return logged_insert(false, hint, std::forward<T>(value));
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args) {
+        return logged_emplace(false, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    iterator emplace_hint(const_iterator hint, Args&&... args) {
+        return logged_emplace_hint(false, hint, std::forward<Args>(args)...);
+    }
+
+    size_type erase(value_type const& value) {
+        return logged_erase(false, value);
+    }
+
+    void clear() noexcept {
+        checkpoint_if_due();
+        log({trace_operation::Clear}, false);
+        Tree::clear();
+    }
+
+    template <typename Codec = codec<value_type>>
+    void load(std::istream& is, Codec const& cdc = Codec{}) {
+        reset_log();
+        Tree::load(is, cdc);
+    }
+
+    void swap(trbt_trace_type& other) {
+        Tree::swap(other);
+        reset_log();
+        other.reset_log();
+    }
+
+    /* Traced operations, their previous states are printed by print_trace */
+
     template <typename T = value_type, typename = impl::enable_if_convertible_t<T, value_type>>
     std::pair<iterator, bool> traced_insert(T&& value) {
-        add_trace();
-        return Tree::insert(std::forward<T>(value));
+        return logged_insert(true, std::forward<T>(value));
     }
 
     template <typename InputIt, typename = impl::enable_if_iterator_t<InputIt>>
     void traced_insert(InputIt first, InputIt last) {
-        add_trace();
-        Tree::insert(first, last);
+        logged_insert(true, first, last);
     }
 
     template <typename T = value_type, typename = impl::enable_if_convertible_t<T, value_type>>
     iterator traced_insert(const_iterator hint, T&& value) {
-        add_trace();
-        return Tree::insert(hint, std::forward<T>(value));
+        return logged_insert(true, hint, std::forward<T>(value));
     }
 
     template <typename... Args>
     std::pair<iterator, bool> traced_emplace(Args&&... args) {
-        add_trace();
-        return Tree::emplace(std::forward<Args>(args)...);
+        return logged_emplace(true, std::forward<Args>(args)...);
     }
 
     template <typename... Args>
     iterator traced_emplace_hint(const_iterator hint, Args&&... args) {
-        add_trace();
-        return Tree::emplace_hint(hint, std::forward<Args>(args)...);
+        return logged_emplace_hint(true, hint, std::forward<Args>(args)...);
     }
 
     size_type traced_erase(value_type const& value) {
-        add_trace();
-        return Tree::erase(value);
-    }
-
-    void add_trace() {
-        trace.push_back(*this);
-
-        if(trace.size() > trbt_trace_size)
-            trace.pop_front();
+        return logged_erase(true, value);
     }
 
     void clear_trace() {
-        trace.clear();
+        reset_log();
     }
 
     void print_trace(std::ostream& os = std::cout) {
         os << std::setfill('-') << std::setw(30) << "" 
-           << "\nPrinting trace with size " << trace.size() << "\n\n";
-        for(auto i = 0u; i < trace.size(); i++) {
-            os << std::setfill('+') << std::setw(30) << "" << "\ntrace number: "
-               << i << "\n" << "size: " << trace[i].size() << "\n" 
-               << std::setw(30) << "" << "\n" << std::setfill(' ');
-            trace[i].print(os);
+           << "\nPrinting trace with size " << traced_.size() << "\n\n";
+        if(!checkpoints_.empty()) {
+            Tree state = checkpoints_.front().second;
+            auto next = std::begin(traced_);
+            for(auto i = 0u; i < log_.size(); i++) {
+                if(next != std::end(traced_) && *next == log_begin_ + i) {
+                    os << std::setfill('+') << std::setw(30) << "" << "\ntrace number: "
+                       << (next - std::begin(traced_)) << "\n" << "size: " << state.size() << "\n" 
+                       << std::setw(30) << "" << "\n" << std::setfill(' ');
+                    state.print(os);
+                    ++next;
+                }
+                replay(state, log_[i]);
+            }
+            if(!(state == static_cast<Tree const&>(*this)))
+                os << "Replaying the operation log does not reproduce the current tree\n";
         }
         os << std::setfill('+') << std::setw(30) << "" << "\nCurrent\n"
            << "size: " << this->size() << "\n" << std::setw(30) << "" << "\n" 
@@ -85,10 +172,145 @@ struct trbt_trace_type : public Tree {
     }
 
     bool active{false};
-    std::deque<Tree> trace{};
+
+    private:
+        struct entry {
+            trace_operation op;
+            std::optional<value_type> value{};
+            /* Value pointed to by the hint, empty if the hint was end() */
+            std::optional<value_type> hint{};
+            std::vector<value_type> range{};
+        };
+
+        template <typename T>
+        std::pair<iterator, bool> logged_insert(bool traced, T&& value) {
+            checkpoint_if_due();
+            log({trace_operation::Insert, value_type(value)}, traced);
+            return Tree::insert(std::forward<T>(value));
+        }
+
+        template <typename InputIt>
+        void logged_insert(bool traced, InputIt first, InputIt last) {
+            using category = typename std::iterator_traits<InputIt>::iterator_category;
+            checkpoint_if_due();
+            if constexpr(std::is_base_of_v<std::forward_iterator_tag, category>) {
+                log({trace_operation::InsertRange, {}, {}, std::vector<value_type>(first, last)}, traced);
+                Tree::insert(first, last);
+            }
+            else {
+                /* Single pass, insert from the logged copy instead */
+                log({trace_operation::InsertRange, {}, {}, std::vector<value_type>(first, last)}, traced);
+                auto const& range = log_.back().range;
+                Tree::insert(std::begin(range), std::end(range));
+            }
+        }
+
+        template <typename T>
+        iterator logged_insert(bool traced, const_iterator hint, T&& value) {
+            checkpoint_if_due();
+            log({trace_operation::HintedInsert, value_type(value), hint_value(hint)}, traced);
+            return Tree::insert(hint, std::forward<T>(value));
+        }
+
+        /* The value is only known after construction, so it is logged after the
+         * fact. This is fine as long as the checkpoint is taken beforehand */
+        template <typename... Args>
+        std::pair<iterator, bool> logged_emplace(bool traced, Args&&... args) {
+            checkpoint_if_due();
+            auto res = Tree::emplace(std::forward<Args>(args)...);
+            log({trace_operation::Insert, *res.first}, traced);
+            return res;
+        }
+
+        template <typename... Args>
+        iterator logged_emplace_hint(bool traced, const_iterator hint, Args&&... args) {
+            checkpoint_if_due();
+            auto hint_val = hint_value(hint);
+            auto it = Tree::emplace_hint(hint, std::forward<Args>(args)...);
+            log({trace_operation::HintedInsert, *it, std::move(hint_val)}, traced);
+            return it;
+        }
+
+        size_type logged_erase(bool traced, value_type const& value) {
+            checkpoint_if_due();
+            log({trace_operation::Erase, value}, traced);
+            return Tree::erase(value);
+        }
+
+        std::optional<value_type> hint_value(const_iterator hint) const {
+            if(hint == this->cend())
+                return std::nullopt;
+            return *hint;
+        }
+
+        /* Must be called before the logged operation alters the tree */
+        void checkpoint_if_due() {
+            auto const index = log_begin_ + log_.size();
+            auto const interval = std::max<std::size_t>(trbt_trace_checkpoint_interval, this->size());
+            if(checkpoints_.empty() || index - checkpoints_.back().first >= interval)
+                checkpoints_.emplace_back(index, static_cast<Tree const&>(*this));
+        }
+
+        void log(entry e, bool traced) {
+            if(traced) {
+                traced_.push_back(log_begin_ + log_.size());
+                if(traced_.size() > trbt_trace_size)
+                    traced_.pop_front();
+            }
+            log_.push_back(std::move(e));
+
+            /* Drop checkpoints and log entries no longer needed to reconstruct
+             * the states preceding the last trbt_trace_size traced operations */
+            auto const needed = traced_.empty() ? log_begin_ + log_.size() : traced_.front();
+            while(checkpoints_.size() > 1u && checkpoints_[1].first <= needed)
+                checkpoints_.pop_front();
+            while(log_begin_ < checkpoints_.front().first) {
+                log_.pop_front();
+                ++log_begin_;
+            }
+        }
+
+        void reset_log() {
+            log_.clear();
+            checkpoints_.clear();
+            traced_.clear();
+            log_begin_ = 0u;
+        }
+
+        static void replay(Tree& tree, entry const& e) {
+            switch(e.op) {
+                case trace_operation::Insert:
+                    tree.insert(*e.value);
+                    break;
+                case trace_operation::HintedInsert:
+                    tree.insert(e.hint ? tree.find(*e.hint) : tree.end(), *e.value);
+                    break;
+                case trace_operation::InsertRange:
+                    tree.insert(std::begin(e.range), std::end(e.range));
+                    break;
+                case trace_operation::Erase:
+                    tree.erase(*e.value);
+                    break;
+                case trace_operation::Clear:
+                    tree.clear();
+                    break;
+            }
+        }
+
+        /* Absolute index of the first entry in log_ */
+        std::size_t log_begin_{0u};
+        std::deque<entry> log_{};
+        std::deque<std::pair<std::size_t, Tree>> checkpoints_{};
+        /* Absolute indices of the last trbt_trace_size traced operations */
+        std::deque<std::size_t> traced_{};
 
 };
 
+template <typename Tree>
+void swap(trbt_trace_type<Tree>& left, trbt_trace_type<Tree>& right) {
+    left.swap(right);
+}
+
 inline int constexpr TRACE_CALL_RESOLVER{0};
 
 /* Drivers for tracing operations. Fall back on non-traced